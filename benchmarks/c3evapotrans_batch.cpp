@@ -0,0 +1,87 @@
+// Compares the throughput of `c3EvapoTrans_batch` with repeated calls to
+// `c3EvapoTrans`, which recalculates the air conditions for every leaf, for a
+// set of randomly generated leaves in the same air conditions, and checks that
+// the two give the same results.
+//
+// This program does not require R, yggdrasil, or the BioCro framework. From
+// the `src/module_library` directory, it can be built and run with (all on one
+// line)
+//
+//   g++ -std=c++17 -O2 -fopenmp-simd -fno-math-errno -fno-trapping-math -I.
+//       ../../benchmarks/c3evapotrans_batch.cpp c3EvapoTrans.cpp AuxBioCro.cpp
+//       -o c3evapotrans_batch
+//   ./c3evapotrans_batch [number of leaves]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "BioCro.h"
+
+int main(int argc, char* argv[])
+{
+    size_t const n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<double> absorbed_shortwave(n);    // J / m^2 / s
+    std::vector<double> stomatal_conductance(n);  // mmol / m^2 / s
+    for (size_t i = 0; i < n; ++i) {
+        absorbed_shortwave[i] = 500 * uniform(generator);         // J / m^2 / s
+        stomatal_conductance[i] = 10 + 600 * uniform(generator);  // mmol / m^2 / s
+    }
+
+    double const air_temperature = 28;         // degrees C
+    double const RH = 0.6;                     // dimensionless
+    double const windspeed = 3;                // m / s
+    double const height = 1.5;                 // m
+    double const specific_heat_of_air = 1010;  // J / kg / K
+    double const minimum_gbw = 0.08;           // mol / m^2 / s
+    double const windspeed_height = 5;         // m
+
+    auto const full_start = std::chrono::steady_clock::now();
+
+    std::vector<ET_Str> full(n);
+    for (size_t i = 0; i < n; ++i) {
+        full[i] = c3EvapoTrans(
+            absorbed_shortwave[i], air_temperature, RH, windspeed, height,
+            specific_heat_of_air, stomatal_conductance[i], minimum_gbw,
+            windspeed_height);
+    }
+
+    auto const batch_start = std::chrono::steady_clock::now();
+
+    c3_air_conditions const air = c3_air_conditions_at(
+        air_temperature, RH, windspeed, height, specific_heat_of_air,
+        minimum_gbw, windspeed_height);
+
+    c3_evapotrans_batch_outputs const batch =
+        c3EvapoTrans_batch(air, absorbed_shortwave, stomatal_conductance);
+
+    auto const batch_end = std::chrono::steady_clock::now();
+
+    size_t n_different = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (full[i].TransR != batch.TransR[i] ||
+            full[i].EPenman != batch.EPenman[i] ||
+            full[i].EPriestly != batch.EPriestly[i] ||
+            full[i].Deltat != batch.Deltat[i] ||
+            full[i].boundary_layer_conductance != batch.boundary_layer_conductance) {
+            ++n_different;
+        }
+    }
+
+    double const full_time =
+        std::chrono::duration<double>(batch_start - full_start).count();  // s
+    double const batch_time =
+        std::chrono::duration<double>(batch_end - batch_start).count();  // s
+
+    std::printf(
+        "batch %.3g leaves / s, scalar %.3g leaves / s (speedup %.2f); "
+        "%zu of %zu leaves differ\n",
+        n / batch_time, n / full_time, full_time / batch_time, n_different, n);
+
+    return 0;
+}
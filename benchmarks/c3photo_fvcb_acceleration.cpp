@@ -0,0 +1,173 @@
+// Compares the plain, accelerated (`fvcb_solver_approach` = 2), and
+// closed-form (`fvcb_solver_approach` = 1) FvCB solvers over the daylight
+// hours of a year of Bondville weather. For each hour, leaves at ten depths in
+// the canopy are solved at air temperature, using incident light attenuated
+// exponentially with cumulative leaf area. This is repeated without water
+// stress and with moderate water stress applied through each
+// `water_stress_approach`. The program reports the number of iterations, the
+// time taken, and the largest difference in net assimilation from the
+// closed-form solution.
+//
+// This program does not require R, yggdrasil, or the BioCro framework. From
+// the `src/module_library` directory, it can be built and run with (all on one
+// line)
+//
+//   g++ -std=c++17 -O2 -I. ../../benchmarks/c3photo_fvcb_acceleration.cpp
+//       c3photo.cpp ball_berry.cpp AuxBioCro.cpp -o c3photo_fvcb_acceleration
+//   ./c3photo_fvcb_acceleration ../../run/weather_data/2002_Bondville_IL_daylength.csv
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "c3photo.hpp"
+
+struct weather_hour {
+    double solar;  // micromol / m^2 / s
+    double temp;   // degrees C
+    double rh;     // dimensionless
+};
+
+// Reads the daylight hours from a BioCro weather file
+std::vector<weather_hour> read_weather(std::string const& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+
+    std::vector<std::string> columns;
+    {
+        std::stringstream header(line);
+        std::string name;
+        while (std::getline(header, name, ',')) {
+            columns.push_back(name);
+        }
+    }
+
+    auto column = [&columns](std::string const& name) {
+        for (size_t i = 0; i < columns.size(); ++i) {
+            if (columns[i] == "\"" + name + "\"" || columns[i] == name) {
+                return i;
+            }
+        }
+        return columns.size();
+    };
+
+    size_t const solar_column = column("solar");
+    size_t const temp_column = column("temp");
+    size_t const rh_column = column("rh");
+
+    std::vector<weather_hour> hours;
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields;
+        std::stringstream row(line);
+        std::string field;
+        while (std::getline(row, field, ',')) {
+            fields.push_back(field);
+        }
+        if (fields.size() < columns.size()) {
+            continue;
+        }
+
+        weather_hour const hour{
+            std::stod(fields[solar_column]),
+            std::stod(fields[temp_column]),
+            std::stod(fields[rh_column])};
+
+        if (hour.solar > 0) {
+            hours.push_back(hour);
+        }
+    }
+    return hours;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string const path = argc > 1
+                                 ? argv[1]
+                                 : "../../run/weather_data/2002_Bondville_IL_daylength.csv";
+
+    std::vector<weather_hour> const hours = read_weather(path);
+    if (hours.empty()) {
+        std::fprintf(stderr, "No daylight hours were found in %s\n", path.c_str());
+        return 1;
+    }
+
+    int const nlayers = 10;
+    double const lai = 5.0;         // dimensionless
+    double const extinction = 0.5;  // dimensionless
+    double const Catm = 400;        // micromol / mol
+
+    // Temperature responses and leaf light levels
+    std::vector<c3_temperature_response> responses;
+    std::vector<double> ppfd;  // micromol / m^2 / s
+    std::vector<double> rh;    // dimensionless
+    for (weather_hour const& hour : hours) {
+        c3_temperature_response const tr =
+            c3_temperature_response_at(hour.temp, 110, 195, 13, 1.1, 0.7, 210);
+        for (int layer = 0; layer < nlayers; ++layer) {
+            double const cumulative_lai = lai * (layer + 0.5) / nlayers;  // dimensionless
+            responses.push_back(tr);
+            ppfd.push_back(hour.solar * std::exp(-extinction * cumulative_lai));
+            rh.push_back(hour.rh);
+        }
+    }
+
+    size_t const n = ppfd.size();
+
+    std::printf("%zu daylight hours, %zu leaves\n", hours.size(), n);
+
+    struct scenario {
+        double StomataWS;  // dimensionless
+        int water_stress_approach;
+    };
+
+    for (scenario const& s : {scenario{1.0, 1}, scenario{0.5, 0}, scenario{0.5, 1}}) {
+        std::printf(
+            "\nStomataWS = %g, water_stress_approach = %d\n",
+            s.StomataWS, s.water_stress_approach);
+
+        auto solve = [&](size_t i, int fvcb_solver_approach) {
+            return c3photoC_FvCB(
+                responses[i], ppfd[i], rh[i], 0.008, 10.6, 1e-3, Catm, 101325,
+                s.StomataWS, s.water_stress_approach, 4.5, 5.25, 0.0,
+                fvcb_solver_approach);
+        };
+
+        std::vector<double> analytic_assim(n);  // micromol / m^2 / s
+        for (size_t i = 0; i < n; ++i) {
+            analytic_assim[i] = solve(i, 1).Assim;
+        }
+
+        for (int fvcb_solver_approach : {0, 2, 1}) {
+            double total_iterations = 0.0;
+            double max_iterations = 0.0;
+            size_t n_at_limit = 0;
+            double max_difference = 0.0;  // micromol / m^2 / s
+
+            auto const start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < n; ++i) {
+                c3_str const photo = solve(i, fvcb_solver_approach);
+
+                total_iterations += photo.iterTimes;
+                max_iterations = photo.iterTimes > max_iterations ? photo.iterTimes : max_iterations;
+                n_at_limit += photo.iterTimes >= 1000 ? 1 : 0;
+
+                double const difference = std::abs(photo.Assim - analytic_assim[i]);
+                max_difference = difference > max_difference ? difference : max_difference;
+            }
+            auto const end = std::chrono::steady_clock::now();
+
+            std::printf(
+                "  fvcb_solver_approach = %d: %.3g s, mean iterations %.2f, max %g, "
+                "%zu at the limit; max |Assim - analytic| = %.3g\n",
+                fvcb_solver_approach, std::chrono::duration<double>(end - start).count(),
+                total_iterations / n, max_iterations, n_at_limit, max_difference);
+        }
+    }
+
+    return 0;
+}
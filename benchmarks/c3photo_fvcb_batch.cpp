@@ -0,0 +1,100 @@
+// Compares the throughput of `c3photoC_FvCB_batch` with repeated calls to
+// `c3photoC_FvCB` for a set of randomly generated leaves, and checks that the
+// two give the same results. With `water_stress_approach` set to 0, or with
+// fewer than `c3_fvcb_min_batch_size` leaves, `c3photoC_FvCB_batch` itself
+// calls `c3photoC_FvCB` for each leaf, so the two should take about the same
+// time.
+//
+// This program does not require R, yggdrasil, or the BioCro framework. From
+// the `src/module_library` directory, it can be built and run with (all on one
+// line)
+//
+//   g++ -std=c++17 -O2 -fopenmp-simd -fno-math-errno -fno-trapping-math -I.
+//       ../../benchmarks/c3photo_fvcb_batch.cpp c3photo.cpp ball_berry.cpp
+//       AuxBioCro.cpp -o c3photo_fvcb_batch
+//   ./c3photo_fvcb_batch [number of leaves]
+//
+// Adding `-march=native` allows wider vectors; in that case the compiler may
+// also contract multiplications and additions, so a few results may differ
+// from the scalar solver in the last few bits.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "c3photo.hpp"
+
+int main(int argc, char* argv[])
+{
+    size_t const n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    c3_fvcb_batch_inputs leaves;
+    leaves.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        leaves.Qp[i] = 2000 * uniform(generator);        // micromol / m^2 / s
+        leaves.Tleaf[i] = 5 + 35 * uniform(generator);    // degrees C
+        leaves.RH[i] = 0.2 + 0.7 * uniform(generator);    // dimensionless
+        leaves.Vcmax0[i] = 110;                           // micromol / m^2 / s
+        leaves.Jmax0[i] = 195;                            // micromol / m^2 / s
+        leaves.TPU_rate_max[i] = 13;                      // micromol / m^2 / s
+        leaves.Rd0[i] = 1.1;                              // micromol / m^2 / s
+        leaves.bb0[i] = 0.008;                            // mol / m^2 / s
+        leaves.bb1[i] = 10.6;                             // dimensionless
+        leaves.Gs_min[i] = 1e-3;                          // mol / m^2 / s
+        leaves.Ca[i] = 200 + 600 * uniform(generator);    // micromol / mol
+        leaves.AP[i] = 101325;                            // Pa
+        leaves.O2[i] = 210;                               // mmol / mol
+        leaves.thet[i] = 0.7;                             // dimensionless
+        leaves.StomWS[i] = 0.3 + 0.7 * uniform(generator);  // dimensionless
+    }
+
+    double const electrons_per_carboxylation = 4.5;
+    double const electrons_per_oxygenation = 5.25;
+
+    for (int water_stress_approach = 0; water_stress_approach < 2; ++water_stress_approach) {
+        auto const batch_start = std::chrono::steady_clock::now();
+
+        c3_fvcb_batch_outputs const batch = c3photoC_FvCB_batch(
+            leaves, water_stress_approach, electrons_per_carboxylation,
+            electrons_per_oxygenation);
+
+        auto const scalar_start = std::chrono::steady_clock::now();
+
+        size_t n_different = 0;
+        double max_difference = 0.0;  // micromol / m^2 / s
+        for (size_t i = 0; i < n; ++i) {
+            c3_str const scalar = c3photoC_FvCB(
+                leaves.Qp[i], leaves.Tleaf[i], leaves.RH[i], leaves.Vcmax0[i],
+                leaves.Jmax0[i], leaves.TPU_rate_max[i], leaves.Rd0[i],
+                leaves.bb0[i], leaves.bb1[i], leaves.Gs_min[i], leaves.Ca[i],
+                leaves.AP[i], leaves.O2[i], leaves.thet[i], leaves.StomWS[i],
+                water_stress_approach, electrons_per_carboxylation,
+                electrons_per_oxygenation);
+
+            double const difference = std::abs(scalar.Assim - batch.Assim[i]);
+            if (difference > 0 || scalar.Gs != batch.Gs[i] || scalar.Ci != batch.Ci[i]) {
+                ++n_different;
+            }
+            max_difference = difference > max_difference ? difference : max_difference;
+        }
+
+        auto const scalar_end = std::chrono::steady_clock::now();
+
+        double const batch_time =
+            std::chrono::duration<double>(scalar_start - batch_start).count();  // s
+        double const scalar_time =
+            std::chrono::duration<double>(scalar_end - scalar_start).count();  // s
+
+        std::printf(
+            "water_stress_approach = %d: batch %.3g leaves / s, scalar %.3g leaves / s "
+            "(speedup %.2f); %zu of %zu leaves differ, max |dAssim| = %.3g\n",
+            water_stress_approach, n / batch_time, n / scalar_time,
+            scalar_time / batch_time, n_different, n, max_difference);
+    }
+
+    return 0;
+}
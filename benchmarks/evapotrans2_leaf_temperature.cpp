@@ -0,0 +1,132 @@
+// Compares the fixed point and Newton leaf temperature solvers in
+// `EvapoTrans2_batch` for a set of randomly generated leaves. For each solver,
+// the throughput, the mean and maximum number of boundary layer conductance
+// evaluations, and the error in the leaf energy balance are reported. The
+// error is the difference between the leaf temperature found by the solver
+// and the leaf temperature implied by the energy balance at that
+// temperature, which is zero at the exact solution.
+//
+// This program does not require R, yggdrasil, or the BioCro framework. From
+// the `src/module_library` directory, it can be built and run with (all on one
+// line)
+//
+//   g++ -std=c++17 -O2 -I. ../../benchmarks/evapotrans2_leaf_temperature.cpp
+//       AuxBioCro.cpp -o evapotrans2_leaf_temperature
+//   ./evapotrans2_leaf_temperature [number of leaves]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "BioCro.h"
+#include "../framework/constants.h"
+
+namespace
+{
+// The change in leaf temperature from one step of the original fixed point
+// iteration in `EvapoTrans2`, starting from `Deltat`
+double energy_balance_error(
+    double Deltat,                // degrees C
+    double absorbed_shortwave,    // J / m^2 / s
+    double air_temperature,       // degrees C
+    double RH,                    // dimensionless
+    double windspeed,             // m / s
+    double stomatal_conductance,  // mmol / m^2 / s
+    double leaf_width,            // m
+    double specific_heat_of_air,  // J / kg / K
+    double minimum_gbw)           // mol / m^2 / s
+{
+    double constexpr volume_of_one_mole_of_air = 24.39e-3;  // m^3 / mol
+
+    double const LHV = TempToLHV(air_temperature);                   // J / kg
+    double const SlopeFS = TempToSFS(air_temperature);               // kg / m^3 / K
+    double const SWVP = saturation_vapor_pressure(air_temperature);  // Pa
+    double const SWVC =
+        SWVP / physical_constants::ideal_gas_constant /
+        (air_temperature + conversion_constants::celsius_to_kelvin) *
+        physical_constants::molar_mass_of_water;                                   // kg / m^3
+    double const PsycParam = TempToDdryA(air_temperature) * specific_heat_of_air / LHV;  // kg / m^3 / K
+    double const gc = stomatal_conductance * 1e-3 * volume_of_one_mole_of_air;     // m / s
+
+    double const ga = leaf_boundary_layer_conductance_nikolov(
+        windspeed, leaf_width, air_temperature, Deltat, gc, RH * SWVP,
+        minimum_gbw * volume_of_one_mole_of_air);  // m / s
+
+    double const rlc =
+        4 * physical_constants::stefan_boltzmann *
+        pow(conversion_constants::celsius_to_kelvin + air_temperature, 3) * Deltat;  // W / m^2
+
+    double const TopValue = (absorbed_shortwave - rlc) * (1 / ga + 1 / gc) - LHV * SWVC * (1 - RH);  // J / m^3
+    double const BottomValue = LHV * (SlopeFS + PsycParam * (1 + ga / gc));                      // J / m^3 / K
+
+    return fmin(fmax(TopValue / BottomValue, -10), 10) - Deltat;  // degrees C
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t const n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<double> absorbed_shortwave(n);    // J / m^2 / s
+    std::vector<double> stomatal_conductance(n);  // mmol / m^2 / s
+    for (size_t i = 0; i < n; ++i) {
+        absorbed_shortwave[i] = 500 * uniform(generator);        // J / m^2 / s
+        stomatal_conductance[i] = 5 + 600 * uniform(generator);  // mmol / m^2 / s
+    }
+
+    double const air_temperature = 28;         // degrees C
+    double const RH = 0.6;                     // dimensionless
+    double const leaf_width = 0.04;            // m
+    double const specific_heat_of_air = 1010;  // J / kg / K
+    double const minimum_gbw = 0.08;           // mol / m^2 / s
+    int const eteq = 0;
+
+    char const* const names[] = {"fixed point", "Newton"};
+
+    // Free convection dominates the boundary layer conductance at low wind
+    // speeds, making it depend on leaf temperature
+    for (double const windspeed : {0.1, 1.0, 4.0}) {  // m / s
+        for (int approach = 0; approach < 2; ++approach) {
+            auto const start = std::chrono::steady_clock::now();
+
+            evapotrans2_batch_outputs const et = EvapoTrans2_batch(
+                absorbed_shortwave, absorbed_shortwave, air_temperature, RH,
+                windspeed, stomatal_conductance, leaf_width, specific_heat_of_air,
+                minimum_gbw, eteq, approach);
+
+            auto const end = std::chrono::steady_clock::now();
+
+            double total_iterations = 0.0;
+            double max_iterations = 0.0;
+            double total_error = 0.0;  // degrees C
+            double max_error = 0.0;    // degrees C
+            for (size_t i = 0; i < n; ++i) {
+                double const error = std::abs(energy_balance_error(
+                    et.Deltat[i], absorbed_shortwave[i], air_temperature, RH,
+                    windspeed, stomatal_conductance[i], leaf_width,
+                    specific_heat_of_air, minimum_gbw));  // degrees C
+
+                total_iterations += et.iterTimes[i];
+                max_iterations = std::max(max_iterations, et.iterTimes[i]);
+                total_error += error;
+                max_error = std::max(max_error, error);
+            }
+
+            double const time = std::chrono::duration<double>(end - start).count();  // s
+
+            std::printf(
+                "windspeed %.1f m / s, %-11s: %.3g leaves / s; evaluations per leaf: "
+                "mean %.2f, max %.0f; energy balance error: mean %.2g K, max %.2g K\n",
+                windspeed, names[approach], n / time, total_iterations / n,
+                max_iterations, total_error / n, max_error);
+        }
+    }
+
+    return 0;
+}
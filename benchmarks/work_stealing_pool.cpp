@@ -0,0 +1,91 @@
+// Compares a static division of tasks among threads with `work_stealing_pool`
+// for a set of tasks whose costs vary like the leaves of a ten layer canopy:
+// for each of the sunlit and shaded leaf classes, the cost falls by a factor
+// of about ten from the top layer to the bottom one, and the sunlit leaves
+// cost more than the shaded leaves. For each method, the elapsed time and the
+// time each thread spent running tasks are reported.
+//
+// This program does not require R, yggdrasil, or the BioCro framework. From
+// the `src/module_library` directory, it can be built and run with (all on one
+// line)
+//
+//   g++ -std=c++17 -O2 -fopenmp -I. ../../benchmarks/work_stealing_pool.cpp
+//       work_stealing_pool.cpp -o work_stealing_pool
+//   ./work_stealing_pool [number of threads] [number of canopy evaluations]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "work_stealing_pool.h"
+
+namespace
+{
+// Keeps the calling thread busy for the given time
+void spin(double duration)  // s
+{
+    auto const start = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < duration) {
+    }
+}
+
+void print_times(char const* name, double elapsed, std::vector<double> const& busy)
+{
+    std::printf("%-14s: elapsed %.3f s; busy time per thread:", name, elapsed);
+    for (double const time : busy) {
+        std::printf(" %.3f", time);
+    }
+    std::printf(" s\n");
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    int const nthreads = argc > 1 ? std::atoi(argv[1]) : 4;
+    int const nevaluations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    // Task costs for the sunlit leaves followed by the shaded leaves
+    int const nlayers = 10;
+    std::vector<double> cost;  // s
+    for (double const class_cost : {4e-3, 1e-3}) {
+        for (int i = 0; i < nlayers; ++i) {
+            cost.push_back(class_cost * std::pow(0.1, double(i) / (nlayers - 1)));
+        }
+    }
+    int const ntasks = static_cast<int>(cost.size());
+
+    // Static division into contiguous blocks
+    std::vector<double> static_busy(nthreads, 0.0);  // s
+    auto const static_start = std::chrono::steady_clock::now();
+    for (int e = 0; e < nevaluations; ++e) {
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+        for (int i = 0; i < ntasks; ++i) {
+            int const t = i * nthreads / ntasks;
+            spin(cost[i]);
+#pragma omp atomic
+            static_busy[t] += cost[i];
+        }
+    }
+    auto const static_end = std::chrono::steady_clock::now();
+
+    // Work stealing
+    work_stealing_pool pool(nthreads);
+    auto const pool_start = std::chrono::steady_clock::now();
+    for (int e = 0; e < nevaluations; ++e) {
+        pool.run(ntasks, [&](size_t i, int) { spin(cost[i]); });
+    }
+    auto const pool_end = std::chrono::steady_clock::now();
+
+    print_times(
+        "static",
+        std::chrono::duration<double>(static_end - static_start).count(),
+        static_busy);
+
+    print_times(
+        "work stealing",
+        std::chrono::duration<double>(pool_end - pool_start).count(),
+        pool.get_busy_times());
+
+    return 0;
+}
@@ -5,6 +5,8 @@
 #include <stdexcept>
 #include <string>
 #include <cmath>
+#include <algorithm>  // for std::max
+#include <vector>
 #include "BioCro.h"
 #include "../framework/constants.h"  // for pi, e, atmospheric_pressure_at_sea_level,
                            // ideal_gas_constant, molar_mass_of_water,
@@ -166,11 +168,37 @@ double absorbed_shortwave_from_incident_ppfd(
  *  @param [in] heightf Leaf area density, i.e., LAI per height of canopy (m^-1
  *              from m^2 leaf / m^2 ground / m height)
  *
- *  @return An n-layered light profile representing quantities within
- *          the canopy, including several photon flux densities and
- *          the relative fractions of shaded and sunlit leaves
+ *  @param [in] canopy_layer_approach A switch that determines where the layers
+ *              are placed (dimensionless):
+ *              - `0`: the canopy is divided into `nlayers` layers that each
+ *                contain the same leaf area, and the properties of each layer
+ *                are averaged over its leaf area
+ *              - `1`: the layers are placed at the `nlayers` Gauss-Legendre
+ *                points in cumulative LAI, and the properties of each layer
+ *                are evaluated at that point; each layer represents the leaf
+ *                area given by its quadrature weight
+ *
+ *  @param [out] out Arrays with `nlayers` elements where the n-layered light
+ *              profile is stored, representing quantities within the canopy,
+ *              including several photon flux densities and the relative
+ *              fractions of shaded and sunlit leaves. The `layer_depth` of
+ *              each layer is the fraction of the canopy LAI above the point
+ *              where its properties are evaluated, and its `layer_weight` is
+ *              its leaf area relative to the mean leaf area of all layers,
+ *              which is exactly 1 when `canopy_layer_approach` is 0. Arrays
+ *              that are null are not filled, and the absorbed shortwave
+ *              values are only calculated when their arrays are provided.
+ *
+ *  @return The fraction of direct radiation that passes through the canopy
+ *          (dimensionless).
+ *
+ *  With Gauss-Legendre layers, the canopy integral of any quantity that varies
+ *  smoothly with cumulative LAI is found much more accurately than with the
+ *  same number of equal layers, since the quadrature is exact for polynomials
+ *  of degree `2 * nlayers - 1`. This allows a few layers to reproduce the
+ *  canopy totals from many equal layers.
  */
-Light_profile sunML(
+double sunML(
     double ambient_ppfd_beam,     // micromol / (m^2 beam) / s
     double ambient_ppfd_diffuse,  // micromol / m^2 / s
     double lai,                   // dimensionless from m^2 / m^2
@@ -183,12 +211,17 @@ Light_profile sunML(
     double par_energy_content,    // J / micromol
     double par_energy_fraction,   // dimensionless
     double leaf_transmittance,    // dimensionless
-    double leaf_reflectance       // dimensionless
+    double leaf_reflectance,      // dimensionless
+    int canopy_layer_approach,    // dimensionless
+    light_profile_arrays const& out
 )
 {
     if (nlayers < 1 || nlayers > MAXLAY) {
         throw std::out_of_range("nlayers must be at least 1 but no more than MAXLAY.");
     }
+    if (canopy_layer_approach != 0 && canopy_layer_approach != 1) {
+        throw std::out_of_range("canopy_layer_approach must be 0 or 1.");
+    }
     if (cosine_zenith_angle > 1 || cosine_zenith_angle < -1) {
         throw std::out_of_range("cosine_zenith_angle must be between -1 and 1.");
     }
@@ -219,6 +252,14 @@ Light_profile sunML(
 
     double lai_per_layer = lai / nlayers;
 
+    // Determine the position and relative size of each layer
+    const bool gauss_legendre_layers = canopy_layer_approach == 1;
+    std::vector<double> gl_nodes(gauss_legendre_layers ? nlayers : 0);    // dimensionless
+    std::vector<double> gl_weights(gauss_legendre_layers ? nlayers : 0);  // dimensionless
+    if (gauss_legendre_layers) {
+        gauss_legendre_points(nlayers, gl_nodes.data(), gl_weights.data());
+    }
+
     // Calculate the fraction of direct radiation that passes through the canopy
     // using Equation 15.1. Note that this is equivalent to the fraction of
     // ground area below the canopy that is exposed to direct sunlight. Note
@@ -234,15 +275,25 @@ Light_profile sunML(
     // Calculate the ambient direct PPFD through a unit area of leaf surface
     double ambient_ppfd_beam_leaf = ambient_ppfd_beam_ground * k;  // micromol / (m^2 leaf) / s
 
-    // Start to fill in the light profile values
-    Light_profile light_profile;
-    light_profile.canopy_direct_transmission_fraction = canopy_direct_transmission_fraction;
+    // Store a value in one of the caller's arrays, if it was provided
+    auto store = [](double* array, int i, double value) {
+        if (array) {
+            array[i] = value;
+        }
+    };
 
     // Fill in the layer-dependent light profile values
     for (int i = 0; i < nlayers; ++i) {
         // Get the cumulative LAI for this layer, which represents the total
-        // leaf area above this layer
-        const double cumulative_lai = lai_per_layer * (i + 0.5);
+        // leaf area above this layer, and the relative leaf area of this
+        // layer. The Gauss-Legendre points and weights are mapped from the
+        // interval [-1, 1] to the cumulative LAI interval [0, lai].
+        const double layer_depth = gauss_legendre_layers ? 0.5 * (1 + gl_nodes[i])
+                                                         : (i + 0.5) / nlayers;  // dimensionless
+        const double layer_weight = gauss_legendre_layers ? 0.5 * gl_weights[i] * nlayers
+                                                          : 1.0;  // dimensionless
+        const double cumulative_lai = gauss_legendre_layers ? lai * layer_depth
+                                                            : lai_per_layer * (i + 0.5);  // dimensionless
 
         // Calculate the amount of PPFD scattered out of the direct beam using
         // Equations 15.6 and 15.1 from Campbell & Norman (1998), following
@@ -260,18 +311,26 @@ Light_profile sunML(
             ambient_ppfd_diffuse * exp(-kd * cumulative_lai) + scattered_ppfd;  // micromol / m^2 / s
 
         // Calculate the fraction of sunlit and shaded leaves in this canopy
-        // layer using Equation 15.21.
+        // layer using Equation 15.21. For Gauss-Legendre layers, the fraction
+        // is evaluated at the layer's point rather than averaged over its
+        // leaf area, as required by the quadrature.
         const double Ls = (1 - exp(-k * lai_per_layer)) * exp(-k * cumulative_lai) / k;  // dimensionless
-        double sunlit_fraction = Ls / lai_per_layer;                                     // dimensionless
-        double shaded_fraction = 1 - sunlit_fraction;                                    // dimensionless
+        double sunlit_fraction = gauss_legendre_layers ? exp(-k * cumulative_lai)
+                                                       : Ls / lai_per_layer;  // dimensionless
+        double shaded_fraction = 1 - sunlit_fraction;                         // dimensionless
 
         // Calculate an "average" incident PPFD for the sunlit and shaded leaves
         // that doesn't seem to be based on a formula from Campbell & Norman
         // (1998). It's interpreted as a flux density through a unit of leaf
-        // area, but that may not be correct.
-        double average_ppfd =
-            (sunlit_fraction * (ambient_ppfd_beam_leaf + diffuse_ppfd) + shaded_fraction * diffuse_ppfd) *
-            (1 - exp(-k * lai_per_layer)) / k;  // micromol / (m^2 leaf) / s
+        // area, but that may not be correct. Since it is proportional to the
+        // leaf area of the layer when layers are thin, it has no value at a
+        // point; for Gauss-Legendre layers, the mean of the sunlit and shaded
+        // values weighted by their fractions is used instead.
+        const double mean_ppfd =
+            sunlit_fraction * (ambient_ppfd_beam_leaf + diffuse_ppfd) + shaded_fraction * diffuse_ppfd;  // micromol / (m^2 leaf) / s
+
+        double average_ppfd = gauss_legendre_layers ? mean_ppfd
+                                                    : mean_ppfd * (1 - exp(-k * lai_per_layer)) / k;  // micromol / (m^2 leaf) / s
 
         // For values of cosine_zenith_angle close to or less than 0, in place
         // of the calculations above, we want to use the limits of the above
@@ -285,43 +344,337 @@ Light_profile sunML(
         }
 
         // Store these values of incident PPFD
-        light_profile.sunlit_incident_ppfd[i] = ambient_ppfd_beam_leaf + diffuse_ppfd;  // micromole / (m^2 leaf) / s
-        light_profile.incident_ppfd_scattered[i] = scattered_ppfd;                      // micromole / m^2 / s
-        light_profile.shaded_incident_ppfd[i] = diffuse_ppfd;                           // micromole / (m^2 leaf) / s
-        light_profile.average_incident_ppfd[i] = average_ppfd;                          // micromole / (m^2 leaf) / s
-        light_profile.sunlit_fraction[i] = sunlit_fraction;                             // dimensionless from m^2 / m^2
-        light_profile.shaded_fraction[i] = shaded_fraction;                             // dimensionless from m^2 / m^2
-        light_profile.height[i] = (lai - cumulative_lai) / heightf;                     // m
+        store(out.sunlit_incident_ppfd, i, ambient_ppfd_beam_leaf + diffuse_ppfd);  // micromole / (m^2 leaf) / s
+        store(out.incident_ppfd_scattered, i, scattered_ppfd);                      // micromole / m^2 / s
+        store(out.shaded_incident_ppfd, i, diffuse_ppfd);                           // micromole / (m^2 leaf) / s
+        store(out.average_incident_ppfd, i, average_ppfd);                          // micromole / (m^2 leaf) / s
+        store(out.sunlit_fraction, i, sunlit_fraction);                             // dimensionless from m^2 / m^2
+        store(out.shaded_fraction, i, shaded_fraction);                             // dimensionless from m^2 / m^2
+        store(out.height, i, (lai - cumulative_lai) / heightf);                     // m
+        store(out.layer_depth, i, layer_depth);                                     // dimensionless
+        store(out.layer_weight, i, layer_weight);                                   // dimensionless
 
         // We also need to determine the total amount of absorbed solar energy
         // for sunlit and shaded leaves
-        light_profile.sunlit_absorbed_shortwave[i] =
-            absorbed_shortwave_from_incident_ppfd(
-                ambient_ppfd_beam_leaf + diffuse_ppfd,
-                par_energy_content,
-                par_energy_fraction,
-                leaf_reflectance,
-                leaf_transmittance);  // J / (m^2 leaf) / s
-
-        light_profile.shaded_absorbed_shortwave[i] =
-            absorbed_shortwave_from_incident_ppfd(
-                diffuse_ppfd,
-                par_energy_content,
-                par_energy_fraction,
-                leaf_reflectance,
-                leaf_transmittance);  // J / (m^2 leaf) / s
-
-        light_profile.average_absorbed_shortwave[i] =
-            absorbed_shortwave_from_incident_ppfd(
-                average_ppfd,
-                par_energy_content,
-                par_energy_fraction,
-                leaf_reflectance,
-                leaf_transmittance);  // J / (m^2 leaf) / s
+        if (out.sunlit_absorbed_shortwave) {
+            out.sunlit_absorbed_shortwave[i] =
+                absorbed_shortwave_from_incident_ppfd(
+                    ambient_ppfd_beam_leaf + diffuse_ppfd,
+                    par_energy_content,
+                    par_energy_fraction,
+                    leaf_reflectance,
+                    leaf_transmittance);  // J / (m^2 leaf) / s
+        }
+
+        if (out.shaded_absorbed_shortwave) {
+            out.shaded_absorbed_shortwave[i] =
+                absorbed_shortwave_from_incident_ppfd(
+                    diffuse_ppfd,
+                    par_energy_content,
+                    par_energy_fraction,
+                    leaf_reflectance,
+                    leaf_transmittance);  // J / (m^2 leaf) / s
+        }
+
+        if (out.average_absorbed_shortwave) {
+            out.average_absorbed_shortwave[i] =
+                absorbed_shortwave_from_incident_ppfd(
+                    average_ppfd,
+                    par_energy_content,
+                    par_energy_fraction,
+                    leaf_reflectance,
+                    leaf_transmittance);  // J / (m^2 leaf) / s
+        }
     }
+    return canopy_direct_transmission_fraction;
+}
+
+/**
+ *  @brief Computes an n-layered light profile as described above, storing it
+ *  in a `Light_profile`.
+ *
+ *  A `Light_profile` has room for `MAXLAY` layers, so it is much larger than
+ *  needed for a canopy with only a few layers. Where this matters, use the
+ *  overload of `sunML` that stores the profile in caller-provided arrays with
+ *  `nlayers` elements and returns the `canopy_direct_transmission_fraction`.
+ */
+Light_profile sunML(
+    double ambient_ppfd_beam,     // micromol / (m^2 beam) / s
+    double ambient_ppfd_diffuse,  // micromol / m^2 / s
+    double lai,                   // dimensionless from m^2 / m^2
+    int nlayers,                  // dimensionless
+    double cosine_zenith_angle,   // dimensionless
+    double kd,                    // dimensionless
+    double chil,                  // dimensionless from m^2 / m^2
+    double absorptivity,          // dimensionless from mol / mol
+    double heightf,               // m^-1 from m^2 leaf / m^2 ground / m height
+    double par_energy_content,    // J / micromol
+    double par_energy_fraction,   // dimensionless
+    double leaf_transmittance,    // dimensionless
+    double leaf_reflectance,      // dimensionless
+    int canopy_layer_approach     // dimensionless
+)
+{
+    Light_profile light_profile;
+
+    light_profile_arrays const arrays = {
+        light_profile.sunlit_incident_ppfd,
+        light_profile.incident_ppfd_scattered,
+        light_profile.shaded_incident_ppfd,
+        light_profile.average_incident_ppfd,
+        light_profile.sunlit_absorbed_shortwave,
+        light_profile.shaded_absorbed_shortwave,
+        light_profile.average_absorbed_shortwave,
+        light_profile.sunlit_fraction,
+        light_profile.shaded_fraction,
+        light_profile.height,
+        light_profile.layer_depth,
+        light_profile.layer_weight};
+
+    light_profile.canopy_direct_transmission_fraction = sunML(
+        ambient_ppfd_beam, ambient_ppfd_diffuse, lai, nlayers,
+        cosine_zenith_angle, kd, chil, absorptivity, heightf,
+        par_energy_content, par_energy_fraction, leaf_transmittance,
+        leaf_reflectance, canopy_layer_approach, arrays);
+
     return light_profile;
 }
 
+namespace
+{
+// The integral of exp(-c * x) for x from 0 to `lai`
+double integrated_exponential(double c, double lai)
+{
+    return c * lai > 1e-10 ? (1 - exp(-c * lai)) / c : lai;
+}
+}  // namespace
+
+/**
+ *  @brief Computes the light environment of a canopy represented by two big
+ *  leaves, one containing all of the sunlit leaf area and the other containing
+ *  all of the shaded leaf area, following the sun/shade model of de Pury &
+ *  Farquhar (1997).
+ *
+ *  The parameters are the same as for `sunML`. The same light equations are
+ *  used, but rather than evaluating them in each of several layers, they are
+ *  integrated analytically over the sunlit and shaded leaf area of the whole
+ *  canopy:
+ *
+ *  - The sunlit leaf area is the integral of the sunlit fraction `exp(-k * L)`
+ *    over cumulative LAI `L`, which is `(1 - exp(-k * lai)) / k`; the rest of
+ *    the canopy leaf area is shaded.
+ *
+ *  - The incident PPFD of each big leaf is the mean of the incident PPFD over
+ *    its leaf area. The diffuse and scattered PPFD are sums of exponentials in
+ *    `L`, so these means can be found in closed form.
+ *
+ *  The result is stored as the first (and only) layer of a `Light_profile`.
+ *  The `sunlit_fraction` and `shaded_fraction` are the fractions of the canopy
+ *  leaf area in each big leaf. The `incident_ppfd_scattered` is the mean over
+ *  the canopy leaf area, and the `average_incident_ppfd` is the mean of the
+ *  sunlit and shaded values weighted by their fractions. The `height` is taken
+ *  at the middle of the canopy.
+ *
+ *  With these values, a one-layer canopy integrator (see
+ *  `multilayer_canopy_integrator`) gives canopy totals from just two leaf
+ *  evaluations.
+ *
+ *  de Pury, D. G. G. & Farquhar, G. D. "Simple scaling of photosynthesis from
+ *  leaves to canopies without the errors of big-leaf models" Plant, Cell &
+ *  Environment 20, 537-557 (1997).
+ */
+Light_profile sunML_two_leaf(
+    double ambient_ppfd_beam,     // micromol / (m^2 beam) / s
+    double ambient_ppfd_diffuse,  // micromol / m^2 / s
+    double lai,                   // dimensionless from m^2 / m^2
+    double cosine_zenith_angle,   // dimensionless
+    double kd,                    // dimensionless
+    double chil,                  // dimensionless from m^2 / m^2
+    double absorptivity,          // dimensionless from mol / mol
+    double heightf,               // m^-1 from m^2 leaf / m^2 ground / m height
+    double par_energy_content,    // J / micromol
+    double par_energy_fraction,   // dimensionless
+    double leaf_transmittance,    // dimensionless
+    double leaf_reflectance       // dimensionless
+)
+{
+    if (cosine_zenith_angle > 1 || cosine_zenith_angle < -1) {
+        throw std::out_of_range("cosine_zenith_angle must be between -1 and 1.");
+    }
+    if (kd > 1 || kd < 0) {
+        throw std::out_of_range("kd must be between 0 and 1.");
+    }
+    if (chil < 0) {
+        throw std::out_of_range("chil must be non-negative.");
+    }
+    if (absorptivity > 1 || absorptivity < 0) {
+        throw std::out_of_range("absorptivity must be between 0 and 1.");
+    }
+    if (heightf <= 0) {
+        throw std::out_of_range("heightf must greater than zero.");
+    }
+
+    // Calculate the canopy extinction coefficient as in `sunML`
+    double zenith_angle = acos(cosine_zenith_angle);  // radians
+    double k0 = sqrt(pow(chil, 2) + pow(tan(zenith_angle), 2));
+    double k1 = chil + 1.744 * pow((chil + 1.182), -0.733);
+    double k = k0 / k1;  // dimensionless
+
+    const bool sun_is_up = cosine_zenith_angle > 1E-10;
+
+    const double ambient_ppfd_beam_ground = ambient_ppfd_beam * cosine_zenith_angle;  // micromol / (m^2 ground) / s
+
+    double ambient_ppfd_beam_leaf = sun_is_up ? ambient_ppfd_beam_ground * k
+                                              : ambient_ppfd_beam / k1;  // micromol / (m^2 leaf) / s
+
+    // Integrate the diffuse and scattered PPFD over the whole canopy and over
+    // its sunlit part, where the sunlit fraction at cumulative LAI `L` is
+    // `exp(-k * L)` (Equations 15.6 and 15.21 from Campbell & Norman (1998),
+    // as used in `sunML`)
+    double scattered_total = 0.0;  // micromol / m^2 / s * (m^2 leaf / m^2 ground)
+    double diffuse_total =
+        ambient_ppfd_diffuse * integrated_exponential(kd, lai);  // micromol / m^2 / s * (m^2 leaf / m^2 ground)
+    double diffuse_sunlit = 0.0;                                 // micromol / m^2 / s * (m^2 leaf / m^2 ground)
+    double sunlit_lai = 0.0;                                     // dimensionless from m^2 / m^2
+
+    if (sun_is_up) {
+        const double k_scattered = k * sqrt(absorptivity);  // dimensionless
+
+        scattered_total =
+            ambient_ppfd_beam_ground * (integrated_exponential(k_scattered, lai) -
+                                        integrated_exponential(k, lai));
+
+        diffuse_total += scattered_total;
+
+        diffuse_sunlit =
+            ambient_ppfd_diffuse * integrated_exponential(kd + k, lai) +
+            ambient_ppfd_beam_ground * (integrated_exponential(k_scattered + k, lai) -
+                                        integrated_exponential(2 * k, lai));
+
+        sunlit_lai = integrated_exponential(k, lai);
+    }
+
+    const double shaded_lai = lai - sunlit_lai;  // dimensionless from m^2 / m^2
+
+    // Find the fractions and mean PPFD of each big leaf; for a canopy with no
+    // leaves, use the limits as `lai` approaches zero
+    const double sunlit_fraction =
+        !sun_is_up ? 0.0 : lai > 0 ? sunlit_lai / lai : 1.0;  // dimensionless
+    const double shaded_fraction = 1 - sunlit_fraction;        // dimensionless
+
+    const double sunlit_diffuse_ppfd =
+        sunlit_lai > 0 ? diffuse_sunlit / sunlit_lai : ambient_ppfd_diffuse;  // micromol / m^2 / s
+
+    const double shaded_diffuse_ppfd =
+        shaded_lai > 0 ? (diffuse_total - diffuse_sunlit) / shaded_lai : ambient_ppfd_diffuse;  // micromol / m^2 / s
+
+    const double scattered_ppfd = lai > 0 ? scattered_total / lai : 0.0;  // micromol / m^2 / s
+
+    const double sunlit_ppfd = ambient_ppfd_beam_leaf + sunlit_diffuse_ppfd;  // micromol / (m^2 leaf) / s
+    const double shaded_ppfd = shaded_diffuse_ppfd;                           // micromol / (m^2 leaf) / s
+
+    const double average_ppfd = sun_is_up ? sunlit_fraction * sunlit_ppfd + shaded_fraction * shaded_ppfd
+                                          : 0.0;  // micromol / (m^2 leaf) / s
+
+    // Store the values as a single layer
+    Light_profile light_profile;
+    light_profile.canopy_direct_transmission_fraction = sun_is_up ? exp(-k * lai) : 0.0;  // dimensionless
+
+    light_profile.sunlit_incident_ppfd[0] = sunlit_ppfd;        // micromole / (m^2 leaf) / s
+    light_profile.incident_ppfd_scattered[0] = scattered_ppfd;  // micromole / m^2 / s
+    light_profile.shaded_incident_ppfd[0] = shaded_ppfd;        // micromole / (m^2 leaf) / s
+    light_profile.average_incident_ppfd[0] = average_ppfd;      // micromole / (m^2 leaf) / s
+    light_profile.sunlit_fraction[0] = sunlit_fraction;         // dimensionless from m^2 / m^2
+    light_profile.shaded_fraction[0] = shaded_fraction;         // dimensionless from m^2 / m^2
+    light_profile.height[0] = 0.5 * lai / heightf;              // m
+    light_profile.layer_depth[0] = 0.5;                         // dimensionless
+    light_profile.layer_weight[0] = 1.0;                        // dimensionless
+
+    light_profile.sunlit_absorbed_shortwave[0] =
+        absorbed_shortwave_from_incident_ppfd(
+            sunlit_ppfd,
+            par_energy_content,
+            par_energy_fraction,
+            leaf_reflectance,
+            leaf_transmittance);  // J / (m^2 leaf) / s
+
+    light_profile.shaded_absorbed_shortwave[0] =
+        absorbed_shortwave_from_incident_ppfd(
+            shaded_ppfd,
+            par_energy_content,
+            par_energy_fraction,
+            leaf_reflectance,
+            leaf_transmittance);  // J / (m^2 leaf) / s
+
+    light_profile.average_absorbed_shortwave[0] =
+        absorbed_shortwave_from_incident_ppfd(
+            average_ppfd,
+            par_energy_content,
+            par_energy_fraction,
+            leaf_reflectance,
+            leaf_transmittance);  // J / (m^2 leaf) / s
+
+    return light_profile;
+}
+
+/**
+ *  @brief Calculates the points and weights for Gauss-Legendre quadrature of
+ *  order `n` on the interval [-1, 1].
+ *
+ *  The points are the roots of the Legendre polynomial `P_n`, which are found
+ *  with Newton's method starting from an asymptotic approximation; see
+ *  Section 4.6 of Press et al. Numerical Recipes (3rd edition, 2007). The
+ *  points are stored in increasing order, and the weights sum to 2.
+ *
+ *  @param [in] n The number of points, which must be at least 1 but no more
+ *              than MAXLAY
+ *
+ *  @param [out] nodes An array of at least size `n` that receives the points
+ *
+ *  @param [out] weights An array of at least size `n` that receives the
+ *               weights
+ */
+void gauss_legendre_points(int n, double* nodes, double* weights)
+{
+    using math_constants::pi;
+
+    if (n < 1 || n > MAXLAY) {
+        throw std::out_of_range("n must be at least 1 but no more than MAXLAY.");
+    }
+
+    // The points are symmetric about zero, so only the positive half (and zero
+    // when `n` is odd) needs to be found
+    for (int i = 0; i < (n + 1) / 2; ++i) {
+        double x = cos(pi * (i + 0.75) / (n + 0.5));
+        double dp = 0.0;  // the derivative of P_n at x
+
+        for (int iteration = 0; iteration < 100; ++iteration) {
+            // Evaluate P_n(x) and P_(n-1)(x) with the three-term recurrence
+            double p0 = 1.0;
+            double p1 = x;
+            for (int j = 2; j <= n; ++j) {
+                const double p2 = ((2 * j - 1) * x * p1 - (j - 1) * p0) / j;
+                p0 = p1;
+                p1 = p2;
+            }
+            dp = n * (x * p1 - p0) / (x * x - 1);
+
+            const double dx = p1 / dp;
+            x -= dx;
+            if (std::abs(dx) < 1e-15) {
+                break;
+            }
+        }
+
+        const double w = 2 / ((1 - x * x) * dp * dp);
+
+        nodes[i] = -x;
+        nodes[n - 1 - i] = x;
+        weights[i] = w;
+        weights[n - 1 - i] = w;
+    }
+}
+
 
 /* Additional Functions needed for EvapoTrans */
 
@@ -348,6 +701,26 @@ void WINDprof(double WindSpeed, double LAI, int nlayers,
     }
 }
 
+/**
+ * @brief Wind profile function for layers placed at arbitrary depths, such as
+ * the Gauss-Legendre layers from `sunML`
+ *
+ * Preconditions are the same as for the other version of this function, and
+ * additionally:
+ *     `layer_depth` is an array of at least size `nlayers` containing the
+ *     fraction of `LAI` above each layer.
+ */
+void WINDprof(double WindSpeed, double LAI, int nlayers,
+              double const* layer_depth, double* wind_speed_profile)
+{
+    constexpr double k = 0.7;
+
+    for (int i = 0; i < nlayers; ++i)
+    {
+        wind_speed_profile[i] = WindSpeed * exp(-k * LAI * layer_depth[i]);
+    }
+}
+
 /**
  * @brief Calculates a relative humidity profile throughout a multilayer
  * canopy.
@@ -455,6 +828,33 @@ void RHprof(double RH, int nlayers, double* relative_humidity_profile)
     }
 }
 
+/**
+ * @brief Calculates a relative humidity profile throughout a multilayer canopy
+ * whose layers are placed at arbitrary depths, such as the Gauss-Legendre
+ * layers from `sunML`.
+ *
+ * This uses Equation (3) from the other version of this function, with `x`
+ * given by `layer_depth`, an array of at least size `nlayers` containing the
+ * fraction of the canopy LAI above each layer.
+ */
+void RHprof(double RH, int nlayers, double const* layer_depth,
+            double* relative_humidity_profile)
+{
+    if (RH > 1 || RH < 0) {
+        throw std::out_of_range("RH must be between 0 and 1.");
+    }
+    if (nlayers < 1 || nlayers > MAXLAY) {
+        throw std::out_of_range("nlayers must be at least 1 but no more than MAXLAY.");
+    }
+
+    const double kh = 1 - RH;
+
+    for (int i = 0; i < nlayers; ++i)
+    {
+        relative_humidity_profile[i] = RH * exp(kh * layer_depth[i]);
+    }
+}
+
 void LNprof(double LeafN, double LAI, int nlayers, double kpLN, double* leafN_profile)
 {
     double LI = LAI / nlayers;
@@ -465,6 +865,14 @@ void LNprof(double LeafN, double LAI, int nlayers, double kpLN, double* leafN_pr
     }
 }
 
+void LNprof(double LeafN, double LAI, int nlayers, double const* layer_depth, double kpLN, double* leafN_profile)
+{
+    for(int i = 0; i < nlayers; ++i)
+    {
+        leafN_profile[i] = LeafN * exp(-kpLN * LAI * layer_depth[i]);
+    }
+}
+
 /**
  *  @brief Determines the density of dry air from the air temperature.
  *
@@ -638,17 +1046,38 @@ double saturation_vapor_pressure(
     return 611.21 * exp(a / b);  // Pa
 }
 
-struct ET_Str EvapoTrans2(
-    double absorbed_shortwave_radiation_et,  // J / m^2 / s (used to calculate evapotranspiration rate)
-    double absorbed_shortwave_radiation_lt,  // J / m^2 / s (used to calculate leaf temperature)
-    double airTemp,                          // degrees C
-    double RH,                               // dimensionless from Pa / Pa
-    double WindSpeed,                        // m / s
-    double stomatal_conductance,             // mmol / m^2 / s
-    double leaf_width,                       // meter
-    double specific_heat_of_air,             // J / kg / K
-    double minimum_gbw,                      // mol / m^2 / s
-    int eteq                                 // unitless parameter
+namespace
+{
+// TODO: This is for about 20 degrees C at 100000 Pa. Change it to use the
+// model state. (1 * R * temperature) / pressure
+double constexpr volume_of_one_mole_of_air = 24.39e-3;  // m^3 / mol
+
+// Quantities used by `EvapoTrans2` that do not depend on the leaf
+struct evapotrans2_air {
+    double airTemp;                 // degrees C
+    double LHV;                     // J / kg
+    double SlopeFS;                 // kg / m^3 / K
+    double PsycParam;               // kg / m^3 / K
+    double vapor_density_deficit;   // kg / m^3
+    double ActualVaporPressure;     // Pa
+    double longwave_coefficient;    // W / m^2 / K
+    double minimum_gbw_in_m_per_s;  // m / s
+
+    // Terms in `leaf_boundary_layer_conductance_nikolov` that do not depend
+    // on the leaf temperature
+    double leaf_width;               // m
+    double Tak;                      // K
+    double gbv_forced;               // m / s
+    double air_virtual_temperature;  // K
+};
+
+struct evapotrans2_air evapotrans2_air_at(
+    double airTemp,               // degrees C
+    double RH,                    // dimensionless from Pa / Pa
+    double WindSpeed,             // m / s
+    double leaf_width,            // meter
+    double specific_heat_of_air,  // J / kg / K
+    double minimum_gbw            // mol / m^2 / s
 )
 {
     const double DdryA = TempToDdryA(airTemp);               // kg / m^3. Density of dry air.,
@@ -656,18 +1085,6 @@ struct ET_Str EvapoTrans2(
     const double SlopeFS = TempToSFS(airTemp);               // kg / m^3 / K
     const double SWVP = saturation_vapor_pressure(airTemp);  // Pa.
 
-    // TODO: This is for about 20 degrees C at 100000 Pa. Change it to use the
-    // model state. (1 * R * temperature) / pressure
-    double constexpr volume_of_one_mole_of_air = 24.39e-3;  // m^3 / mol
-
-    double minimum_gbw_in_m_per_s = minimum_gbw * volume_of_one_mole_of_air;  // m / s
-
-    if (stomatal_conductance <= 0) {
-        throw std::range_error("Thrown in EvapoTrans2: stomatal conductance is not positive.");
-    }
-
-    double conductance_in_m_per_s = stomatal_conductance * 1e-3 * volume_of_one_mole_of_air;  // m / s
-
     if (RH > 1) {
         throw std::range_error("Thrown in EvapoTrans2: RH (relative humidity) is greater than 1.");
     }
@@ -682,58 +1099,237 @@ struct ET_Str EvapoTrans2(
         throw std::range_error("Thrown in EvapoTrans2: SWVC is less than 0.");
     }
 
-    const double PsycParam = DdryA * specific_heat_of_air / LHV;  // kg / m^3 / K
+    // As in `leaf_boundary_layer_conductance_nikolov`
+    constexpr double p = physical_constants::atmospheric_pressure_at_sea_level;  // Pa
+    constexpr double cf = 1.6361e-3;
+    const double ActualVaporPressure = RH * SWVP;                                     // Pa
+    const double Tak = airTemp + conversion_constants::celsius_to_kelvin;             // K
+    const double gbv_forced =
+        cf * pow(Tak, 0.56) * pow((Tak + 120) * ((WindSpeed / leaf_width) / p), 0.5);  // m / s
+
+    struct evapotrans2_air air;
+    air.airTemp = airTemp;
+    air.LHV = LHV;
+    air.SlopeFS = SlopeFS;
+    air.PsycParam = DdryA * specific_heat_of_air / LHV;
+    air.vapor_density_deficit = SWVC * (1 - RH);
+    air.ActualVaporPressure = ActualVaporPressure;
+    air.longwave_coefficient = 4 * physical_constants::stefan_boltzmann * pow(conversion_constants::celsius_to_kelvin + airTemp, 3);
+    air.minimum_gbw_in_m_per_s = minimum_gbw * volume_of_one_mole_of_air;
+    air.leaf_width = leaf_width;
+    air.Tak = Tak;
+    air.gbv_forced = gbv_forced;
+    air.air_virtual_temperature = Tak / (1 - 0.378 * ActualVaporPressure / p);
+    return air;
+}
 
-    const double vapor_density_deficit = SWVC * (1 - RH);  // kg / m^3
+// The boundary layer conductance from `leaf_boundary_layer_conductance_nikolov`
+// and its derivative with respect to the leaf temperature
+struct nikolov_conductance {
+    double gbv;           // m / s
+    double dgbv_dDeltat;  // m / s / K
+};
+
+struct nikolov_conductance nikolov_conductance_at(
+    struct evapotrans2_air const& air,
+    double delta_t,  // degrees C
+    double stomcond  // m / s
+)
+{
+    constexpr double p = physical_constants::atmospheric_pressure_at_sea_level;  // Pa
+    constexpr double cf = 1.6361e-3;
+
+    double const leaftemp = air.airTemp + delta_t;                          // degrees C
+    double const Tlk = leaftemp + conversion_constants::celsius_to_kelvin;  // K
+    double const lw = air.leaf_width;                                       // m
+
+    // Saturation vapor pressure at the leaf temperature and its derivative
+    double const a = (18.678 - leaftemp / 234.5) * leaftemp;
+    double const b = 257.14 + leaftemp;
+    double const esTl = 611.21 * exp(a / b);                                  // Pa
+    double const desTl = esTl * ((18.678 - 2 * leaftemp / 234.5) * b - a) / (b * b);  // Pa / K
+
+    // Free convection (Eqs. 33 - 35)
+    double const eb = (stomcond * esTl + air.gbv_forced * air.ActualVaporPressure) /
+                      (stomcond + air.gbv_forced);              // Pa
+    double const deb = stomcond * desTl / (stomcond + air.gbv_forced);  // Pa / K
+
+    double const virtual_denominator = 1 - 0.378 * eb / p;  // dimensionless
+    double const Tvdiff_signed = (Tlk / virtual_denominator) - air.air_virtual_temperature;  // K
+    double const dTv = 1 / virtual_denominator +
+                       Tlk * 0.378 * deb / p / (virtual_denominator * virtual_denominator);  // dimensionless
+
+    double const Tvdiff = Tvdiff_signed < 0 ? -Tvdiff_signed : Tvdiff_signed;  // K
+    double const dTvdiff = Tvdiff_signed < 0 ? -dTv : dTv;                     // dimensionless
+
+    double const gbv_free = cf * pow(Tlk, 0.56) * pow((Tlk + 120) / p, 0.5) * pow(Tvdiff / lw, 0.25);  // m / s
+    double const dgbv_free =
+        Tvdiff > 0 ? gbv_free * (0.56 / Tlk + 0.5 / (Tlk + 120) + 0.25 * dTvdiff / Tvdiff)
+                   : 0.0;  // m / s / K
+
+    // Overall conductance and the minimum, as in
+    // `leaf_boundary_layer_conductance_nikolov`
+    double const gbv = std::max(air.gbv_forced, gbv_free);
+    double const dgbv = air.gbv_forced < gbv_free ? dgbv_free : 0.0;
+
+    return gbv < air.minimum_gbw_in_m_per_s
+               ? nikolov_conductance{air.minimum_gbw_in_m_per_s, 0.0}
+               : nikolov_conductance{gbv, dgbv};
+}
 
-    const double ActualVaporPressure = RH * SWVP;  // Pa
+// The leaf temperature found by `EvapoTrans2`, along with the quantities
+// evaluated at the last step
+struct evapotrans2_leaf_temperature {
+    double Deltat;     // degrees C
+    double ga;         // m / s
+    double rlc;        // W / m^2
+    double iterTimes;  // number of boundary layer conductance evaluations
+};
+
+// The original WIMOVAC fixed point iteration, which stops when the change in
+// leaf temperature is below 0.5 degrees C
+struct evapotrans2_leaf_temperature leaf_temperature_fixed_point(
+    struct evapotrans2_air const& air,
+    double absorbed_shortwave_radiation_lt,  // J / m^2 / s
+    double conductance_in_m_per_s            // m / s
+)
+{
+    const double LHV = air.LHV;
+    const double SlopeFS = air.SlopeFS;
+    const double PsycParam = air.PsycParam;
+    const double vapor_density_deficit = air.vapor_density_deficit;
 
     /* This is the original from WIMOVAC*/
     double Deltat = 0.01;  // degrees C
     double ga;
     double rlc; /* Long wave radiation for iterative calculation */
-    {
-        double ChangeInLeafTemp = 10.0;  // degrees C
-        double Counter = 0;
-        do {
-            ga = leaf_boundary_layer_conductance_nikolov(
-                WindSpeed, leaf_width, airTemp, Deltat, conductance_in_m_per_s,
-                ActualVaporPressure, minimum_gbw_in_m_per_s);  // m / s
-
-            /* In WIMOVAC, ga was added to the canopy conductance */
-            /* ga = (ga * gbcW)/(ga + gbcW); */
-
-            double OldDeltaT = Deltat;
-
-            rlc = 4 * physical_constants::stefan_boltzmann * pow(conversion_constants::celsius_to_kelvin + airTemp, 3) * Deltat;  // W / m^2
-
-            /* rlc = net long wave radiation emittted per second
-             *     = radiation emitted per second - radiation absorbed per second
-             *     = sigma * (Tair + deltaT)^4 - sigma * Tair^4
-             *
-             * To make it a linear function of deltaT, do a Taylor series about
-             * deltaT = 0 and keep only the zero and first order terms.
-             *
-             * rlc = sigma * Tair^4 + deltaT * (4 * sigma * Tair^3) - sigma * Tair^4
-             *     = 4 * sigma * Tair^3 * deltaT
-             *
-             * where 4 * sigma * Tair^3 is the derivative of
-             * sigma * (Tair + deltaT)^4 evaluated at deltaT = 0
-             */
-
-            const double PhiN2 = absorbed_shortwave_radiation_lt - rlc;  // W / m^2
-
-            /* This equation is from Thornley and Johnson pg. 418 */
-            const double TopValue = PhiN2 * (1 / ga + 1 / conductance_in_m_per_s) - LHV * vapor_density_deficit;  // J / m^3
-            const double BottomValue = LHV * (SlopeFS + PsycParam * (1 + ga / conductance_in_m_per_s));           // J / m^3 / K
-            Deltat = fmin(fmax(TopValue / BottomValue, -10), 10);                                                 // kelvin. Confine Deltat to the interval [-10, 10]:
-
-            ChangeInLeafTemp = fabs(OldDeltaT - Deltat);  // kelvin
-        } while ((++Counter <= 10) && (ChangeInLeafTemp > 0.5));
+    double ChangeInLeafTemp = 10.0;  // degrees C
+    double Counter = 0;
+    do {
+        ga = nikolov_conductance_at(air, Deltat, conductance_in_m_per_s).gbv;  // m / s
+
+        /* In WIMOVAC, ga was added to the canopy conductance */
+        /* ga = (ga * gbcW)/(ga + gbcW); */
+
+        double OldDeltaT = Deltat;
+
+        /* rlc = net long wave radiation emittted per second
+         *     = radiation emitted per second - radiation absorbed per second
+         *     = sigma * (Tair + deltaT)^4 - sigma * Tair^4
+         *
+         * To make it a linear function of deltaT, do a Taylor series about
+         * deltaT = 0 and keep only the zero and first order terms.
+         *
+         * rlc = sigma * Tair^4 + deltaT * (4 * sigma * Tair^3) - sigma * Tair^4
+         *     = 4 * sigma * Tair^3 * deltaT
+         *
+         * where 4 * sigma * Tair^3 is the derivative of
+         * sigma * (Tair + deltaT)^4 evaluated at deltaT = 0
+         */
+        rlc = air.longwave_coefficient * Deltat;  // W / m^2
+
+        const double PhiN2 = absorbed_shortwave_radiation_lt - rlc;  // W / m^2
+
+        /* This equation is from Thornley and Johnson pg. 418 */
+        const double TopValue = PhiN2 * (1 / ga + 1 / conductance_in_m_per_s) - LHV * vapor_density_deficit;  // J / m^3
+        const double BottomValue = LHV * (SlopeFS + PsycParam * (1 + ga / conductance_in_m_per_s));           // J / m^3 / K
+        Deltat = fmin(fmax(TopValue / BottomValue, -10), 10);                                                 // kelvin. Confine Deltat to the interval [-10, 10]:
+
+        ChangeInLeafTemp = fabs(OldDeltaT - Deltat);  // kelvin
+    } while ((++Counter <= 10) && (ChangeInLeafTemp > 0.5));
+
+    return {Deltat, ga, rlc, Counter};
+}
+
+// A safeguarded Newton solution of the same energy balance. The residual
+//
+//   f(Deltat) = Deltat * BottomValue(Deltat) - TopValue(Deltat)
+//
+// is zero at the fixed point of the WIMOVAC iteration. Its derivative includes
+// the response of the boundary layer conductance to leaf temperature. Newton
+// steps that leave the interval known to contain the root are replaced by
+// bisection, and the iteration stops when the change in leaf temperature
+// implied by the residual is below `Deltat_tolerance`. As in the fixed point
+// iteration, Deltat is confined to [-10, 10].
+struct evapotrans2_leaf_temperature leaf_temperature_newton(
+    struct evapotrans2_air const& air,
+    double absorbed_shortwave_radiation_lt,  // J / m^2 / s
+    double conductance_in_m_per_s            // m / s
+)
+{
+    constexpr double Deltat_tolerance = 1e-4;  // degrees C
+    constexpr int max_iterations = 50;
+    constexpr double Deltat_max = 10;  // degrees C
+
+    const double LHV = air.LHV;
+    const double SlopeFS = air.SlopeFS;
+    const double PsycParam = air.PsycParam;
+    const double vapor_density_deficit = air.vapor_density_deficit;
+    const double gc = conductance_in_m_per_s;  // m / s
+
+    double lower = -Deltat_max;  // degrees C
+    double upper = Deltat_max;   // degrees C
+    double Deltat = 0.01;        // degrees C
+    double ga;                   // m / s
+    double rlc;                  // W / m^2
+    int iterations = 0;
+    while (true) {
+        ++iterations;
+
+        const struct nikolov_conductance g = nikolov_conductance_at(air, Deltat, gc);
+        ga = g.gbv;                                 // m / s
+        rlc = air.longwave_coefficient * Deltat;  // W / m^2
+
+        const double PhiN2 = absorbed_shortwave_radiation_lt - rlc;                                  // W / m^2
+        const double TopValue = PhiN2 * (1 / ga + 1 / gc) - LHV * vapor_density_deficit;             // J / m^3
+        const double BottomValue = LHV * (SlopeFS + PsycParam * (1 + ga / gc));                      // J / m^3 / K
+        const double f = Deltat * BottomValue - TopValue;                                            // J / m^3
+        const double df = BottomValue + Deltat * LHV * PsycParam * g.dgbv_dDeltat / gc +
+                          air.longwave_coefficient * (1 / ga + 1 / gc) +
+                          PhiN2 * g.dgbv_dDeltat / (ga * ga);                                       // J / m^3 / K
+
+        const double Deltat_error = f / BottomValue;  // degrees C
+
+        if (std::abs(Deltat_error) < Deltat_tolerance ||
+            (Deltat >= Deltat_max && Deltat_error < 0) ||
+            (Deltat <= -Deltat_max && Deltat_error > 0) ||
+            iterations >= max_iterations) {
+            break;
+        }
+
+        if (f > 0) {
+            upper = Deltat;
+        } else {
+            lower = Deltat;
+        }
+
+        const double newton = fmin(fmax(Deltat - f / df, -Deltat_max), Deltat_max);  // degrees C
+
+        Deltat = std::isfinite(df) && df > 0 && newton >= lower && newton <= upper && newton != Deltat
+                     ? newton
+                     : 0.5 * (lower + upper);  // degrees C
     }
 
+    return {Deltat, ga, rlc, static_cast<double>(iterations)};
+}
+
+// Evapotranspiration from the leaf temperature solution, as in `EvapoTrans2`
+struct ET_Str evapotrans2_results(
+    struct evapotrans2_air const& air,
+    struct evapotrans2_leaf_temperature const& lt,
+    double absorbed_shortwave_radiation_et,  // J / m^2 / s
+    double conductance_in_m_per_s,           // m / s
+    int eteq                                 // unitless parameter
+)
+{
+    const double LHV = air.LHV;
+    const double SlopeFS = air.SlopeFS;
+    const double PsycParam = air.PsycParam;
+    const double vapor_density_deficit = air.vapor_density_deficit;
+    const double ga = lt.ga;
+
     /* Net radiation */
-    const double PhiN = fmax(0, absorbed_shortwave_radiation_et - rlc);  // W / m^2
+    const double PhiN = fmax(0, absorbed_shortwave_radiation_et - lt.rlc);  // W / m^2
 
     const double penman_monteith =
         (SlopeFS * PhiN + LHV * PsycParam * ga * vapor_density_deficit) /
@@ -767,11 +1363,121 @@ struct ET_Str EvapoTrans2(
     et_results.TransR = TransR * cf;                                         // mmol / m^2 / s
     et_results.EPenman = EPen * cf;                                          // mmol / m^2 / s
     et_results.EPriestly = EPries * cf;                                      // mmol / m^2 / s
-    et_results.Deltat = Deltat;                                              // degrees C
+    et_results.Deltat = lt.Deltat;                                           // degrees C
     et_results.boundary_layer_conductance = ga / volume_of_one_mole_of_air;  // mol / m^2 / s
 
     return et_results;
 }
+}  // namespace
+
+/**
+ *  @brief Calculates leaf temperature and evapotranspiration.
+ *
+ *  When `leaf_temperature_solver_approach` is 0, the leaf temperature is found
+ *  with the original WIMOVAC fixed point iteration, which stops when the
+ *  change in leaf temperature is below 0.5 degrees C or after 11 steps. When
+ *  it is 1, a safeguarded Newton method is used instead; this usually needs
+ *  fewer evaluations of the boundary layer conductance and satisfies the
+ *  energy balance to within 1e-4 degrees C.
+ */
+struct ET_Str EvapoTrans2(
+    double absorbed_shortwave_radiation_et,  // J / m^2 / s (used to calculate evapotranspiration rate)
+    double absorbed_shortwave_radiation_lt,  // J / m^2 / s (used to calculate leaf temperature)
+    double airTemp,                          // degrees C
+    double RH,                               // dimensionless from Pa / Pa
+    double WindSpeed,                        // m / s
+    double stomatal_conductance,             // mmol / m^2 / s
+    double leaf_width,                       // meter
+    double specific_heat_of_air,             // J / kg / K
+    double minimum_gbw,                      // mol / m^2 / s
+    int eteq,                                // unitless parameter
+    int leaf_temperature_solver_approach     // a dimensionless switch
+)
+{
+    if (stomatal_conductance <= 0) {
+        throw std::range_error("Thrown in EvapoTrans2: stomatal conductance is not positive.");
+    }
+
+    double conductance_in_m_per_s = stomatal_conductance * 1e-3 * volume_of_one_mole_of_air;  // m / s
+
+    const struct evapotrans2_air air = evapotrans2_air_at(
+        airTemp, RH, WindSpeed, leaf_width, specific_heat_of_air, minimum_gbw);
+
+    const struct evapotrans2_leaf_temperature lt =
+        leaf_temperature_solver_approach == 1
+            ? leaf_temperature_newton(air, absorbed_shortwave_radiation_lt, conductance_in_m_per_s)
+            : leaf_temperature_fixed_point(air, absorbed_shortwave_radiation_lt, conductance_in_m_per_s);
+
+    return evapotrans2_results(
+        air, lt, absorbed_shortwave_radiation_et, conductance_in_m_per_s, eteq);
+}
+
+/**
+ *  @brief Calculates the same quantities as `EvapoTrans2` for many leaves in
+ *  the same air conditions.
+ *
+ *  The terms that depend only on the air, including the forced convection
+ *  part of the boundary layer conductance, are calculated once and shared by
+ *  all leaves. The number of boundary layer conductance evaluations used for
+ *  each leaf is reported in `iterTimes`.
+ */
+struct evapotrans2_batch_outputs EvapoTrans2_batch(
+    std::vector<double> const& absorbed_shortwave_radiation_et,  // J / m^2 / s
+    std::vector<double> const& absorbed_shortwave_radiation_lt,  // J / m^2 / s
+    double airTemp,                                              // degrees C
+    double RH,                                                   // dimensionless from Pa / Pa
+    double WindSpeed,                                            // m / s
+    std::vector<double> const& stomatal_conductance,             // mmol / m^2 / s
+    double leaf_width,                                           // meter
+    double specific_heat_of_air,                                 // J / kg / K
+    double minimum_gbw,                                          // mol / m^2 / s
+    int eteq,                                                    // unitless parameter
+    int leaf_temperature_solver_approach                         // a dimensionless switch
+)
+{
+    size_t const n = stomatal_conductance.size();
+
+    if (absorbed_shortwave_radiation_et.size() != n ||
+        absorbed_shortwave_radiation_lt.size() != n) {
+        throw std::logic_error("Thrown in EvapoTrans2_batch: the inputs have different sizes.");
+    }
+
+    const struct evapotrans2_air air = evapotrans2_air_at(
+        airTemp, RH, WindSpeed, leaf_width, specific_heat_of_air, minimum_gbw);
+
+    struct evapotrans2_batch_outputs out;
+    out.TransR.resize(n);
+    out.EPenman.resize(n);
+    out.EPriestly.resize(n);
+    out.Deltat.resize(n);
+    out.boundary_layer_conductance.resize(n);
+    out.iterTimes.resize(n);
+
+    for (size_t i = 0; i < n; ++i) {
+        if (stomatal_conductance[i] <= 0) {
+            throw std::range_error("Thrown in EvapoTrans2_batch: stomatal conductance is not positive.");
+        }
+
+        double const conductance_in_m_per_s = stomatal_conductance[i] * 1e-3 * volume_of_one_mole_of_air;  // m / s
+
+        const struct evapotrans2_leaf_temperature lt =
+            leaf_temperature_solver_approach == 1
+                ? leaf_temperature_newton(air, absorbed_shortwave_radiation_lt[i], conductance_in_m_per_s)
+                : leaf_temperature_fixed_point(air, absorbed_shortwave_radiation_lt[i], conductance_in_m_per_s);
+
+        const struct ET_Str et = evapotrans2_results(
+            air, lt, absorbed_shortwave_radiation_et[i], conductance_in_m_per_s, eteq);
+
+        out.TransR[i] = et.TransR;
+        out.EPenman[i] = et.EPenman;
+        out.EPriestly[i] = et.EPriestly;
+        out.Deltat[i] = et.Deltat;
+        out.boundary_layer_conductance[i] = et.boundary_layer_conductance;
+        out.iterTimes[i] = lt.iterTimes;
+    }
+
+    return out;
+}
 
 /**
  *  @brief Caluclates the conductance for water vapor flow between the leaf
@@ -22,9 +22,30 @@ struct Light_profile {
     double sunlit_fraction[MAXLAY];             // dimensionless
     double shaded_fraction[MAXLAY];             // dimensionless
     double height[MAXLAY];                      // m
+    double layer_depth[MAXLAY];                 // dimensionless
+    double layer_weight[MAXLAY];                // dimensionless
     double canopy_direct_transmission_fraction; // dimensionless
 };
 
+// Pointers to caller-provided arrays with one element for each canopy layer,
+// where the overload of `sunML` that takes this struct stores the light
+// profile; the quantities are the same as in `Light_profile`, and any pointer
+// may be null if that quantity is not needed
+struct light_profile_arrays {
+    double* sunlit_incident_ppfd;        // micromol / (m^2 leaf) / s
+    double* incident_ppfd_scattered;     // micromol / m^2 / s
+    double* shaded_incident_ppfd;        // micromol / (m^2 leaf) / s
+    double* average_incident_ppfd;       // micromol / (m^2 leaf) / s
+    double* sunlit_absorbed_shortwave;   // J / (m^2 leaf) / s
+    double* shaded_absorbed_shortwave;   // J / (m^2 leaf) / s
+    double* average_absorbed_shortwave;  // J / (m^2 leaf) / s
+    double* sunlit_fraction;             // dimensionless
+    double* shaded_fraction;             // dimensionless
+    double* height;                      // m
+    double* layer_depth;                 // dimensionless
+    double* layer_weight;                // dimensionless
+};
+
 struct ET_Str {
   double TransR;
   double EPenman;
@@ -139,6 +160,7 @@ double leaf_boundary_layer_conductance_thornley(
 );
 
 void LNprof(double LeafN, double LAI, int nlayers, double kpLN, double* leafNla);
+void LNprof(double LeafN, double LAI, int nlayers, double const* layer_depth, double kpLN, double* leafN_profile);
 
 /**
  *  @brief Calculates the exponential term of the Arrhenius equation.
@@ -184,6 +206,18 @@ inline double arrhenius_exponential(
     return exp(c - activation_energy / (ideal_gas_constant * temperature));
 }
 
+/**
+ *  @brief Returns `x_new` when `mask` is 1 and `x_old` when it is 0.
+ *
+ *  Unlike a conditional expression, both values are always read, so a loop
+ *  using this function can be vectorized without masked loads or stores. The
+ *  result is exact whenever both values are finite.
+ */
+inline double masked_update(double mask, double x_new, double x_old)
+{
+    return mask * x_new + (1.0 - mask) * x_old;
+}
+
 double saturation_vapor_pressure(double air_temperature);
 double TempToSFS(double Temp);
 double TempToLHV(double Temp);
@@ -1,6 +1,7 @@
 #ifndef BIOCRO_H
 #define BIOCRO_H
 
+#include <vector>
 #include "AuxBioCro.h"
 
 struct Light_model {
@@ -56,7 +57,9 @@ struct soilML_str soilML(double precipit, double transp, double *cws, double soi
         double specific_heat_of_air, double par_energy_content);
 
 void RHprof(double RH, int nlayers, double* relative_humidity_profile);
+void RHprof(double RH, int nlayers, double const* layer_depth, double* relative_humidity_profile);
 void WINDprof(double WindSpeed, double LAI, int nlayers, double* wind_speed_profile);
+void WINDprof(double WindSpeed, double LAI, int nlayers, double const* layer_depth, double* wind_speed_profile);
 
 double absorbed_shortwave_from_incident_ppfd(
     double incident_ppfd,        // micromol / m^2 / s
@@ -78,9 +81,45 @@ struct Light_profile sunML(
     double par_energy_content,    // J / micromol
     double par_energy_fraction,   // dimensionless
     double leaf_transmittance,    // dimensionless
+    double leaf_reflectance,      // dimensionless
+    int canopy_layer_approach = 0 // dimensionless
+);
+
+double sunML(
+    double ambient_ppfd_beam,                // micromol / (m^2 beam) / s
+    double ambient_ppfd_diffuse,             // micromol / m^2 / s
+    double lai,                              // dimensionless from m^2 / m^2
+    int nlayers,                             // dimensionless
+    double cosine_zenith_angle,              // dimensionless
+    double kd,                               // dimensionless
+    double chil,                             // dimensionless from m^2 / m^2
+    double absorptivity,                     // dimensionless from mol / mol
+    double heightf,                          // m^-1 from m^2 leaf / m^2 ground / m height
+    double par_energy_content,               // J / micromol
+    double par_energy_fraction,              // dimensionless
+    double leaf_transmittance,               // dimensionless
+    double leaf_reflectance,                 // dimensionless
+    int canopy_layer_approach,               // dimensionless
+    struct light_profile_arrays const& out   // arrays with `nlayers` elements
+);
+
+struct Light_profile sunML_two_leaf(
+    double ambient_ppfd_beam,     // micromol / (m^2 beam) / s
+    double ambient_ppfd_diffuse,  // micromol / m^2 / s
+    double lai,                   // dimensionless from m^2 / m^2
+    double cosine_zenith_angle,   // dimensionless
+    double kd,                    // dimensionless
+    double chil,                  // dimensionless from m^2 / m^2
+    double absorptivity,          // dimensionless from mol / mol
+    double heightf,               // m^-1 from m^2 leaf / m^2 ground / m height
+    double par_energy_content,    // J / micromol
+    double par_energy_fraction,   // dimensionless
+    double leaf_transmittance,    // dimensionless
     double leaf_reflectance       // dimensionless
 );
 
+void gauss_legendre_points(int n, double* nodes, double* weights);
+
 struct Light_model lightME(double cosine_zenith_angle, double atmospheric_pressure);
 
 struct FL_str FmLcFun(double Lig, double Nit);
@@ -98,7 +137,32 @@ struct ET_Str EvapoTrans2(
     double leaf_width,
     double specific_heat_of_air,
     double minimum_gbw,
-    int eteq
+    int eteq,
+    int leaf_temperature_solver_approach = 0
+);
+
+// Outputs from `EvapoTrans2_batch`, with one element for each leaf
+struct evapotrans2_batch_outputs {
+    std::vector<double> TransR;                      // mmol / m^2 / s
+    std::vector<double> EPenman;                     // mmol / m^2 / s
+    std::vector<double> EPriestly;                   // mmol / m^2 / s
+    std::vector<double> Deltat;                      // degrees C
+    std::vector<double> boundary_layer_conductance;  // mol / m^2 / s
+    std::vector<double> iterTimes;                   // dimensionless
+};
+
+struct evapotrans2_batch_outputs EvapoTrans2_batch(
+    std::vector<double> const& absorbed_shortwave_radiation_et,
+    std::vector<double> const& absorbed_shortwave_radiation_lt,
+    double airTemp,
+    double RH,
+    double WindSpeed,
+    std::vector<double> const& stomatal_conductance,
+    double leaf_width,
+    double specific_heat_of_air,
+    double minimum_gbw,
+    int eteq,
+    int leaf_temperature_solver_approach = 0
 );
 
 struct ET_Str c3EvapoTrans(
@@ -113,5 +177,47 @@ struct ET_Str c3EvapoTrans(
     double WindSpeedHeight
 );
 
+// Quantities used by `c3EvapoTrans` that depend only on the air and the
+// canopy, so they can be shared by all leaves in the same conditions
+struct c3_air_conditions {
+    double LHV;                   // J / kg
+    double SlopeFS;               // kg / m^3 / K
+    double PsycParam;             // kg / m^3 / K
+    double DeltaPVa;              // kg / m^3
+    double ga;                    // m / s
+    double longwave_coefficient;  // W / m^2 / K
+};
+
+struct c3_air_conditions c3_air_conditions_at(
+    double air_temperature,
+    double RH,
+    double WindSpeed,
+    double CanopyHeight,
+    double specific_heat_of_air,
+    double minimum_gbw,
+    double WindSpeedHeight
+);
+
+struct ET_Str c3EvapoTrans(
+    struct c3_air_conditions const& air,
+    double absorbed_shortwave_radiation,
+    double stomatal_conductance
+);
+
+// Outputs from `c3EvapoTrans_batch`, with one element for each leaf
+struct c3_evapotrans_batch_outputs {
+    std::vector<double> TransR;         // mmol / m^2 / s
+    std::vector<double> EPenman;        // mmol / m^2 / s
+    std::vector<double> EPriestly;      // mmol / m^2 / s
+    std::vector<double> Deltat;         // degrees C
+    double boundary_layer_conductance;  // mol / m^2 / s (shared by all leaves)
+};
+
+struct c3_evapotrans_batch_outputs c3EvapoTrans_batch(
+    struct c3_air_conditions const& air,
+    std::vector<double> const& absorbed_shortwave_radiation,
+    std::vector<double> const& stomatal_conductance
+);
+
 #endif
 
@@ -0,0 +1,131 @@
+#include <algorithm>  // for std::max
+#include <vector>     // for std::vector
+#include <cmath>      // for std::abs
+#include "adaptive_c3_canopy_fvcb.h"
+
+using yggdrasilBML::adaptive_layer_c3_canopy_fvcb;
+using yggdrasilBML::gauss_legendre_c3_canopy;
+using yggdrasilBML::n_layer_gauss_legendre_c3_canopy;
+
+namespace
+{
+// The canopy totals that are compared between layer counts and reported
+string_vector const canopy_totals = {
+    "canopy_assimilation_rate",   // Mg / ha / hr
+    "canopy_transpiration_rate",  // Mg / ha / hr
+    "canopy_conductance",         // mmol / m^2 / s
+    "GrossAssim"                  // Mg / ha / hr
+};
+
+// For each canopy total, the index of another total whose magnitude is also
+// used as the scale when comparing it between layer counts. Gross
+// assimilation is zero at night apart from rounding errors, so it is compared
+// on the scale of the net assimilation rate.
+std::vector<size_t> const canopy_total_scales = {0, 1, 2, 0};
+}  // namespace
+
+adaptive_layer_c3_canopy_fvcb::adaptive_layer_c3_canopy_fvcb(
+    state_map const& input_quantities,
+    state_map* output_quantities)
+    : direct_module(),
+      canopy_layer_tolerance(get_input(input_quantities, "canopy_layer_tolerance")),
+      canopy_layer_count_op(get_op(output_quantities, "canopy_layer_count"))
+{
+    // Create a canopy for each number of layers that may be used
+    canopies.push_back(std::unique_ptr<gauss_legendre_c3_canopy>(new n_layer_gauss_legendre_c3_canopy<1>));
+    canopies.push_back(std::unique_ptr<gauss_legendre_c3_canopy>(new n_layer_gauss_legendre_c3_canopy<2>));
+    canopies.push_back(std::unique_ptr<gauss_legendre_c3_canopy>(new n_layer_gauss_legendre_c3_canopy<4>));
+    canopies.push_back(std::unique_ptr<gauss_legendre_c3_canopy>(new n_layer_gauss_legendre_c3_canopy<8>));
+    canopies.push_back(std::unique_ptr<gauss_legendre_c3_canopy>(new n_layer_gauss_legendre_c3_canopy<16>));
+    canopies.push_back(std::unique_ptr<gauss_legendre_c3_canopy>(new n_layer_gauss_legendre_c3_canopy<32>));
+
+    // The inputs of this module, other than the tolerance, are passed to
+    // every canopy
+    string_vector canopy_inputs = get_inputs();
+    canopy_inputs.erase(
+        std::find(canopy_inputs.begin(), canopy_inputs.end(), "canopy_layer_tolerance"));
+
+    for (std::string const& name : canopy_inputs) {
+        canopy_input_ips.push_back(get_ip(input_quantities, name));
+    }
+
+    for (std::unique_ptr<gauss_legendre_c3_canopy> const& canopy : canopies) {
+        std::vector<double*> input_ops;
+        for (std::string const& name : canopy_inputs) {
+            input_ops.push_back(get_op(&canopy->get_quantities(), name));
+        }
+        canopy_input_ops.push_back(input_ops);
+
+        std::vector<const double*> total_ips;
+        for (std::string const& name : canopy_totals) {
+            total_ips.push_back(get_ip(canopy->get_quantities(), name));
+        }
+        canopy_total_ips.push_back(total_ips);
+    }
+
+    for (std::string const& name : canopy_totals) {
+        canopy_total_ops.push_back(get_op(output_quantities, name));
+    }
+}
+
+string_vector adaptive_layer_c3_canopy_fvcb::get_inputs()
+{
+    // The inputs are the same for any number of layers
+    string_vector inputs = n_layer_gauss_legendre_c3_canopy<1>::get_inputs();
+
+    inputs.erase(
+        std::find(inputs.begin(), inputs.end(), "canopy_layer_approach"));
+
+    inputs.push_back("canopy_layer_tolerance");  // dimensionless
+
+    return inputs;
+}
+
+string_vector adaptive_layer_c3_canopy_fvcb::get_outputs()
+{
+    string_vector outputs = canopy_totals;
+    outputs.push_back("canopy_layer_count");  // dimensionless
+    return outputs;
+}
+
+void adaptive_layer_c3_canopy_fvcb::do_operation() const
+{
+    // Returns true if the totals from two canopies agree to within the
+    // tolerance
+    auto totals_agree = [this](size_t coarse, size_t fine) -> bool {
+        for (size_t j = 0; j < canopy_totals.size(); ++j) {
+            double const a = *canopy_total_ips[coarse][j];
+            double const b = *canopy_total_ips[fine][j];
+            double const scale = std::max(
+                {std::abs(a), std::abs(b),
+                 std::abs(*canopy_total_ips[fine][canopy_total_scales[j]])});
+            if (std::abs(b - a) > canopy_layer_tolerance * scale) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Run canopies with increasing numbers of layers until two successive
+    // ones agree, or until the largest number of layers has been used
+    size_t chosen = 0;
+    for (size_t c = 0; c < canopies.size(); ++c) {
+        for (size_t j = 0; j < canopy_input_ips.size(); ++j) {
+            *canopy_input_ops[c][j] = *canopy_input_ips[j];
+        }
+
+        canopies[c]->run();
+        chosen = c;
+
+        if (c > 0 && totals_agree(c - 1, c)) {
+            break;
+        }
+    }
+
+    // Update the outputs
+    for (size_t j = 0; j < canopy_totals.size(); ++j) {
+        update(canopy_total_ops[j], *canopy_total_ips[chosen][j]);
+    }
+
+    update(canopy_layer_count_op, canopies[chosen]->get_nlayers());
+}
@@ -0,0 +1,191 @@
+#ifndef ADAPTIVE_C3_CANOPY_FVCB_H
+#define ADAPTIVE_C3_CANOPY_FVCB_H
+
+#include <algorithm>  // for std::find
+#include <memory>     // for std::unique_ptr
+#include <vector>
+#include "../framework/state_map.h"
+#include "../framework/module.h"
+#include "multilayer_canopy_properties.h"
+#include "multilayer_c3_canopy.h"
+#include "multilayer_canopy_integrator.h"
+
+namespace yggdrasilBML
+{
+/**
+ * @class gauss_legendre_c3_canopy
+ *
+ * @brief A complete canopy calculation with a fixed number of layers placed at
+ * Gauss-Legendre points, which owns its own quantities. This is used by the
+ * `adaptive_layer_c3_canopy_fvcb` module to run canopies with different
+ * numbers of layers.
+ */
+class gauss_legendre_c3_canopy
+{
+   public:
+    virtual ~gauss_legendre_c3_canopy() {}
+    virtual int get_nlayers() const = 0;
+    virtual state_map& get_quantities() = 0;
+    virtual void run() const = 0;
+};
+
+/**
+ * @class n_layer_gauss_legendre_c3_canopy
+ *
+ * @brief Runs the `n_layer_canopy_properties<N>`, `n_layer_c3_canopy_fvcb<N>`,
+ * and `n_layer_canopy_integrator<N>` modules in turn, with
+ * `canopy_layer_approach` set to 1.
+ */
+template <int N>
+class n_layer_gauss_legendre_c3_canopy : public gauss_legendre_c3_canopy
+{
+   public:
+    n_layer_gauss_legendre_c3_canopy()
+        : quantities(make_quantities()),
+          properties(quantities, &quantities),
+          photosynthesis(quantities, &quantities),
+          integrator(quantities, &quantities)
+    {
+        quantities.at("canopy_layer_approach") = 1;
+    }
+
+    // Quantities used by the modules that are not calculated by them
+    static string_vector get_inputs();
+
+    int get_nlayers() const { return N; }
+    state_map& get_quantities() { return quantities; }
+
+    void run() const
+    {
+        // Each module's `run` function is hidden by a protected function of
+        // its parent class with the same name, so it is called through the
+        // `module` base class
+        static_cast<module const&>(properties).run();
+        static_cast<module const&>(photosynthesis).run();
+        static_cast<module const&>(integrator).run();
+    }
+
+   private:
+    state_map quantities;
+    n_layer_canopy_properties<N> properties;
+    n_layer_c3_canopy_fvcb<N> photosynthesis;
+    n_layer_canopy_integrator<N> integrator;
+
+    static std::vector<string_vector> get_module_outputs()
+    {
+        return {
+            n_layer_canopy_properties<N>::get_outputs(),
+            n_layer_c3_canopy_fvcb<N>::get_outputs(),
+            n_layer_canopy_integrator<N>::get_outputs()};
+    }
+
+    static state_map make_quantities()
+    {
+        state_map result;
+        for (string_vector const& sv : get_module_outputs()) {
+            for (std::string const& name : sv) {
+                result[name] = 0.0;
+            }
+        }
+        for (std::string const& name : get_inputs()) {
+            result[name] = 0.0;
+        }
+        return result;
+    }
+};
+
+template <int N>
+string_vector n_layer_gauss_legendre_c3_canopy<N>::get_inputs()
+{
+    std::vector<string_vector> const module_inputs = {
+        n_layer_canopy_properties<N>::get_inputs(),
+        n_layer_c3_canopy_fvcb<N>::get_inputs(),
+        n_layer_canopy_integrator<N>::get_inputs()};
+
+    state_map calculated;
+    for (string_vector const& sv : get_module_outputs()) {
+        for (std::string const& name : sv) {
+            calculated[name] = 0.0;
+        }
+    }
+
+    string_vector result;
+    for (string_vector const& sv : module_inputs) {
+        for (std::string const& name : sv) {
+            if (calculated.count(name) == 0 &&
+                std::find(result.begin(), result.end(), name) == result.end()) {
+                result.push_back(name);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @class adaptive_layer_c3_canopy_fvcb
+ *
+ * @brief Calculates canopy assimilation, transpiration, and conductance like
+ * a multilayer canopy with `c3_leaf_fvcb` leaves (see `n_layer_c3_canopy_fvcb`
+ * and `multilayer_canopy_integrator`), choosing the number of layers in each
+ * evaluation to meet an error target.
+ *
+ * The layers are placed at Gauss-Legendre points (`canopy_layer_approach` =
+ * 1; see `multilayer_canopy_properties`), so the canopy totals converge
+ * quickly as layers are added. The canopy is first calculated with one layer,
+ * and the number of layers is then doubled, up to 32, until the canopy totals
+ * from two successive layer counts differ by no more than the fraction
+ * `canopy_layer_tolerance` of the larger one. (Gross assimilation, which is
+ * zero at night, is compared on the scale of the net assimilation rate.) The
+ * totals from the larger layer count are reported, and that count is reported
+ * as `canopy_layer_count`. In this way, few layers are used when the canopy is
+ * sparse or the sun is low or below the horizon, and more layers are used only
+ * when the light and leaf area make them necessary.
+ *
+ * The Gauss-Legendre points for different numbers of layers do not coincide,
+ * so no leaf calculations are shared between layer counts. An evaluation that
+ * ends with N layers therefore solves the leaves of 2N - 1 layers, about twice
+ * as many as a fixed N-layer canopy, and the worst case, when 32 layers are
+ * needed, solves 63 layers (126 leaves). When the number of layers needed is
+ * known in advance, a fixed-layer canopy is less expensive. The layer count
+ * is chosen again in every evaluation rather than carried over from the
+ * previous one, so the outputs depend only on the inputs.
+ *
+ * The `canopy_layer_approach` input is not needed, and the outputs for
+ * individual layers and leaf classes are not reported, since their number
+ * changes from one evaluation to the next.
+ */
+class adaptive_layer_c3_canopy_fvcb : public direct_module
+{
+   public:
+    adaptive_layer_c3_canopy_fvcb(
+        state_map const& input_quantities,
+        state_map* output_quantities);
+
+    static string_vector get_inputs();
+    static string_vector get_outputs();
+    static std::string get_name() { return "adaptive_layer_c3_canopy_fvcb"; }
+
+   private:
+    // Canopies with increasing numbers of layers
+    std::vector<std::unique_ptr<gauss_legendre_c3_canopy>> canopies;
+
+    // Pointers to the inputs, and pointers used to pass them to each canopy
+    std::vector<const double*> canopy_input_ips;
+    std::vector<std::vector<double*>> canopy_input_ops;
+
+    // Pointers to the canopy totals from each canopy
+    std::vector<std::vector<const double*>> canopy_total_ips;
+
+    // References to input quantities
+    double const& canopy_layer_tolerance;
+
+    // Pointers to output quantities
+    std::vector<double*> canopy_total_ops;
+    double* canopy_layer_count_op;
+
+    // Main operation
+    void do_operation() const;
+};
+
+}  // namespace yggdrasilBML
+#endif
@@ -1,4 +1,5 @@
 #include <cmath>
+#include <limits>     // for std::numeric_limits
 #include <stdexcept>
 #include "ball_berry.hpp"
 
@@ -9,54 +10,56 @@ double ball_berry(double assimilation,  // mol / m^2 / s
                   double beta0,  // mol / m^2 / s
                   double beta1)  // dimensionless from [mol / m^2 / s] / [mol / m^2 / s]
 {
-    const double gbw = 1.2;  // mol / m^2 / s.  Boundary-layer conductance. Collatz et al. (1992) Aust. J. Plant Physiol. pg. 526. The units in the manuscript, micromole / m^2 / s, are wrong . They are actually mol / m^2 / s.
-    double gswmol;  // mol / m^2 / s. stomatal conductance to water vapor.
+    if (ball_berry_check(assimilation, atmospheric_co2_concentration) != ball_berry_ok) {
+        throw_ball_berry_range_error();
+    }
 
-    if (assimilation > 0) {
-        const double Cs = atmospheric_co2_concentration - (1.4 / gbw) * assimilation;  // mol / mol.
-        if (Cs < 0.0) {
-            throw std::range_error("Thrown in ball_berry: Cs is less than 0.");
-        }
+    return ball_berry_unchecked(
+        assimilation, atmospheric_co2_concentration,
+        atmospheric_relative_humidity, beta0, beta1);  // mmol / m^2 / s
+}
 
-        double acs = assimilation / Cs;
-        if (acs < 1e-6) {
-            acs = 1e-6;
-        }
+void throw_ball_berry_range_error()
+{
+    throw std::range_error("Thrown in ball_berry: Cs is less than 0.");
+}
 
-        /* Calculate leaf surface relative humidity, hs, from the quadratic equation:
-         * a * hs^2 + b * hs + c = 0
-         *
-         * This can be derived as follows:
-         * At steady-state
-         *  E = gs * (hs - hi)  -- Equation 1
-         *  and
-         *  E = gb * (ha - hs)  -- Equation 2
-         *
-         * Substitute gs in equation 1 using the Ball-Berry model:
-         *  gs = b1 * A * hs / cs + b0
-         *
-         *  Where A is assimilation rate, hs is relative humidity at the surface of the leaf, and cs is the CO2 mole fraction at the surface of the leaf.
-         *
-         * Assume hi = 1 based on saturation of water vapor in the interal airspace of a leaf.
-         * Use the equality of equations 1 and 2 to solve for hs, and it's a quadratic with the coefficients given in the code.
-         */
-        const double a = beta1 * acs;  // Equivalent to a = beta1 * assimilation / cs
-        const double b = beta0 + gbw - beta1 * acs;  // Equivalent to b = beta0 + gbw - beta1 * assimilation / cs
-        const double c = -atmospheric_relative_humidity * gbw - beta0;
+/* Ball Berry stomatal conductance for `n` leaves at once. Instead of throwing
+ * an exception, the status of each leaf is stored in `status`, and the
+ * stomatal conductance for leaves with a nonzero status is set to NaN. The
+ * number of such leaves is returned, so the caller can decide how to report
+ * the problem (for example, by calling `throw_ball_berry_range_error`).
+ */
+size_t ball_berry_batch(
+    size_t n,
+    double const* assimilation,                   // mol / m^2 / s
+    double const* atmospheric_co2_concentration,  // mol / mol
+    double const* atmospheric_relative_humidity,  // Pa / Pa
+    double const* beta0,                          // mol / m^2 / s
+    double const* beta1,                          // dimensionless
+    double* stomatal_conductance,                 // mmol / m^2 / s
+    int* status)
+{
+    double const nan = std::numeric_limits<double>::quiet_NaN();
 
-        const double root_term = b * b - 4 * a * c;
-        const double hs = (-b + sqrt(root_term)) / (2 * a);
+    // The status is found in a separate pass, since mixing integer and
+    // floating point comparisons prevents this loop from being vectorized
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i) {
+        double const gs = ball_berry_unchecked(
+            assimilation[i], atmospheric_co2_concentration[i],
+            atmospheric_relative_humidity[i], beta0[i], beta1[i]);  // mmol / m^2 / s
 
-        gswmol = beta1 * hs * assimilation / Cs + beta0; // Ball-Berry equation (Collatz 1991, equation 1).
-    } else {
-        /* Set stomatal conductance to the minimum value, beta0 */
-        gswmol = beta0;
-        // hs = (beta0 + atmospheric_relative_humidity * gbw) / (beta0 + gbw)
+        stomatal_conductance[i] =
+            ball_berry_check(assimilation[i], atmospheric_co2_concentration[i]) == ball_berry_ok
+                ? gs
+                : nan;  // mmol / m^2 / s
     }
 
-    if (gswmol <= 0) {
-        gswmol = 1e-2;
+    size_t n_failed = 0;
+    for (size_t i = 0; i < n; ++i) {
+        status[i] = ball_berry_check(assimilation[i], atmospheric_co2_concentration[i]);
+        n_failed += status[i] != ball_berry_ok ? 1 : 0;
     }
-
-    return gswmol * 1000; // mmol / m^2 / s
+    return n_failed;
 }
@@ -1,7 +1,89 @@
 #ifndef BALL_BERRY_H
 #define BALL_BERRY_H
 
+#include <cmath>    // for sqrt
+#include <cstddef>  // for size_t
+
 double ball_berry(double assimilation, double atmospheric_co2_concentration, double atmospheric_relative_humidity, double beta0, double beta1);
 
-#endif
+// Possible outcomes for each leaf in `ball_berry_batch`
+enum ball_berry_status : int {
+    ball_berry_ok = 0,
+    ball_berry_negative_cs = 1  // The CO2 mole fraction at the leaf surface is negative
+};
+
+size_t ball_berry_batch(
+    size_t n,
+    double const* assimilation,
+    double const* atmospheric_co2_concentration,
+    double const* atmospheric_relative_humidity,
+    double const* beta0,
+    double const* beta1,
+    double* stomatal_conductance,
+    int* status);
+
+[[noreturn]] void throw_ball_berry_range_error();
+
+// Boundary-layer conductance used by the Ball-Berry functions. Collatz et al.
+// (1992) Aust. J. Plant Physiol. pg. 526. The units in the manuscript,
+// micromole / m^2 / s, are wrong . They are actually mol / m^2 / s.
+constexpr double ball_berry_gbw = 1.2;  // mol / m^2 / s
+
+// Returns the status of a stomatal conductance calculation with these inputs
+inline int ball_berry_check(
+    double assimilation,                   // mol / m^2 / s
+    double atmospheric_co2_concentration)  // mol / mol
+{
+    double const Cs = atmospheric_co2_concentration - (1.4 / ball_berry_gbw) * assimilation;  // mol / mol
+    return assimilation > 0 && Cs < 0.0 ? ball_berry_negative_cs : ball_berry_ok;
+}
+
+// Calculates stomatal conductance using the Ball-Berry model without checking
+// the inputs; the result is not meaningful unless `ball_berry_check` returns
+// `ball_berry_ok`. Both branches of the calculation are always evaluated and
+// one is selected, so this function can be used in vectorized loops.
+inline double ball_berry_unchecked(
+    double assimilation,                   // mol / m^2 / s
+    double atmospheric_co2_concentration,  // mol / mol
+    double atmospheric_relative_humidity,  // Pa / Pa
+    double beta0,                          // mol / m^2 / s
+    double beta1)                          // dimensionless
+{
+    double const gbw = ball_berry_gbw;  // mol / m^2 / s
 
+    double const Cs = atmospheric_co2_concentration - (1.4 / gbw) * assimilation;  // mol / mol.
+
+    double const acs_A = assimilation / Cs;
+    double const acs = acs_A < 1e-6 ? 1e-6 : acs_A;
+
+    /* Calculate leaf surface relative humidity, hs, from the quadratic equation:
+     * a * hs^2 + b * hs + c = 0
+     *
+     * This can be derived as follows:
+     * At steady-state
+     *  E = gs * (hs - hi)  -- Equation 1
+     *  and
+     *  E = gb * (ha - hs)  -- Equation 2
+     *
+     * Substitute gs in equation 1 using the Ball-Berry model:
+     *  gs = b1 * A * hs / cs + b0
+     *
+     *  Where A is assimilation rate, hs is relative humidity at the surface of the leaf, and cs is the CO2 mole fraction at the surface of the leaf.
+     *
+     * Assume hi = 1 based on saturation of water vapor in the interal airspace of a leaf.
+     * Use the equality of equations 1 and 2 to solve for hs, and it's a quadratic with the coefficients given in the code.
+     */
+    double const a = beta1 * acs;
+    double const b = beta0 + gbw - beta1 * acs;
+    double const c = -atmospheric_relative_humidity * gbw - beta0;
+    double const hs = (-b + sqrt(b * b - 4 * a * c)) / (2 * a);
+
+    // Ball-Berry equation (Collatz 1991, equation 1), or the minimum value
+    // beta0 when assimilation is not positive
+    double const gswmol_A = beta1 * hs * assimilation / Cs + beta0;  // mol / m^2 / s
+    double const gswmol = assimilation > 0 ? gswmol_A : beta0;      // mol / m^2 / s
+
+    return (gswmol <= 0 ? 1e-2 : gswmol) * 1000;  // mmol / m^2 / s
+}
+
+#endif
@@ -1,10 +1,23 @@
 #include <cmath>
 #include <stdexcept>
+#include <vector>
 #include "c3photo.hpp"
 #include "AuxBioCro.h"
 #include "BioCro.h"
 #include "../framework/constants.h"  // for ideal_gas_constant, molar_mass_of_water,
                                      // stefan_boltzmann, celsius_to_kelvin
+
+namespace
+{
+// TODO: This is for about 20 degrees C at 100000 Pa. Change it to use the
+// model state. (1 * R * temperature) / pressure
+constexpr double volume_of_one_mole_of_air = 24.39e-3;  // m^3 / mol
+
+// TransR has units of kg / m^2 / s. Convert to mmol / m^2 / s using the
+// molar mass of water (in kg / mol) and noting that 1e3 mmol = 1 mol
+constexpr double cf = 1e3 / physical_constants::molar_mass_of_water;  // mmol / kg for water
+}  // namespace
+
 /**
  * Many of the equations used in this function come from Chapter 14 of Thornley
  * and Johnson (1990).
@@ -23,24 +36,37 @@ struct ET_Str c3EvapoTrans(
     double minimum_gbw,                   // mol / m^2 / s
     double WindSpeedHeight                // m
 )
+{
+    return c3EvapoTrans(
+        c3_air_conditions_at(
+            air_temperature, RH, WindSpeed, CanopyHeight,
+            specific_heat_of_air, minimum_gbw, WindSpeedHeight),
+        absorbed_shortwave_radiation, stomatal_conductance);
+}
+
+/**
+ * Calculates the quantities used by `c3EvapoTrans` that do not depend on the
+ * leaf, so they can be calculated once for many leaves in the same
+ * conditions (for example, the sunlit and shaded leaves in every layer of a
+ * canopy).
+ */
+struct c3_air_conditions c3_air_conditions_at(
+    double air_temperature,       // degrees C
+    double RH,                    // Pa / Pa
+    double WindSpeed,             // m / s
+    double CanopyHeight,          // meters
+    double specific_heat_of_air,  // J / kg / K
+    double minimum_gbw,           // mol / m^2 / s
+    double WindSpeedHeight        // m
+)
 {
     const double DdryA = TempToDdryA(air_temperature);               // kg / m^3
     const double LHV = TempToLHV(air_temperature);                   // J / kg
     const double SlopeFS = TempToSFS(air_temperature);               // kg / m^3 / K
     const double SWVP = saturation_vapor_pressure(air_temperature);  // Pa
 
-    // TODO: This is for about 20 degrees C at 100000 Pa. Change it to use the
-    // model state. (1 * R * temperature) / pressure
-    constexpr double volume_of_one_mole_of_air = 24.39e-3;  // m^3 / mol
-
     double const minimum_gbw_in_m_per_s = minimum_gbw * volume_of_one_mole_of_air;  // m / s
 
-    if (stomatal_conductance <= 0) {
-        throw std::range_error("Thrown in c3EvapoTrans: stomatal conductance is not positive.");
-    }
-
-    double conductance_in_m_per_s = stomatal_conductance * 1e-3 * volume_of_one_mole_of_air;  // m / s
-
     if (RH > 1) {
         throw std::range_error("Thrown in c3EvapoTrans: RH (relative humidity) is greater than 1.");
     }
@@ -75,10 +101,37 @@ struct ET_Str c3EvapoTrans(
         throw std::range_error("Thrown in c3EvapoTrans: ga is less than zero.");
     }
 
-    /* Temperature of the leaf according to Campbell and Norman (1998) Chp 14.*/
-    /* This version is non-iterative and an approximation*/
     /* Stefan-Boltzmann law: B = sigma * T^4. where sigma is the Boltzmann constant. */
     /* From Table A.3 in Campbell and Norman.*/
+    // The change in emitted longwave radiation per degree of leaf warming,
+    // linearized about the air temperature
+    const double longwave_coefficient =
+        4.0 * physical_constants::stefan_boltzmann *
+        pow(conversion_constants::celsius_to_kelvin + air_temperature, 3.0);  // W / m^2 / K
+
+    return {LHV, SlopeFS, PsycParam, DeltaPVa, ga, longwave_coefficient};
+}
+
+struct ET_Str c3EvapoTrans(
+    struct c3_air_conditions const& air,
+    double absorbed_shortwave_radiation,  // J / m^2 / s
+    double stomatal_conductance           // mmol / m^2 / s
+)
+{
+    const double LHV = air.LHV;              // J / kg
+    const double SlopeFS = air.SlopeFS;      // kg / m^3 / K
+    const double PsycParam = air.PsycParam;  // kg / m^3 / K
+    const double DeltaPVa = air.DeltaPVa;    // kg / m^3
+    const double ga = air.ga;                // m / s
+
+    if (stomatal_conductance <= 0) {
+        throw std::range_error("Thrown in c3EvapoTrans: stomatal conductance is not positive.");
+    }
+
+    double conductance_in_m_per_s = stomatal_conductance * 1e-3 * volume_of_one_mole_of_air;  // m / s
+
+    /* Temperature of the leaf according to Campbell and Norman (1998) Chp 14.*/
+    /* This version is non-iterative and an approximation*/
 
     /* This is the original from WIMOVAC*/
     double Deltat = 0.01;  // degrees C
@@ -88,9 +141,7 @@ struct ET_Str c3EvapoTrans(
         for (int Counter = 0; (ChangeInLeafTemp > 0.5) && (Counter <= 10); ++Counter) {
             double OldDeltaT = Deltat;
 
-            double rlc = 4.0 * physical_constants::stefan_boltzmann *
-                         pow(conversion_constants::celsius_to_kelvin + air_temperature, 3.0) *
-                         Deltat;  // W / m^2
+            double rlc = air.longwave_coefficient * Deltat;  // W / m^2
 
             PhiN = absorbed_shortwave_radiation - rlc;  // W / m^2
 
@@ -128,16 +179,6 @@ struct ET_Str c3EvapoTrans(
 
     const double EPries = 1.26 * (SlopeFS * PhiN / (LHV * (SlopeFS + PsycParam)));  // kg / m^2 / s
 
-    // TransR has units of kg / m^2 / s.
-    // Convert to mm / m^2 / s.
-    /* 1e3 - g / kg  */
-    /* 18 - g / mol for water */
-    /* 1e3 - mmol / mol */
-
-    // TransR has units of kg / m^2 / s. Convert to mmol / m^2 / s using the
-    // molar mass of water (in kg / mol) and noting that 1e3 mmol = 1 mol
-    double cf = 1e3 / physical_constants::molar_mass_of_water;  // mmol / kg for water
-
     struct ET_Str et_results;
     et_results.TransR = TransR * cf;                                         // mmol / m^2 / s
     et_results.EPenman = EPen * cf;                                          // mmol / m^2 / s
@@ -147,3 +188,113 @@ struct ET_Str c3EvapoTrans(
 
     return et_results;
 }
+
+/**
+ * Calculates the same quantities as `c3EvapoTrans` for many leaves in the
+ * same air conditions. The leaf temperature iteration is run for all leaves
+ * together, with leaves that have converged keeping their values, so the
+ * results are identical to those from `c3EvapoTrans`. The loops over leaves
+ * contain no branches and can be vectorized.
+ */
+struct c3_evapotrans_batch_outputs c3EvapoTrans_batch(
+    struct c3_air_conditions const& air,
+    std::vector<double> const& absorbed_shortwave_radiation,  // J / m^2 / s
+    std::vector<double> const& stomatal_conductance           // mmol / m^2 / s
+)
+{
+    size_t const n = absorbed_shortwave_radiation.size();
+
+    if (stomatal_conductance.size() != n) {
+        throw std::logic_error("Thrown in c3EvapoTrans_batch: the inputs have different sizes.");
+    }
+
+    for (double const gs : stomatal_conductance) {
+        if (gs <= 0) {
+            throw std::range_error("Thrown in c3EvapoTrans_batch: stomatal conductance is not positive.");
+        }
+    }
+
+    const double LHV = air.LHV;                                    // J / kg
+    const double SlopeFS = air.SlopeFS;                            // kg / m^3 / K
+    const double PsycParam = air.PsycParam;                        // kg / m^3 / K
+    const double DeltaPVa = air.DeltaPVa;                          // kg / m^3
+    const double ga = air.ga;                                      // m / s
+    const double longwave_coefficient = air.longwave_coefficient;  // W / m^2 / K
+
+    struct c3_evapotrans_batch_outputs out;
+    out.TransR.resize(n);
+    out.EPenman.resize(n);
+    out.EPriestly.resize(n);
+    out.Deltat.assign(n, 0.01);  // degrees C
+    out.boundary_layer_conductance = ga / volume_of_one_mole_of_air;  // mol / m^2 / s
+
+    std::vector<double> gc(n);         // m / s
+    std::vector<double> PhiN(n);       // W / m^2
+    std::vector<double> active(n, 1);  // dimensionless
+
+    double const* const Q = absorbed_shortwave_radiation.data();
+    double const* const gs = stomatal_conductance.data();
+    double* const p_gc = gc.data();
+    double* const p_PhiN = PhiN.data();
+    double* const p_active = active.data();
+    double* const p_Deltat = out.Deltat.data();
+
+#pragma omp simd
+    for (size_t k = 0; k < n; ++k) {
+        p_gc[k] = gs[k] * 1e-3 * volume_of_one_mole_of_air;  // m / s
+    }
+
+    // The leaf temperature iteration from `c3EvapoTrans`
+    size_t n_active = n;
+    for (int Counter = 0; n_active > 0 && Counter <= 10; ++Counter) {
+#pragma omp simd
+        for (size_t k = 0; k < n; ++k) {
+            double const OldDeltaT = p_Deltat[k];  // degrees C
+
+            double const rlc = longwave_coefficient * OldDeltaT;  // W / m^2
+            double const PhiN_k = Q[k] - rlc;                      // W / m^2
+
+            // DeltaT equation from Thornley and Johnson 1990, Eq. 14.11e
+            double const TopValue = PhiN_k * (1 / ga + 1 / p_gc[k]) - LHV * DeltaPVa;       // J / m^3
+            double const BottomValue = LHV * (SlopeFS + PsycParam * (1 + ga / p_gc[k]));  // J / m^2 / K
+
+            // Limited as in `c3EvapoTrans`
+            double const D = TopValue / BottomValue;  // degrees C
+            double const D_low = D < -5.0 ? -5.0 : D;  // degrees C
+            double const Deltat = 5.0 < D_low ? 5.0 : D_low;  // degrees C
+
+            // Leaves that have converged keep their values
+            double const on = p_active[k];  // dimensionless
+            p_PhiN[k] = masked_update(on, PhiN_k, p_PhiN[k]);
+            p_Deltat[k] = masked_update(on, Deltat, OldDeltaT);
+            p_active[k] = fabs(OldDeltaT - Deltat) > 0.5 ? on : 0.0;
+        }
+
+        n_active = 0;
+        for (size_t k = 0; k < n; ++k) {
+            n_active += p_active[k] != 0 ? 1 : 0;
+        }
+    }
+
+    double* const TransR = out.TransR.data();
+    double* const EPenman = out.EPenman.data();
+    double* const EPriestly = out.EPriestly.data();
+
+#pragma omp simd
+    for (size_t k = 0; k < n; ++k) {
+        double const PhiN_k = p_PhiN[k] < 0 ? 0 : p_PhiN[k];  // W / m^2
+
+        // Penman-Monteith equation, as in `c3EvapoTrans`
+        TransR[k] =
+            (SlopeFS * PhiN_k + LHV * PsycParam * ga * DeltaPVa) /
+            (LHV * (SlopeFS + PsycParam * (1 + ga / p_gc[k]))) * cf;  // mmol / m^2 / s
+
+        EPenman[k] =
+            (SlopeFS * PhiN_k + LHV * PsycParam * ga * DeltaPVa) /
+            (LHV * (SlopeFS + PsycParam)) * cf;  // mmol / m^2 / s
+
+        EPriestly[k] = 1.26 * (SlopeFS * PhiN_k / (LHV * (SlopeFS + PsycParam))) * cf;  // mmol / m^2 / s
+    }
+
+    return out;
+}
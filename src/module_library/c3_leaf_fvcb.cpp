@@ -0,0 +1,98 @@
+#include "c3_leaf_fvcb.h"
+#include "c3photo.hpp"  // for c3photoC_FvCB, c3_temperature_response_at
+#include "BioCro.h"     // for c3EvapoTrans
+
+using yggdrasilBML::c3_leaf_fvcb;
+
+string_vector c3_leaf_fvcb::get_inputs()
+{
+    return {
+        "incident_ppfd",                // micromol / (m^2 leaf) / s
+        "temp",                         // deg. C
+        "rh",                           // dimensionless
+        "vmax1",                        // micromole / m^2 / s
+        "jmax",                         // micromole / m^2 / s
+        "tpu_rate_max",                 // micromole / m^2 / s
+        "Rd",                           // micromole / m^2 / s
+        "b0",                           // mol / m^2 / s
+        "b1",                           // dimensionless
+        "Gs_min",                       // mol / m^2 / s
+        "Catm",                         // micromole / mol
+        "atmospheric_pressure",         // Pa
+        "O2",                           // mmol / mol
+        "theta",                        // dimensionless
+        "StomataWS",                    // dimensionless
+        "water_stress_approach",        // a dimensionless switch
+        "electrons_per_carboxylation",  // electron / carboxylation
+        "electrons_per_oxygenation",    // electron / oxygenation
+        "average_absorbed_shortwave",   // J / (m^2 leaf) / s
+        "windspeed",                    // m / s
+        "height",                       // m
+        "specific_heat_of_air",         // J / kg / K
+        "minimum_gbw",                  // mol / m^2 / s
+        "windspeed_height",             // m
+        "fvcb_solver_approach"          // a dimensionless switch
+    };
+}
+
+string_vector c3_leaf_fvcb::get_outputs()
+{
+    return {
+        "Assim",             // micromole / m^2 /s
+        "GrossAssim",        // micromole / m^2 /s
+        "Ci",                // micromole / mol
+        "Gs",                // mmol / m^2 / s
+        "iterTimes",         //
+        "TransR",            // mmol / m^2 / s
+        "EPenman",           // mmol / m^2 / s
+        "EPriestly",         // mmol / m^2 / s
+        "leaf_temperature",  // deg. C
+        "gbw"                // mol / m^2 / s
+    };
+}
+
+void c3_leaf_fvcb::do_operation() const
+{
+    // Get an initial estimate of stomatal conductance and Ci, assuming the
+    // leaf is at air temperature
+    const struct c3_str initial_photo =
+        c3photoC_FvCB(
+            c3_temperature_response_at(
+                temp, vmax1, jmax, tpu_rate_max, Rd, theta, O2),
+            incident_ppfd, rh, b0, b1, Gs_min, Catm, atmospheric_pressure,
+            StomataWS, water_stress_approach, electrons_per_carboxylation,
+            electrons_per_oxygenation, 0.0, fvcb_solver_approach);
+
+    // Calculate a new value for leaf temperature using the estimate for
+    // stomatal conductance
+    const struct ET_Str et =
+        c3EvapoTrans(
+            average_absorbed_shortwave, temp, rh, windspeed, height,
+            specific_heat_of_air, initial_photo.Gs, minimum_gbw,
+            windspeed_height);
+
+    double const leaf_temperature = temp + et.Deltat;  // deg. C
+
+    // Calculate final values for assimilation, stomatal conductance, and Ci
+    // using the new leaf temperature, starting from the Ci found at air
+    // temperature
+    const struct c3_str photo =
+        c3photoC_FvCB(
+            c3_temperature_response_at(
+                leaf_temperature, vmax1, jmax, tpu_rate_max, Rd, theta, O2),
+            incident_ppfd, rh, b0, b1, Gs_min, Catm, atmospheric_pressure,
+            StomataWS, water_stress_approach, electrons_per_carboxylation,
+            electrons_per_oxygenation, initial_photo.Ci, fvcb_solver_approach);
+
+    // Update the outputs
+    update(Assim_op, photo.Assim);
+    update(GrossAssim_op, photo.GrossAssim);
+    update(Ci_op, photo.Ci);
+    update(Gs_op, photo.Gs);
+    update(iterTimes_op, photo.iterTimes);
+    update(TransR_op, et.TransR);
+    update(EPenman_op, et.EPenman);
+    update(EPriestly_op, et.EPriestly);
+    update(leaf_temperature_op, leaf_temperature);
+    update(gbw_op, et.boundary_layer_conductance);
+}
@@ -1,16 +1,413 @@
 #include <cmath>      // for pow, sqrt
 #include <algorithm>  // for std::min, std::max
+#include <array>      // for std::array
+#include <atomic>     // for std::atomic
+#include <cstdint>    // for std::uint64_t
+#include <cstring>    // for std::memcpy
 #include <limits>     // fot std::numeric_limits
+#include <stdexcept>  // for std::logic_error
+#include <vector>     // for std::vector
 #include "c3photo.hpp"
 #include "ball_berry.hpp"
 #include "AuxBioCro.h"               // for arrhenius_exponential
-#include "../framework/constants.h"  // for ideal_gas_constant, celsius_to_kelvin
+#include "../framework/constants.h"  // for ideal_gas_constant, celsius_to_kelvin, pi
 #include "ephotosynthesis.h"
 
+namespace
+{
+// Leaf photosynthesis parameters that depend only on leaf temperature, before
+// they are scaled by the values at 25 degrees C; see
+// `c3_temperature_response_at`
+struct c3_temperature_factors {
+    double Kc;                     // micromol / mol
+    double Ko;                     // mmol / mol
+    double Gstar;                  // micromol / mol
+    double Vcmax;                  // dimensionless
+    double Jmax;                   // dimensionless
+    double Rd;                     // dimensionless
+    double theta_linear;           // dimensionless
+    double theta_quadratic;        // dimensionless
+    double dark_adapted_phi_PSII;  // dimensionless
+    double O2_solubility;          // dimensionless
+    double TPU;                    // dimensionless
+};
+
+struct c3_temperature_factors calculate_temperature_factors(
+    double const Tleaf  // degrees C
+)
+{
+    // Get leaf temperature in Kelvin
+    double const Tleaf_K =
+        Tleaf + conversion_constants::celsius_to_kelvin;  // K
+
+    struct c3_temperature_factors f;
+
+    // Temperature corrections are from the following sources:
+    // - Bernacchi et al. (2003) Plant, Cell and Environment, 26(9), 1419-1430.
+    //   https://doi.org/10.1046/j.0016-8025.2003.01050.x
+    // - Bernacchi et al. (2001) Plant, Cell and Environment, 24(2), 253-259.
+    //   https://doi.org/10.1111/j.1365-3040.2001.00668.x
+    // Note: Values in Dubois and Bernacchi are incorrect.
+    f.Kc = arrhenius_exponential(38.05, 79.43e3, Tleaf_K);     // micromol / mol
+    f.Ko = arrhenius_exponential(20.30, 36.38e3, Tleaf_K);     // mmol / mol
+    f.Gstar = arrhenius_exponential(19.02, 37.83e3, Tleaf_K);  // micromol / mol
+    f.Vcmax = arrhenius_exponential(26.35, 65.33e3, Tleaf_K);  // dimensionless
+    f.Jmax = arrhenius_exponential(17.57, 43.54e3, Tleaf_K);   // dimensionless
+    f.Rd = arrhenius_exponential(18.72, 46.39e3, Tleaf_K);     // dimensionless
+
+    f.theta_linear = 0.018 * Tleaf;              // dimensionless
+    f.theta_quadratic = 3.7e-4 * pow(Tleaf, 2);  // dimensionless
+
+    // Light limited
+    f.dark_adapted_phi_PSII =
+        0.352 + 0.022 * Tleaf - 3.4 * pow(Tleaf, 2) / 1e4;  // dimensionless (Bernacchi et al. (2003))
+
+    f.O2_solubility = solo(Tleaf);  // dimensionless
+
+    // TPU rate temperature dependence from Figure 7, Yang et al. (2016) Planta,
+    // 243, 687-698. https://doi.org/10.1007/s00425-015-2436-8
+    //
+    // In Yang et al., the equation in the caption of Figure 7 calculates the
+    // maximum rate of TPU utilization, but here we need the rate relative to
+    // its value at 25 degrees C (as shown in the figure itself). Using the
+    // equation, the rate at 25 degrees C can be found to have the value
+    // 306.742, so here we normalize the equation by this value.
+    double const TPU_c = 25.5;                                               // dimensionless (fitted constant)
+    double const Ha = 62.99e3;                                               // J / mol (enthalpy of activation)
+    double const S = 0.588e3;                                                // J / K / mol (entropy)
+    double const Hd = 182.14e3;                                              // J / mol (enthalpy of deactivation)
+    double const R = physical_constants::ideal_gas_constant;                 // J / K / mol (ideal gas constant)
+    double const top = Tleaf_K * arrhenius_exponential(TPU_c, Ha, Tleaf_K);  // dimensionless
+    double const bot = 1.0 + arrhenius_exponential(S / R, Hd, Tleaf_K);      // dimensionless
+    f.TPU = (top / bot) / 306.742;                                           // dimensionless
+
+    return f;
+}
+
+// Returns the temperature factors for `Tleaf`, reusing a previous calculation
+// when possible. Sunlit and shaded leaves in a canopy layer, the FvCB and
+// ePhotosynthesis solutions for one leaf, and successive evaluations by an
+// ODE solver often use the same leaf temperature, so each thread keeps a
+// small direct-mapped cache of recent results. Entries are matched on the
+// exact bit pattern of `Tleaf` and the stored values are the ones that would
+// be calculated, so the cache never changes a result.
+struct c3_temperature_factors temperature_factors_at(
+    double const Tleaf  // degrees C
+)
+{
+    struct cache_entry {
+        std::uint64_t key;
+        bool valid;
+        struct c3_temperature_factors factors;
+    };
+
+    int const cache_bits = 4;
+    thread_local std::array<cache_entry, 1 << cache_bits> cache{};
+
+    std::uint64_t key;
+    std::memcpy(&key, &Tleaf, sizeof key);
+
+    // Mix the bits of the key so that nearby temperatures, whose bit patterns
+    // differ only in a few places, use different entries
+    std::uint64_t hash = key;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    hash = hash ^ (hash >> 31);
+
+    cache_entry& entry = cache[hash & ((1 << cache_bits) - 1)];
+
+    if (!entry.valid || entry.key != key) {
+        entry.key = key;
+        entry.factors = calculate_temperature_factors(Tleaf);
+        entry.valid = true;
+    }
+
+    return entry.factors;
+}
+}  // namespace
+
 #ifdef WITH_YGGDRASIL
 
+c3photoC_coroutine::c3photoC_coroutine(
+    double const Qp,                   // micromol / m^2 / s
+    double const Tleaf,                // degrees C
+    double const RH,                   // dimensionless
+    double const Rd0,                  // micromol / m^2 / s
+    double const bb0,                  // mol / m^2 / s
+    double const bb1,                  // dimensionless
+    double const Gs_min,               // mol / m^2 / s
+    double const Ca,                   // micromol / mol
+    double const AP,                   // Pa
+    double const StomWS,               // dimensionless
+    int const water_stress_approach,   // (flag)
+    double const enzyme_sf,            // dimensionless
+    int const ci_solver_approach,      // (flag)
+    double const Tol,                  // micromol / m^2 / s
+    struct c3_warm_start const* warm_start
+    )
+    : Qp{Qp},
+      Tleaf{Tleaf},
+      RH{RH},
+      bb0{bb0},
+      bb1{bb1},
+      Gs_min{Gs_min},
+      Ca{Ca <= 0 ? 1e-4 : Ca},
+      AP{AP},
+      StomWS{StomWS},
+      water_stress_approach{water_stress_approach},
+      enzyme_sf{enzyme_sf},
+      use_newton{ci_solver_approach == 1},
+      Tol{Tol},
+      Rd{warm_start ? warm_start->Rd
+                    : Rd0 * temperature_factors_at(Tleaf).Rd},
+      Ca_pa{this->Ca * 1e-6 * AP}
+{
+    // Start from the warm start assimilation when it is available. The first
+    // Ci is found from the supply function so that the convergence check
+    // remains valid even if the warm start was not itself fully converged; for
+    // a converged FvCB solution, this is its Ci.
+    if (warm_start) {
+        co2_assimilation_rate = warm_start->Assim;  // micromol / m^2 / s
+        Ci_pa = std::max(
+            Ca_pa - (co2_assimilation_rate * 1e-6) * 1.6 * AP /
+                        stomatal_conductance(co2_assimilation_rate),
+            1e-5);  // Pa
+    }
+}
+
+// Stomatal conductance as a function of net assimilation, including the water
+// stress adjustment and lower limit
+double c3photoC_coroutine::stomatal_conductance(double assim) const
+{
+    double gs = ball_berry(assim * 1e-6, Ca * 1e-6, RH, bb0, bb1) * 1e-3;  // mol / m^2 / s
+
+    if (water_stress_approach == 1) {
+        gs = Gs_min + StomWS * (gs - Gs_min);  // mol / m^2 / s
+    }
+
+    if (gs <= 0) {
+        gs = 1e-8;  // mol / m^2 / s
+    }
+
+    return gs;
+}
+
+void c3photoC_coroutine::step(double co2_assim_ephoto, double dAdCi)
+{
+    double OldAssim = co2_assimilation_rate;  // micromol / m^2 / s
+    Ci = requested_Ci();                      // micromol / mol
+
+    // TODO: Update ePhotosynthesis param branch w/ penalty from
+    //   Yufeng's branch
+    // penalty          = yggdrasilBML::c3_ephotosynthesis::_safe_get(state, "penalty");
+
+    // Use a secant estimate of the slope of the gross assimilation curve if
+    // the server did not provide it
+    if (use_newton) {
+        if (dAdCi < 0 && previous_Ci >= 0 && Ci != previous_Ci) {
+            dAdCi = (co2_assim_ephoto - previous_assim_ephoto) / (Ci - previous_Ci);
+        }
+        previous_Ci = Ci;
+        previous_assim_ephoto = co2_assim_ephoto;
+    } else {
+        dAdCi = -1.0;
+    }
+
+    //ephoto returns the Gross A, which should not be negative!
+    if (co2_assim_ephoto < 0) {
+        co2_assim_ephoto = 0;
+        dAdCi = 0;
+    }
+    //now we overwrite the FvCB's An, make sure to minus the Rd!
+    co2_assimilation_rate = co2_assim_ephoto - Rd; 
+
+
+    if (water_stress_approach == 0) {
+        co2_assimilation_rate *= StomWS;  // micromol / m^2 / s
+        dAdCi *= StomWS;
+    }
+
+    //Here we hard limit the co2_assimilation_rate because sometimes the ephoto's result 
+    //can be over 300 micromol and cause the ball_berry to stop! 
+    //Why hard limit by 60 micromol? Because
+    //in the multilayer_canopy_integrator.h, we remove any An above 50
+    //So, 60 can make sure this "wrong" result to be removed in the canopy integration
+    if (co2_assimilation_rate > 60.0) {
+        co2_assimilation_rate = 60.0;
+        dAdCi = 0;
+    }
+
+
+    Gs = stomatal_conductance(co2_assimilation_rate);  // mol / m^2 / s
+
+    double const Ci_pa_eval = Ci_pa;  // Pa
+
+    Ci_pa = Ca_pa - (co2_assimilation_rate * 1e-6) * 1.6 * AP / Gs;  // Pa
+
+    if (Ci_pa < 0) {
+        Ci_pa = 1e-5;  // Pa
+    }
+
+    if (use_newton && dAdCi >= 0) {
+        // Solve r(Ci) = Ci - S(A(Ci)) = 0, where S is the supply function
+        // given by the diffusion equation above. The derivative of the
+        // supply function with respect to A includes the response of
+        // stomatal conductance, which is found by a finite difference.
+        double const dGsdA =
+            (stomatal_conductance(co2_assimilation_rate + dA_step) - Gs) / dA_step;  // mol / m^2 / s / (micromol / m^2 / s)
+
+        double const dSdA =
+            -1.6e-6 * AP * (1.0 / Gs - co2_assimilation_rate * dGsdA / (Gs * Gs));  // Pa / (micromol / m^2 / s)
+
+        double const dAdCi_pa = dAdCi * 1e6 / AP;  // (micromol / m^2 / s) / Pa
+
+        double const jacobian = 1.0 - dSdA * dAdCi_pa;  // dimensionless
+
+        // The jacobian is close to 1 for typical leaves since the supply
+        // function is only weakly dependent on assimilation; fall back to
+        // the fixed point if it is small enough to make the step unsafe
+        if (jacobian > 0.1) {
+            double const step = (Ci_pa - Ci_pa_eval) / jacobian;  // Pa
+
+            // Stop when the predicted change in assimilation from the next
+            // step is within tolerance; the current evaluation is then
+            // already consistent with the supply function
+            if (std::abs(dAdCi_pa * step) < Tol) {
+                converged = true;
+                return;
+            }
+
+            Ci_pa = std::max(Ci_pa_eval + step, 1e-5);  // Pa
+            ++iterCounter;
+            return;
+        }
+    }
+
+    if (std::abs(OldAssim - co2_assimilation_rate) < Tol) {
+        converged = true;
+        return;
+    }
+
+    ++iterCounter;
+}
+
+struct c3_str c3photoC_coroutine::result() const
+{
+    struct c3_str result;
+    result.Assim = co2_assimilation_rate;            // micromol / m^2 / s
+    result.Gs = Gs * 1e3;                            // mmol / m^2 / s
+    result.Ci = Ci;                                  // micromol / mol
+    result.GrossAssim = co2_assimilation_rate + Rd;  // micromol / m^2 / s
+    result.iterTimes = double(iterCounter);
+    result.penalty   = penalty;
+    return result;
+}
+
+namespace
+{
+// Add the members of a request to the ePhotosynthesis server
+void add_ephoto_request(
+    rapidjson::Value& request,
+    rapidjson::Document::AllocatorType& allocator,
+    c3photoC_coroutine const& leaf)
+{
+    double const Ci_step = 1.0;  // micromol / mol (finite difference step requested from the server)
+
+    request.AddMember("Tp", leaf.leaf_temperature(), allocator);
+    request.AddMember("CO2_in", leaf.requested_Ci(), allocator);
+    request.AddMember("TestLi", leaf.incident_ppfd(), allocator);
+    request.AddMember("enzyme_sf", leaf.enzyme_scaling_factor(), allocator);
+    if (leaf.wants_slope()) {
+        request.AddMember("CO2_in_step", Ci_step, allocator);
+    }
+}
+
+// Get the slope of the gross assimilation curve from a reply, returning a
+// negative value if it is not available
+template <typename reply_type>
+double get_ephoto_slope(reply_type const& reply)
+{
+    return reply.HasMember("dCO2AR_dCi") && reply["dCO2AR_dCi"].IsDouble()
+               ? reply["dCO2AR_dCi"].GetDouble()
+               : -1.0;  // (micromol / m^2 / s) / (micromol / mol)
+}
+
+// Set to false once the ePhotosynthesis server has replied to a batched
+// message without a `batch` member; later batches are then sent one request at
+// a time from the start. The flag is shared by all threads because they all
+// talk to the same server.
+std::atomic<bool> ephoto_server_accepts_batches(true);
+
+}  // namespace
+
+void c3photoC_resume(
+    YggRpcClient& rpc,
+    c3photoC_coroutine& leaf)
+{
+    //call ephotosynthesis
+    rapidjson::Document state(rapidjson::kObjectType);
+    add_ephoto_request(state, state.GetAllocator(), leaf);
+    yggdrasilBML::c3_ephotosynthesis::call_model(rpc, state);
+    double co2_assim_ephoto = yggdrasilBML::c3_ephotosynthesis::get_doc_member(state, "CO2AR");
+
+    leaf.step(co2_assim_ephoto, get_ephoto_slope(state));
+}
+
+void c3photoC_resume_batch(
+    YggRpcClient& rpc,
+    std::vector<c3photoC_coroutine*> const& leaves)
+{
+    if (leaves.size() == 1 || !ephoto_server_accepts_batches) {
+        for (c3photoC_coroutine* leaf : leaves) {
+            c3photoC_resume(rpc, *leaf);
+        }
+        return;
+    }
+
+    // Send one request for each leaf
+    rapidjson::Document state(rapidjson::kObjectType);
+    rapidjson::Value batch(rapidjson::kArrayType);
+    for (size_t i = 0; i < leaves.size(); ++i) {
+        rapidjson::Value request(rapidjson::kObjectType);
+        add_ephoto_request(request, state.GetAllocator(), *leaves[i]);
+        batch.PushBack(request, state.GetAllocator());
+    }
+    state.AddMember("batch", batch, state.GetAllocator());
+
+    yggdrasilBML::c3_ephotosynthesis::call_model(rpc, state);
+
+    // A server without batch support treats the message as a single request
+    // and does not return a `batch` member. None of the leaves have been
+    // advanced yet, so send their requests again one at a time.
+    if (!(state.IsObject() && state.HasMember("batch"))) {
+        ephoto_server_accepts_batches = false;
+        for (c3photoC_coroutine* leaf : leaves) {
+            c3photoC_resume(rpc, *leaf);
+        }
+        return;
+    }
+
+    if (!(state["batch"].IsArray() &&
+          state["batch"].Size() == leaves.size())) {
+        throw std::logic_error("Thrown by c3photoC_resume_batch: the ePhotosynthesis server did not return one reply for each request in the batch.");
+    }
+
+    // Advance each leaf
+    for (size_t i = 0; i < leaves.size(); ++i) {
+        rapidjson::Value const& reply = state["batch"][i];
+
+        if (!(reply.IsObject() && reply.HasMember("CO2AR") && reply["CO2AR"].IsDouble())) {
+            throw std::logic_error("Thrown by c3photoC_resume_batch: failed to extract \"CO2AR\" from a batch reply.");
+        }
+
+        leaves[i]->step(reply["CO2AR"].GetDouble(), get_ephoto_slope(reply));
+    }
+}
+
 //This is now using the ephoto function
 //the original FvCB has been renamed to c3photoC_FvCB
+//
+//See `c3photoC_coroutine` in c3photo.hpp for a description of the Ci iteration.
 struct c3_str c3photoC(
     YggRpcClient& rpc,
     double const Qp,                           // micromol / m^2 / s
@@ -31,107 +428,108 @@ struct c3_str c3photoC(
     int const water_stress_approach,           // (flag)
     double const electrons_per_carboxylation,  // self-explanatory units
     double const electrons_per_oxygenation,    // self-explanatory units
-    double const enzyme_sf                     // dimensionless 
+    double const enzyme_sf,                    // dimensionless
+    int const ci_solver_approach,              // (flag)
+    double const Tol,                          // micromol / m^2 / s
+    struct c3_warm_start const* warm_start
 )
 {
-    // Get leaf temperature in Kelvin
-    double const Tleaf_K =
-        Tleaf + conversion_constants::celsius_to_kelvin;  // K
-
-    double const Rd = Rd0 * arrhenius_exponential(18.72, 46.39e3, Tleaf_K);        // micromol / m^2 / s
-
-    if (Ca <= 0) {
-        Ca = 1e-4;  // micromol / mol
-    }
-
-    double const Ca_pa = Ca * 1e-6 * AP;  // Pa.
-
-    // Initialize variables before running fixed point iteration in a loop
-    double Gs{};                         // mol / m^2 / s
-    double Ci{};                         // micromol / mol
-    double Ci_pa = 30.0;                  // Pa                 (initial guess)
-    double co2_assimilation_rate = 0.0;  // micromol / m^2 / s (initial guess)
-    double const Tol = 0.01;             // micromol / m^2 / s
-    int iterCounter = 0;
-    int max_iter = 10;
-    double penalty = 0.0;
+    c3photoC_coroutine leaf(
+        Qp, Tleaf, RH, Rd0, bb0, bb1, Gs_min, Ca, AP, StomWS,
+        water_stress_approach, enzyme_sf, ci_solver_approach, Tol, warm_start);
 
     // Run iteration loop
-    while (iterCounter < max_iter) {
-        double OldAssim = co2_assimilation_rate;  // micromol / m^2 / s
-        Ci = (Ci_pa / AP) * 1e6;                  // micromol / mol
-
-        //call ephotosynthesis
-        rapidjson::Document state(rapidjson::kObjectType);
-        state.AddMember("Tp", Tleaf, state.GetAllocator());
-        state.AddMember("CO2_in", Ci, state.GetAllocator());
-        state.AddMember("TestLi", Qp, state.GetAllocator());
-        yggdrasilBML::c3_ephotosynthesis::call_model(rpc, state);
-        double co2_assim_ephoto = yggdrasilBML::c3_ephotosynthesis::get_doc_member(state, "CO2AR");
-        // TODO: Update ePhotosynthesis param branch w/ penalty from
-        //   Yufeng's branch
-        // penalty          = yggdrasilBML::c3_ephotosynthesis::_safe_get(state, "penalty");
-        
-        //ephoto returns the Gross A, which should not be negative!
-        if (co2_assim_ephoto < 0) co2_assim_ephoto = 0 ;
-        //now we overwrite the FvCB's An, make sure to minus the Rd!
-        co2_assimilation_rate = co2_assim_ephoto - Rd; 
-
-
-        if (water_stress_approach == 0) {
-            co2_assimilation_rate *= StomWS;  // micromol / m^2 / s
-        }
-
-        //if(co2_assimilation_rate>300){
-        //   std::cout<< "Tleaf,"<<Tleaf<<std::endl;
-        //   std::cout<< "Qp,"<<Qp<<std::endl;
-        //   std::cout<< "Ca,"<<Ca<<std::endl;
-        //   std::cout<< "Ci,"<<Ci<<std::endl;
-        //   std::cout<< "Gs,"<<Gs<<std::endl;
-        //   std::cout<< "iterCounter "<<iterCounter<<std::endl;
-        //}
-        //Here we hard limit the co2_assimilation_rate because sometimes the ephoto's result 
-        //can be over 300 micromol and cause the ball_berry to stop! 
-        //Why hard limit by 60 micromol? Because
-        //in the multilayer_canopy_integrator.h, we remove any An above 50
-        //So, 60 can make sure this "wrong" result to be removed in the canopy integration
-        co2_assimilation_rate = std::min(co2_assimilation_rate,60.0);
-        
-
-        Gs = ball_berry(co2_assimilation_rate * 1e-6, Ca * 1e-6, RH, bb0, bb1) * 1e-3;  // mol / m^2 / s
-
-        if (water_stress_approach == 1) {
-            Gs = Gs_min + StomWS * (Gs - Gs_min);  // mol / m^2 / s
-        }
+    while (!leaf.done()) {
+        c3photoC_resume(rpc, leaf);
+    }
 
-        if (Gs <= 0) {
-            Gs = 1e-8;  // mol / m^2 / s
-        }
+    return leaf.result();
+}
 
-        Ci_pa = Ca_pa - (co2_assimilation_rate * 1e-6) * 1.6 * AP / Gs;  // Pa
+//Solves the same problem as `c3photoC` for several values of `enzyme_sf` at
+//once. All leaves that have not yet converged are sent to the ePhotosynthesis
+//server in a single message per iteration using `c3photoC_resume_batch`,
+//where each request has the same members as in `c3photoC`, including its own
+//`enzyme_sf` value.
+std::vector<struct c3_str> c3photoC_batch(
+    YggRpcClient& rpc,
+    double const Qp,                       // micromol / m^2 / s
+    double const Tleaf,                    // degrees C
+    double const RH,                       // dimensionless
+    double const Rd0,                      // micromol / m^2 / s
+    double const bb0,                      // mol / m^2 / s
+    double const bb1,                      // dimensionless
+    double const Gs_min,                   // mol / m^2 / s
+    double Ca,                             // micromol / mol
+    double const AP,                       // Pa
+    double const StomWS,                   // dimensionless
+    int const water_stress_approach,       // (flag)
+    std::vector<double> const& enzyme_sf,  // dimensionless
+    int const ci_solver_approach,          // (flag)
+    double const Tol,                      // micromol / m^2 / s
+    struct c3_warm_start const* warm_start
+)
+{
+    std::vector<c3photoC_coroutine> leaves;
+    for (double const sf : enzyme_sf) {
+        leaves.push_back(c3photoC_coroutine(
+            Qp, Tleaf, RH, Rd0, bb0, bb1, Gs_min, Ca, AP, StomWS,
+            water_stress_approach, sf, ci_solver_approach, Tol, warm_start));
+    }
 
-        if (Ci_pa < 0) {
-            Ci_pa = 1e-5;  // Pa
+    while (true) {
+        // Find the leaves that have not converged
+        std::vector<c3photoC_coroutine*> active;
+        for (c3photoC_coroutine& leaf : leaves) {
+            if (!leaf.done()) {
+                active.push_back(&leaf);
+            }
         }
 
-        if (abs(OldAssim - co2_assimilation_rate) < Tol) {
+        if (active.empty()) {
             break;
         }
 
-        ++iterCounter;
+        c3photoC_resume_batch(rpc, active);
     }
-    struct c3_str result;
-    result.Assim = co2_assimilation_rate;            // micromol / m^2 / s
-    result.Gs = Gs * 1e3;                            // mmol / m^2 / s
-    result.Ci = Ci;                                  // micromol / mol
-    result.GrossAssim = co2_assimilation_rate + Rd;  // micromol / m^2 / s
-    result.iterTimes = double(iterCounter);
-    result.penalty   = penalty;
-    return result;
+
+    std::vector<struct c3_str> results;
+    for (c3photoC_coroutine const& leaf : leaves) {
+        results.push_back(leaf.result());
+    }
+    return results;
 }
 
 #endif // WITH_YGGDRASIL
 
+struct c3_temperature_response c3_temperature_response_at(
+    double const Tleaf,         // degrees C
+    double const Vcmax0,        // micromol / m^2 / s
+    double const Jmax0,         // micromol / m^2 / s
+    double const TPU_rate_max,  // micromol / m^2 / s
+    double const Rd0,           // micromol / m^2 / s
+    double const thet,          // dimensionless
+    double const O2             // millimol / mol (atmospheric oxygen mole fraction)
+)
+{
+    const struct c3_temperature_factors f = temperature_factors_at(Tleaf);
+
+    struct c3_temperature_response tr;
+
+    tr.Kc = f.Kc;                                          // micromol / mol
+    tr.Ko = f.Ko;                                          // mmol / mol
+    tr.Gstar = f.Gstar;                                    // micromol / mol
+    tr.Vcmax = Vcmax0 * f.Vcmax;                           // micromol / m^2 / s
+    tr.Jmax = Jmax0 * f.Jmax;                              // micromol / m^2 / s
+    tr.Rd = Rd0 * f.Rd;                                    // micromol / m^2 / s
+    tr.theta = thet + f.theta_linear - f.theta_quadratic;  // dimensionless
+    tr.dark_adapted_phi_PSII = f.dark_adapted_phi_PSII;    // dimensionless
+    tr.Oi = O2 * f.O2_solubility;                          // mmol / mol
+    tr.TPU = TPU_rate_max * f.TPU;                         // micromol / m^2 / s
+
+    return tr;
+}
+
 struct c3_str c3photoC_FvCB(
     double const Qp,                           // micromol / m^2 / s
     double const Tleaf,                        // degrees C
@@ -153,128 +551,160 @@ struct c3_str c3photoC_FvCB(
     double const electrons_per_oxygenation     // self-explanatory units
 )
 {
-    // Get leaf temperature in Kelvin
-    double const Tleaf_K =
-        Tleaf + conversion_constants::celsius_to_kelvin;  // K
+    return c3photoC_FvCB(
+        c3_temperature_response_at(Tleaf, Vcmax0, Jmax0, TPU_rate_max, Rd0, thet, O2),
+        Qp, RH, bb0, bb1, Gs_min, Ca, AP, StomWS, water_stress_approach,
+        electrons_per_carboxylation, electrons_per_oxygenation, 0.0);
+}
 
+namespace
+{
+// The fixed point iteration used by `c3photoC_FvCB`. The effect of water
+// stress is determined by the template parameters rather than by
+// `water_stress_approach`, so the compiler can remove the unused adjustments
+// from the loop:
+// - `stress_assimilation` multiplies the net assimilation rate by `StomWS`
+//   (`water_stress_approach` = 0)
+// - `stress_conductance` moves the stomatal conductance towards `Gs_min` by a
+//   factor of `StomWS` (`water_stress_approach` = 1)
+//
+// Quantities that do not depend on Ci are calculated once before the loop,
+// and the remaining choices between limiting rates are simple selections.
+//
+// When `accelerate` is true, Ci is updated using the last two points rather
+// than the last one (Anderson acceleration with a history of one point, which
+// for a scalar iteration is a secant step on the fixed point residual). The
+// residual decreases with Ci, so the points where it is positive and negative
+// also bracket the solution; if an accelerated step leaves the bracket, the
+// bracket is bisected instead. Because Ci can move far in one step, the
+// iteration also requires the new Ci to be consistent with the supply
+// function before it stops. The residual can fail to change sign smoothly in
+// unphysical conditions (for example, when the quantum yield of PSII is
+// negative at very low temperatures), so if the accelerated iteration has not
+// converged after 100 steps, the ordinary iteration is used from there on.
+template <bool stress_assimilation, bool stress_conductance>
+struct c3_str c3photoC_FvCB_fixed_point(
+    struct c3_temperature_response const& tr,
+    double const Qp,                           // micromol / m^2 / s
+    double const RH,                           // dimensionless
+    double const bb0,                          // mol / m^2 / s
+    double const bb1,                          // dimensionless
+    double const Gs_min,                       // mol / m^2 / s
+    double Ca,                                 // micromol / mol
+    double const AP,                           // Pa
+    double const StomWS,                       // dimensionless
+    double const electrons_per_carboxylation,  // self-explanatory units
+    double const electrons_per_oxygenation,    // self-explanatory units
+    double const Ci_initial,                   // micromol / mol
+    bool const accelerate
+)
+{
     // Define the leaf reflectance
     double const leaf_reflectance = 0.2;  // dimensionless
 
-    // Temperature corrections are from the following sources:
-    // - Bernacchi et al. (2003) Plant, Cell and Environment, 26(9), 1419-1430.
-    //   https://doi.org/10.1046/j.0016-8025.2003.01050.x
-    // - Bernacchi et al. (2001) Plant, Cell and Environment, 24(2), 253-259.
-    //   https://doi.org/10.1111/j.1365-3040.2001.00668.x
-    // Note: Values in Dubois and Bernacchi are incorrect.
-    double const Kc = arrhenius_exponential(38.05, 79.43e3, Tleaf_K);              // micromol / mol
-    double const Ko = arrhenius_exponential(20.30, 36.38e3, Tleaf_K);              // mmol / mol
-    double const Gstar = arrhenius_exponential(19.02, 37.83e3, Tleaf_K);           // micromol / mol
-    double const Vcmax = Vcmax0 * arrhenius_exponential(26.35, 65.33e3, Tleaf_K);  // micromol / m^2 / s
-    double const Jmax = Jmax0 * arrhenius_exponential(17.57, 43.54e3, Tleaf_K);    // micromol / m^2 / s
-    double const Rd = Rd0 * arrhenius_exponential(18.72, 46.39e3, Tleaf_K);        // micromol / m^2 / s
-
-    double const theta = thet + 0.018 * Tleaf - 3.7e-4 * pow(Tleaf, 2);  // dimensionless
-
-    // Light limited
-    double const dark_adapted_phi_PSII =
-        0.352 + 0.022 * Tleaf - 3.4 * pow(Tleaf, 2) / 1e4;  // dimensionless (Bernacchi et al. (2003))
+    // Temperature-dependent parameters
+    double const Kc = tr.Kc;        // micromol / mol
+    double const Ko = tr.Ko;        // mmol / mol
+    double const Gstar = tr.Gstar;  // micromol / mol
+    double const Vcmax = tr.Vcmax;  // micromol / m^2 / s
+    double const Jmax = tr.Jmax;    // micromol / m^2 / s
+    double const Rd = tr.Rd;        // micromol / m^2 / s
+    double const theta = tr.theta;  // dimensionless
+    double const Oi = tr.Oi;        // mmol / mol
+    double const TPU = tr.TPU;      // micromol / m^2 / s
 
     double const I2 =
-        Qp * dark_adapted_phi_PSII * (1.0 - leaf_reflectance) / 2.0;  // micromol / m^2 / s
+        Qp * tr.dark_adapted_phi_PSII * (1.0 - leaf_reflectance) / 2.0;  // micromol / m^2 / s
 
     double const J =
         (Jmax + I2 - sqrt(pow(Jmax + I2, 2) - 4.0 * theta * I2 * Jmax)) /
         (2.0 * theta);  // micromol / m^2 / s
 
-    double const Oi = O2 * solo(Tleaf);  // mmol / mol
-
     if (Ca <= 0) {
         Ca = 1e-4;  // micromol / mol
     }
 
     double const Ca_pa = Ca * 1e-6 * AP;  // Pa.
 
-    // TPU rate temperature dependence from Figure 7, Yang et al. (2016) Planta,
-    // 243, 687-698. https://doi.org/10.1007/s00425-015-2436-8
-    //
-    // In Yang et al., the equation in the caption of Figure 7 calculates the
-    // maximum rate of TPU utilization, but here we need the rate relative to
-    // its value at 25 degrees C (as shown in the figure itself). Using the
-    // equation, the rate at 25 degrees C can be found to have the value
-    // 306.742, so here we normalize the equation by this value.
-    double const TPU_c = 25.5;                                               // dimensionless (fitted constant)
-    double const Ha = 62.99e3;                                               // J / mol (enthalpy of activation)
-    double const S = 0.588e3;                                                // J / K / mol (entropy)
-    double const Hd = 182.14e3;                                              // J / mol (enthalpy of deactivation)
-    double const R = physical_constants::ideal_gas_constant;                 // J / K / mol (ideal gas constant)
-    double const top = Tleaf_K * arrhenius_exponential(TPU_c, Ha, Tleaf_K);  // dimensionless
-    double const bot = 1.0 + arrhenius_exponential(S / R, Hd, Tleaf_K);      // dimensionless
-    double TPU_rate_multiplier = (top / bot) / 306.742;                      // dimensionless
-
-    double TPU = TPU_rate_max * TPU_rate_multiplier;  // micromol / m^2 / s
-
     // The alpha constant for calculating Ap is from Eq. 2.26, von Caemmerer, S.
     // Biochemical models of leaf photosynthesis.
     double const alpha_TPU = 0.0;  // dimensionless. Without more information, alpha=0 is often assumed.
 
+    // Michaelis-Menten constant for carboxylation in the presence of oxygen
+    double const Kco = Kc * (1.0 + Oi / Ko);  // micromol / mol
+
+    // Triose-phosphate-utilization-limited carboxylation rate has an asymptote
+    // at this value of Ci, and TPU cannot limit the carboxylation rate for
+    // values of Ci below it
+    double const Ci_TPU = Gstar * (1.0 + 3.0 * alpha_TPU);  // micromol / mol
+
+    // Calculate the net CO2 assimilation rate at Ci = 0 using the method
+    // described in "Avoiding Pitfalls When Using the FvCB Model": the maximum
+    // of the RuBP-saturated and RuBP-regeneration-limited rates
+    double const Ac0 = -Gstar * Vcmax / Kco - Rd;                    // micromol / m^2 / s
+    double const Aj0 = -J / (2.0 * electrons_per_oxygenation) - Rd;  // micromol / m^2 / s
+    double const A0 = std::max(Ac0, Aj0);                            // micromol / m^2 / s
+
     // Initialize variables before running fixed point iteration in a loop
-    double Gs{};                         // mol / m^2 / s
-    double Ci{};                         // micromol / mol
-    double Ci_pa = 0.0;                  // Pa                 (initial guess)
-    double co2_assimilation_rate = 0.0;  // micromol / m^2 / s (initial guess)
-    double const Tol = 0.01;             // micromol / m^2 / s
+    double Gs{};                                          // mol / m^2 / s
+    double Ci{};                                          // micromol / mol
+    double Ci_pa = std::max(Ci_initial, 0.0) * 1e-6 * AP;  // Pa                 (initial guess)
+    double co2_assimilation_rate = 0.0;                   // micromol / m^2 / s (initial guess)
+    double const Tol = 0.01;                              // micromol / m^2 / s
     int iterCounter = 0;
     int max_iter = 1000;
+    int const max_accelerated_iter = 100;
+
+    // The previous point and its fixed point residual, along with the
+    // bracket around the solution, used for acceleration
+    bool have_previous = false;
+    double previous_Ci_pa = 0.0;     // Pa
+    double previous_residual = 0.0;  // Pa
+    double Ci_pa_low = 0.0;          // Pa (residual is positive)
+    double Ci_pa_high = std::numeric_limits<double>::infinity();  // Pa (residual is negative)
 
     // Run iteration loop
     while (iterCounter < max_iter) {
         double OldAssim = co2_assimilation_rate;  // micromol / m^2 / s
+        double const Ci_pa_used = Ci_pa;          // Pa
+
+        bool const accelerating = accelerate && iterCounter < max_accelerated_iter;
         Ci = (Ci_pa / AP) * 1e6;                  // micromol / mol
 
-        // Calculate the net CO2 assimilation rate using the method described in
-        // "Avoiding Pitfalls When Using the FvCB Model"
-        if (Ci == 0.0) {
-            // RuBP-saturated net assimilation rate when Ci is 0
-            double Ac0 = -Gstar * Vcmax / (Kc * (1 + Oi / Ko)) - Rd;  // micromol / m^2 / s
+        // RuBP-saturated carboxylation rate
+        double const Wc = Vcmax * Ci / (Ci + Kco);  // micromol / m^2 / s
 
-            // RuBP-regeneration-limited net assimilation when C is 0
-            double Aj0 =
-                -J / (2.0 * electrons_per_oxygenation) - Rd;  // micromol / m^2 / s
+        // RuBP-regeneration-limited carboxylation rate
+        double const Wj = J * Ci /
+                          (electrons_per_carboxylation * Ci +
+                           2.0 * electrons_per_oxygenation * Gstar);  // micromol / m^2 / s
 
-            co2_assimilation_rate = std::max(Ac0, Aj0);  // micromol / m^2 / s
-        } else {
-            // RuBP-saturated carboxylation rate
-            double Wc = Vcmax * Ci /
-                        (Ci + Kc * (1.0 + Oi / Ko));  // micromol / m^2 / s
-
-            // RuBP-regeneration-limited carboxylation rate
-            double Wj = J * Ci /
-                        (electrons_per_carboxylation * Ci +
-                         2.0 * electrons_per_oxygenation * Gstar);  // micromol / m^2 / s
-
-            // Triose-phosphate-utilization-limited carboxylation rate. There is
-            // an asymptote at Ci = Gstar * (1 + 3 * alpha_TPU), and TPU cannot
-            // limit the carboxylation rate for values of Ci below this
-            // asymptote. A simple way to handle this is to make Wp infinite for
-            // Ci <= Gstar * (1 + 3 * alpha_TPU), so that it is never limiting
-            // in this case.
-            double Wp = Ci > Gstar * (1.0 + 3.0 * alpha_TPU)
-                            ? 3.0 * TPU * Ci / (Ci - Gstar * (1.0 + 3.0 * alpha_TPU))
-                            : std::numeric_limits<double>::infinity();  // micromol / m^2 / s
-
-            // Limiting carboxylation rate
-            double Vc = std::min(Wc, std::min(Wj, Wp));  // micromol / m^2 / s
-
-            co2_assimilation_rate = (1.0 - Gstar / Ci) * Vc - Rd;  // micromol / m^2 / s
-        }
+        // Triose-phosphate-utilization-limited carboxylation rate, which is
+        // made infinite below its asymptote so that it is never limiting there
+        double const Wp = Ci > Ci_TPU
+                              ? 3.0 * TPU * Ci / (Ci - Ci_TPU)
+                              : std::numeric_limits<double>::infinity();  // micromol / m^2 / s
+
+        // Limiting carboxylation rate
+        double const Vc = std::min(Wc, std::min(Wj, Wp));  // micromol / m^2 / s
 
-        if (water_stress_approach == 0) {
+        co2_assimilation_rate = Ci == 0.0
+                                    ? A0
+                                    : (1.0 - Gstar / Ci) * Vc - Rd;  // micromol / m^2 / s
+
+        if (stress_assimilation) {
             co2_assimilation_rate *= StomWS;  // micromol / m^2 / s
         }
 
-        Gs = ball_berry(co2_assimilation_rate * 1e-6, Ca * 1e-6, RH, bb0, bb1) * 1e-3;  // mol / m^2 / s
+        if (ball_berry_check(co2_assimilation_rate * 1e-6, Ca * 1e-6) != ball_berry_ok) {
+            throw_ball_berry_range_error();
+        }
 
-        if (water_stress_approach == 1) {
+        Gs = ball_berry_unchecked(
+                 co2_assimilation_rate * 1e-6, Ca * 1e-6, RH, bb0, bb1) *
+             1e-3;  // mol / m^2 / s
+
+        if (stress_conductance) {
             Gs = Gs_min + StomWS * (Gs - Gs_min);  // mol / m^2 / s
         }
 
@@ -288,10 +718,48 @@ struct c3_str c3photoC_FvCB(
             Ci_pa = 1e-5;  // Pa
         }
 
-        if (abs(OldAssim - co2_assimilation_rate) < Tol) {
+        // With acceleration, Ci can move far enough in one step that the
+        // assimilation rate is unchanged even though Ci is not yet consistent
+        // with the supply function (for example, when TPU is limiting), so
+        // the difference between the net assimilation rate and the rate
+        // implied by the new Ci must also be small
+        double const supply_residual =
+            accelerating ? (Ci_pa_used - Ci_pa) * 1e6 * Gs / (1.6 * AP)
+                       : 0.0;  // micromol / m^2 / s
+
+        if (std::abs(OldAssim - co2_assimilation_rate) < Tol &&
+            std::abs(supply_residual) < Tol) {
             break;
         }
 
+        if (accelerating) {
+            double const residual = Ci_pa - Ci_pa_used;  // Pa
+
+            if (residual > 0) {
+                Ci_pa_low = std::max(Ci_pa_low, Ci_pa_used);  // Pa
+            } else if (residual < 0) {
+                Ci_pa_high = std::min(Ci_pa_high, Ci_pa_used);  // Pa
+            }
+
+            if (have_previous && residual != previous_residual) {
+                // Anderson step with a history of one point
+                double const gamma = residual / (residual - previous_residual);  // dimensionless
+                Ci_pa = Ci_pa_used - gamma * (Ci_pa_used - previous_Ci_pa);        // Pa
+            }
+
+            // Fall back to bisection when the new value is not inside the
+            // bracket
+            if (!(Ci_pa > Ci_pa_low && Ci_pa < Ci_pa_high)) {
+                Ci_pa = std::isfinite(Ci_pa_high)
+                            ? 0.5 * (Ci_pa_low + Ci_pa_high)
+                            : std::max(Ci_pa, 1e-5);  // Pa
+            }
+
+            have_previous = true;
+            previous_Ci_pa = Ci_pa_used;    // Pa
+            previous_residual = residual;  // Pa
+        }
+
         ++iterCounter;
     }
 
@@ -300,6 +768,745 @@ struct c3_str c3photoC_FvCB(
     result.Gs = Gs * 1e3;                            // mmol / m^2 / s
     result.Ci = Ci;                                  // micromol / mol
     result.GrossAssim = co2_assimilation_rate + Rd;  // micromol / m^2 / s
+    result.iterTimes = double(iterCounter);
+    result.penalty = 0.0;
+    return result;
+}
+}  // namespace
+
+// This version of the FvCB solver uses temperature-dependent parameters that
+// have already been calculated, and starts the Ci iteration from `Ci_initial`
+// (for example, a solution at a nearby temperature) rather than from zero.
+// When `fvcb_solver_approach` is 1, `c3photoC_FvCB_analytic` is used instead
+// of the fixed point iteration and `Ci_initial` is ignored. When it is 2, the
+// fixed point iteration is accelerated.
+struct c3_str c3photoC_FvCB(
+    struct c3_temperature_response const& tr,
+    double const Qp,                           // micromol / m^2 / s
+    double const RH,                           // dimensionless
+    double const bb0,                          // mol / m^2 / s
+    double const bb1,                          // dimensionless
+    double const Gs_min,                       // mol / m^2 / s
+    double Ca,                                 // micromol / mol
+    double const AP,                           // Pa
+    double const StomWS,                       // dimensionless
+    int const water_stress_approach,           // (flag)
+    double const electrons_per_carboxylation,  // self-explanatory units
+    double const electrons_per_oxygenation,    // self-explanatory units
+    double const Ci_initial,                   // micromol / mol
+    int const fvcb_solver_approach             // (flag)
+)
+{
+    if (fvcb_solver_approach == 1) {
+        return c3photoC_FvCB_analytic(
+            tr, Qp, RH, bb0, bb1, Gs_min, Ca, AP, StomWS, water_stress_approach,
+            electrons_per_carboxylation, electrons_per_oxygenation);
+    }
+
+    bool const accelerate = fvcb_solver_approach == 2;
+
+    // Choose a version of the fixed point iteration where the water stress
+    // adjustments are fixed at compile time, so the loop does not need to
+    // check `water_stress_approach`
+    switch (water_stress_approach) {
+        case 0:
+            return c3photoC_FvCB_fixed_point<true, false>(
+                tr, Qp, RH, bb0, bb1, Gs_min, Ca, AP, StomWS,
+                electrons_per_carboxylation, electrons_per_oxygenation,
+                Ci_initial, accelerate);
+        case 1:
+            return c3photoC_FvCB_fixed_point<false, true>(
+                tr, Qp, RH, bb0, bb1, Gs_min, Ca, AP, StomWS,
+                electrons_per_carboxylation, electrons_per_oxygenation,
+                Ci_initial, accelerate);
+        default:
+            return c3photoC_FvCB_fixed_point<false, false>(
+                tr, Qp, RH, bb0, bb1, Gs_min, Ca, AP, StomWS,
+                electrons_per_carboxylation, electrons_per_oxygenation,
+                Ci_initial, accelerate);
+    }
+}
+
+namespace
+{
+// Returns the real roots of c3 * x^3 + c2 * x^2 + c1 * x + c0 = 0, where c3
+// is not zero. Each root is polished with a few Newton steps.
+std::vector<double> real_cubic_roots(double c3, double c2, double c1, double c0)
+{
+    double const a = c2 / c3;
+    double const b = c1 / c3;
+    double const c = c0 / c3;
+
+    // Substitute x = t - a / 3 to get the depressed cubic t^3 + p * t + q = 0
+    double const p = b - a * a / 3.0;
+    double const q = 2.0 * a * a * a / 27.0 - a * b / 3.0 + c;
+    double const disc = q * q / 4.0 + p * p * p / 27.0;
+
+    std::vector<double> roots;
+    if (disc > 0) {
+        // One real root (Cardano)
+        double const s = std::sqrt(disc);
+        roots.push_back(std::cbrt(-q / 2.0 + s) + std::cbrt(-q / 2.0 - s) - a / 3.0);
+    } else if (p == 0) {
+        roots.push_back(-a / 3.0);
+    } else {
+        // Three real roots (trigonometric method)
+        double const m = 2.0 * std::sqrt(-p / 3.0);
+        double const arg = std::max(-1.0, std::min(1.0, 3.0 * q / (p * m)));
+        double const theta = std::acos(arg) / 3.0;
+        for (int k = 0; k < 3; ++k) {
+            roots.push_back(m * std::cos(theta - 2.0 * math_constants::pi * k / 3.0) - a / 3.0);
+        }
+    }
+
+    for (double& x : roots) {
+        for (int i = 0; i < 3; ++i) {
+            double const f = ((x + a) * x + b) * x + c;
+            double const df = (3.0 * x + 2.0 * a) * x + b;
+            if (df == 0) {
+                break;
+            }
+            x -= f / df;
+        }
+    }
+
+    return roots;
+}
+
+// Relative humidity at the leaf surface from the Ball-Berry model; see
+// `ball_berry` for details
+double ball_berry_surface_humidity(
+    double const assim,  // micromol / m^2 / s
+    double const Cs,     // micromol / mol
+    double const RH,     // dimensionless
+    double const bb0,    // mol / m^2 / s
+    double const bb1     // dimensionless
+)
+{
+    double const gbw = 1.2;  // mol / m^2 / s (as in `ball_berry`)
+
+    double const acs = std::max(assim / Cs, 1e-6);  // dimensionless
+
+    double const a = bb1 * acs;
+    double const b = bb0 + gbw - bb1 * acs;
+    double const c = -RH * gbw - bb0;
+
+    return (-b + std::sqrt(b * b - 4 * a * c)) / (2 * a);  // dimensionless
+}
+
+// Parameters of the coupled photosynthesis and stomatal conductance problem
+// that do not depend on the limiting process
+struct coupled_leaf {
+    double Ca;         // micromol / mol
+    double Gstar;      // micromol / mol
+    double RH;         // dimensionless
+    double bb0;        // mol / m^2 / s
+    double bb1;        // dimensionless
+    double Gs_min;     // mol / m^2 / s
+    double StomWS;     // dimensionless
+    int water_stress_approach;
+    double Rd;         // micromol / m^2 / s
+};
+
+// Stomatal conductance (mol / m^2 / s) for a net assimilation rate `assim`
+// and leaf surface humidity `hs`, including the water stress adjustment and
+// lower limits applied by `c3photoC_FvCB`
+double coupled_stomatal_conductance(coupled_leaf const& leaf, double assim, double hs)
+{
+    double const k = 1.4 / 1.2;  // dimensionless (as in `ball_berry`)
+
+    double gs = assim > 0
+                    ? leaf.bb1 * hs * assim / (leaf.Ca - k * assim) + leaf.bb0
+                    : leaf.bb0;  // mol / m^2 / s
+
+    if (gs <= 0) {
+        gs = 1e-2;  // mol / m^2 / s
+    }
+
+    if (leaf.water_stress_approach == 1) {
+        gs = leaf.Gs_min + leaf.StomWS * (gs - leaf.Gs_min);  // mol / m^2 / s
+    }
+
+    if (gs <= 0) {
+        gs = 1e-8;  // mol / m^2 / s
+    }
+
+    return gs;
+}
+
+// Solves the coupled problem for a single limiting process, where the net
+// assimilation rate is given by
+//
+//   A = s * (vmax * (Ci - Gstar) / (Ci + d) - Rd)
+//
+// and s is StomWS when the water stress approach is 0 (and 1 otherwise). The
+// supply function is Ci = Ca - 1.6 * A / gs, where gs is given by the
+// Ball-Berry model with a fixed leaf surface humidity `hs`. Writing
+// gs = D(A) / (Ca - k * A) with D linear in A, and Ci = N(A) / D(A) with N
+// quadratic in A, the demand and supply functions are consistent when
+//
+//   (A + s * Rd) * (N + d * D) = s * vmax * (N - Gstar * D),
+//
+// which is a cubic in A. For A <= 0, gs does not depend on A and this becomes
+// a quadratic. Returns false if there is no physically meaningful root.
+bool solve_coupled_limitation(
+    coupled_leaf const& leaf,
+    double const vmax,  // micromol / m^2 / s
+    double const d,     // micromol / mol
+    double const hs,    // dimensionless
+    double& assim       // micromol / m^2 / s
+)
+{
+    double const s = leaf.water_stress_approach == 0 ? leaf.StomWS : 1.0;
+    double const u = s * vmax;     // micromol / m^2 / s
+    double const r = s * leaf.Rd;  // micromol / m^2 / s
+    double const k = 1.4 / 1.2;    // dimensionless (as in `ball_berry`)
+    double const Ca = leaf.Ca;
+    double const G = leaf.Gstar;
+
+    // Effective Ball-Berry parameters after the water stress adjustment
+    double const W = leaf.water_stress_approach == 1 ? leaf.StomWS : 1.0;
+    double const g0 = leaf.water_stress_approach == 1
+                          ? leaf.Gs_min + W * (leaf.bb0 - leaf.Gs_min)
+                          : leaf.bb0;  // mol / m^2 / s
+    double const g1 = W * leaf.bb1;    // dimensionless
+
+    // Positive branch: D = d0 + d1 * A and N = n0 + n1 * A + n2 * A^2
+    double const d0 = g0 * Ca;
+    double const d1 = g1 * hs - g0 * k;
+    double const n0 = Ca * d0;
+    double const n1 = Ca * d1 - 1.6 * Ca;
+    double const n2 = 1.6 * k;
+
+    double const m0 = n0 + d * d0;
+    double const m1 = n1 + d * d1;
+    double const m2 = n2;
+
+    double const p0 = u * (n0 - G * d0);
+    double const p1 = u * (n1 - G * d1);
+    double const p2 = u * n2;
+
+    bool found = false;
+    for (double A : real_cubic_roots(m2, m1 + r * m2 - p2, m0 + r * m1 - p1, r * m0 - p0)) {
+        double const D = d0 + d1 * A;
+        double const Cs = Ca - k * A;
+        if (A > 0 && Cs > 0 && D > 0 && (n0 + n1 * A + n2 * A * A) / D > 0 &&
+            coupled_stomatal_conductance(leaf, A, hs) > 1e-8 &&
+            (!found || A < assim)) {
+            assim = A;
+            found = true;
+        }
+    }
+
+    if (found) {
+        return true;
+    }
+
+    // Non-positive branch: Ci = Ca - e * A, giving a quadratic in A
+    double const e = 1.6 / coupled_stomatal_conductance(leaf, 0.0, hs);  // (micromol / mol) / (micromol / m^2 / s)
+
+    double const qa = -e;
+    double const qb = Ca + d - e * r + u * e;
+    double const qc = r * (Ca + d) - u * (Ca - G);
+
+    double const root_term = qb * qb - 4 * qa * qc;
+    if (root_term < 0) {
+        return false;
+    }
+
+    for (double sign : {-1.0, 1.0}) {
+        double const A = (-qb + sign * std::sqrt(root_term)) / (2 * qa);
+        if (A <= 0 && Ca - e * A > 0 && Ca - e * A + d > 0 && (!found || A > assim)) {
+            assim = A;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+}  // namespace
+
+// This version of the FvCB solver finds the consistent net assimilation rate
+// for each limiting process (RuBP-saturated, RuBP-regeneration-limited, and
+// TPU-limited) directly from the roots of a polynomial (see
+// `solve_coupled_limitation`), rather than by iterating between the FvCB model
+// and the Ball-Berry model. Since the supply function decreases and each
+// demand function increases with Ci, the coupled rate is the smallest of the
+// individual rates.
+//
+// The leaf surface humidity used by the Ball-Berry model depends weakly on the
+// assimilation rate, so it is updated in a short outer loop; the number of
+// outer iterations is reported as `iterTimes`. If no physically meaningful
+// root can be found, the iterative solver is used instead.
+struct c3_str c3photoC_FvCB_analytic(
+    struct c3_temperature_response const& tr,
+    double const Qp,                           // micromol / m^2 / s
+    double const RH,                           // dimensionless
+    double const bb0,                          // mol / m^2 / s
+    double const bb1,                          // dimensionless
+    double const Gs_min,                       // mol / m^2 / s
+    double Ca,                                 // micromol / mol
+    double const AP,                           // Pa
+    double const StomWS,                       // dimensionless
+    int const water_stress_approach,           // (flag)
+    double const electrons_per_carboxylation,  // self-explanatory units
+    double const electrons_per_oxygenation     // self-explanatory units
+)
+{
+    // Define the leaf reflectance
+    double const leaf_reflectance = 0.2;  // dimensionless
+
+    double const I2 =
+        Qp * tr.dark_adapted_phi_PSII * (1.0 - leaf_reflectance) / 2.0;  // micromol / m^2 / s
+
+    double const J =
+        (tr.Jmax + I2 - sqrt(pow(tr.Jmax + I2, 2) - 4.0 * tr.theta * I2 * tr.Jmax)) /
+        (2.0 * tr.theta);  // micromol / m^2 / s
+
+    if (Ca <= 0) {
+        Ca = 1e-4;  // micromol / mol
+    }
+
+    coupled_leaf const leaf{
+        Ca, tr.Gstar, RH, bb0, bb1, Gs_min, StomWS, water_stress_approach, tr.Rd};
+
+    double const s = water_stress_approach == 0 ? StomWS : 1.0;
+    double const k = 1.4 / 1.2;  // dimensionless (as in `ball_berry`)
+
+    // The coupled rate for a given leaf surface humidity
+    auto coupled_rate = [&](double hs, double& assim) -> bool {
+        // RuBP-saturated and RuBP-regeneration-limited rates
+        double Ac{};
+        double Aj{};
+        if (!solve_coupled_limitation(leaf, tr.Vcmax, tr.Kc * (1.0 + tr.Oi / tr.Ko), hs, Ac) ||
+            !solve_coupled_limitation(
+                leaf, J / electrons_per_carboxylation,
+                2.0 * electrons_per_oxygenation * tr.Gstar / electrons_per_carboxylation,
+                hs, Aj)) {
+            return false;
+        }
+
+        assim = std::min(Ac, Aj);  // micromol / m^2 / s
+
+        // The TPU-limited rate does not depend on Ci (with alpha_TPU = 0), but
+        // only applies when Ci is above Gstar
+        double const Ap = s * (3.0 * tr.TPU - tr.Rd);  // micromol / m^2 / s
+        if (Ap < assim) {
+            double const Ci_p =
+                Ca - 1.6 * Ap / coupled_stomatal_conductance(leaf, Ap, hs);  // micromol / mol
+            if (Ci_p > tr.Gstar && (Ap <= 0 || Ca - k * Ap > 0)) {
+                assim = Ap;
+            }
+        }
+
+        return true;
+    };
+
+    // Run the outer loop for the leaf surface humidity, which is a fixed point
+    // problem x = F(x) for the assimilation rate x used to calculate hs; a
+    // secant update is used after the first step
+    double x = 0.0;                                                  // micromol / m^2 / s
+    double hs = ball_berry_surface_humidity(x, Ca, RH, bb0, bb1);    // dimensionless
+    double assim{};                                                  // micromol / m^2 / s
+    int iterCounter = 1;
+    int const max_iter = 20;
+
+    bool success = coupled_rate(hs, assim);
+
+    double x_prev = x;              // micromol / m^2 / s
+    double r_prev = assim - x;      // micromol / m^2 / s
+    x = assim;
+
+    while (success && x > 0 && iterCounter < max_iter) {
+        hs = ball_berry_surface_humidity(x, Ca - k * x, RH, bb0, bb1);
+        success = coupled_rate(hs, assim);
+        ++iterCounter;
+
+        double const r = assim - x;  // micromol / m^2 / s
+        if (std::abs(r) < 1e-9) {
+            break;
+        }
+
+        double next = r != r_prev ? x - r * (x - x_prev) / (r - r_prev) : assim;  // micromol / m^2 / s
+        if (!std::isfinite(next) || next <= 0 || Ca - k * next <= 0) {
+            next = assim;
+        }
+
+        x_prev = x;
+        r_prev = r;
+        x = next;
+    }
+
+    if (!success) {
+        return c3photoC_FvCB(
+            tr, Qp, RH, bb0, bb1, Gs_min, Ca, AP, StomWS,
+            water_stress_approach, electrons_per_carboxylation,
+            electrons_per_oxygenation, 0.0);
+    }
+
+    double const Gs = coupled_stomatal_conductance(leaf, assim, hs);  // mol / m^2 / s
+    double const Ci = Ca - 1.6 * assim / Gs;                         // micromol / mol
+
+    struct c3_str result;
+    result.Assim = assim;                // micromol / m^2 / s
+    result.Gs = Gs * 1e3;                // mmol / m^2 / s
+    result.Ci = Ci;                      // micromol / mol
+    result.GrossAssim = assim + tr.Rd;   // micromol / m^2 / s
+    result.iterTimes = double(iterCounter);
+    result.penalty = 0.0;
+    return result;
+}
+
+namespace
+{
+// Quantities used by `c3photoC_FvCB_batch` that do not change during the
+// iteration, with one element for each lane; `leaf` is the index of the leaf
+// currently held by each lane
+struct fvcb_batch_constants {
+    std::vector<double> AP;      // Pa
+    std::vector<double> RH;      // dimensionless
+    std::vector<double> bb0;     // mol / m^2 / s
+    std::vector<double> bb1;     // dimensionless
+    std::vector<double> Gs_min;  // mol / m^2 / s
+    std::vector<double> StomWS;  // dimensionless
+    std::vector<double> Vcmax;   // micromol / m^2 / s
+    std::vector<double> Kco;     // micromol / mol (Kc * (1 + Oi / Ko))
+    std::vector<double> Gstar;   // micromol / mol
+    std::vector<double> Rd;      // micromol / m^2 / s
+    std::vector<double> TPU;     // micromol / m^2 / s
+    std::vector<double> J;       // micromol / m^2 / s
+    std::vector<double> Ca;      // micromol / mol
+    std::vector<double> Ca_pa;   // Pa
+    std::vector<double> ws;      // dimensionless (StomWS, or 1 when water_stress_approach is 1)
+    std::vector<size_t> leaf;
+
+    explicit fvcb_batch_constants(size_t n)
+        : AP(n), RH(n), bb0(n), bb1(n), Gs_min(n), StomWS(n), Vcmax(n),
+          Kco(n), Gstar(n), Rd(n), TPU(n), J(n), Ca(n), Ca_pa(n), ws(n),
+          leaf(n) {}
+
+    // Copies lane `from` to lane `to`
+    void move_lane(size_t from, size_t to)
+    {
+        for (std::vector<double>* v :
+             {&AP, &RH, &bb0, &bb1, &Gs_min, &StomWS, &Vcmax, &Kco, &Gstar,
+              &Rd, &TPU, &J, &Ca, &Ca_pa, &ws}) {
+            (*v)[to] = (*v)[from];
+        }
+        leaf[to] = leaf[from];
+    }
+};
+
+// The state of the fixed point iteration in `c3photoC_FvCB_batch`, with one
+// element for each lane
+struct fvcb_batch_state {
+    std::vector<double> Ci_pa;   // Pa
+    std::vector<double> assim;   // micromol / m^2 / s
+    std::vector<double> Gs;      // mol / m^2 / s
+    std::vector<double> Ci;      // micromol / mol
+    std::vector<double> iter;    // dimensionless
+    std::vector<double> active;  // 1 for lanes that have not converged, 0 otherwise
+    std::vector<double> bad_Cs;  // nonzero for lanes where Cs became negative
+
+    explicit fvcb_batch_state(size_t n)
+        : Ci_pa(n, 0.0), assim(n, 0.0), Gs(n, 0.0), Ci(n, 0.0), iter(n, 0.0),
+          active(n, 1.0), bad_Cs(n, 0.0) {}
+
+    void swap(fvcb_batch_state& other)
+    {
+        Ci_pa.swap(other.Ci_pa);
+        assim.swap(other.assim);
+        Gs.swap(other.Gs);
+        Ci.swap(other.Ci);
+        iter.swap(other.iter);
+        active.swap(other.active);
+        bad_Cs.swap(other.bad_Cs);
+    }
+
+    // Copies lane `from` to lane `to`
+    void move_lane(size_t from, size_t to)
+    {
+        for (std::vector<double>* v :
+             {&Ci_pa, &assim, &Gs, &Ci, &iter, &active, &bad_Cs}) {
+            (*v)[to] = (*v)[from];
+        }
+    }
+};
+
+// Applies one step of the fixed point iteration in `c3photoC_FvCB` to lanes
+// [0, m) of `x`, storing the result in `next`. Every lane is stored; lanes
+// that have already converged keep their values. The conditional expressions
+// only choose between values that have already been calculated, and masked
+// updates are used wherever one alternative would be read from memory, so
+// the loop can be compiled without branches.
+void fvcb_batch_step(
+    size_t const m,
+    int const water_stress_approach,
+    double const electrons_per_carboxylation,
+    double const electrons_per_oxygenation,
+    fvcb_batch_constants const& c,
+    fvcb_batch_state const& x,
+    fvcb_batch_state& next)
+{
+    double const alpha_TPU = 0.0;  // dimensionless (see `c3photoC_FvCB`)
+    double const Tol = 0.01;       // micromol / m^2 / s
+
+    double const stress_mask = water_stress_approach == 1 ? 1.0 : 0.0;  // dimensionless
+
+    // The compiler cannot tell that writing to `next` leaves the addresses
+    // stored in `c` and `x` unchanged, so the loop only uses local pointers
+    // to the data
+    double const* const c_AP = c.AP.data();
+    double const* const c_RH = c.RH.data();
+    double const* const c_bb0 = c.bb0.data();
+    double const* const c_bb1 = c.bb1.data();
+    double const* const c_Gs_min = c.Gs_min.data();
+    double const* const c_StomWS = c.StomWS.data();
+    double const* const c_Vcmax = c.Vcmax.data();
+    double const* const c_Kco = c.Kco.data();
+    double const* const c_Gstar = c.Gstar.data();
+    double const* const c_Rd = c.Rd.data();
+    double const* const c_TPU = c.TPU.data();
+    double const* const c_J = c.J.data();
+    double const* const c_Ca = c.Ca.data();
+    double const* const c_Ca_pa = c.Ca_pa.data();
+    double const* const c_ws = c.ws.data();
+    double const* const x_Ci_pa = x.Ci_pa.data();
+    double const* const x_assim = x.assim.data();
+    double const* const x_Gs = x.Gs.data();
+    double const* const x_Ci = x.Ci.data();
+    double const* const x_iter = x.iter.data();
+    double const* const x_active = x.active.data();
+    double const* const x_bad_Cs = x.bad_Cs.data();
+    double* const next_Ci_pa = next.Ci_pa.data();
+    double* const next_assim = next.assim.data();
+    double* const next_Gs = next.Gs.data();
+    double* const next_Ci = next.Ci.data();
+    double* const next_iter = next.iter.data();
+    double* const next_active = next.active.data();
+    double* const next_bad_Cs = next.bad_Cs.data();
+
+#pragma omp simd
+    for (size_t k = 0; k < m; ++k) {
+        double const on = x_active[k];                   // dimensionless
+        double const Ci_k = (x_Ci_pa[k] / c_AP[k]) * 1e6;  // micromol / mol
+
+        // Net assimilation, as in `c3photoC_FvCB`; Wp is only used when Ci is
+        // above its asymptote
+        double const Ac0 = -c_Gstar[k] * c_Vcmax[k] / c_Kco[k] - c_Rd[k];          // micromol / m^2 / s
+        double const Aj0 = -c_J[k] / (2.0 * electrons_per_oxygenation) - c_Rd[k];  // micromol / m^2 / s
+        double const A0 = Aj0 > Ac0 ? Aj0 : Ac0;                                   // micromol / m^2 / s
+        double const Wc = c_Vcmax[k] * Ci_k / (Ci_k + c_Kco[k]);                   // micromol / m^2 / s
+        double const Wj = c_J[k] * Ci_k /
+                          (electrons_per_carboxylation * Ci_k +
+                           2.0 * electrons_per_oxygenation * c_Gstar[k]);         // micromol / m^2 / s
+        double const Ci_TPU = c_Gstar[k] * (1.0 + 3.0 * alpha_TPU);               // micromol / mol
+        double const Wp = 3.0 * c_TPU[k] * Ci_k / (Ci_k - Ci_TPU);                 // micromol / m^2 / s
+        double const Wcj = Wj < Wc ? Wj : Wc;                                      // micromol / m^2 / s
+        double const Vc = Ci_k > Ci_TPU && Wp < Wcj ? Wp : Wcj;                    // micromol / m^2 / s
+
+        double const A = (Ci_k == 0.0 ? A0 : (1.0 - c_Gstar[k] / Ci_k) * Vc - c_Rd[k]) *
+                         c_ws[k];  // micromol / m^2 / s
+
+        // Stomatal conductance; lanes where `ball_berry` would throw are
+        // flagged below
+        double const Cs = c_Ca[k] * 1e-6 - (1.4 / ball_berry_gbw) * (A * 1e-6);  // mol / mol
+        double const g = ball_berry_unchecked(
+                             A * 1e-6, c_Ca[k] * 1e-6, c_RH[k], c_bb0[k], c_bb1[k]) *
+                         1e-3;  // mol / m^2 / s
+
+        double const G_ws = masked_update(
+            stress_mask, c_Gs_min[k] + c_StomWS[k] * (g - c_Gs_min[k]), g);  // mol / m^2 / s
+        double const G = G_ws <= 0 ? 1e-8 : G_ws;                           // mol / m^2 / s
+
+        double const Ci_pa_A = c_Ca_pa[k] - (A * 1e-6) * 1.6 * c_AP[k] / G;  // Pa
+        double const Ci_pa_new = Ci_pa_A < 0 ? 1e-5 : Ci_pa_A;              // Pa
+
+        double const not_done = std::abs(x_assim[k] - A) < Tol ? 0.0 : 1.0;  // dimensionless
+        double const bad = A > 0 && Cs < 0.0 ? on : 0.0;                     // dimensionless
+
+        next_Ci[k] = masked_update(on, Ci_k, x_Ci[k]);
+        next_Gs[k] = masked_update(on, G, x_Gs[k]);
+        next_Ci_pa[k] = masked_update(on, Ci_pa_new, x_Ci_pa[k]);
+        next_assim[k] = masked_update(on, A, x_assim[k]);
+        next_iter[k] = x_iter[k] + on * not_done;
+        next_active[k] = on * not_done;
+        next_bad_Cs[k] = x_bad_Cs[k] + bad;
+    }
+}
+
+// Stores the results for lanes [0, m) that have converged (or for all of them
+// if `all` is true) and moves the remaining lanes to the front. Returns the
+// number of remaining lanes.
+size_t finish_batch_lanes(
+    size_t const m,
+    bool const all,
+    fvcb_batch_constants& c,
+    fvcb_batch_state& x,
+    struct c3_fvcb_batch_outputs& result,
+    bool& negative_Cs)
+{
+    size_t remaining = 0;
+    for (size_t k = 0; k < m; ++k) {
+        if (all || x.active[k] == 0.0) {
+            size_t const i = c.leaf[k];
+            result.Assim[i] = x.assim[k];                 // micromol / m^2 / s
+            result.Gs[i] = x.Gs[k] * 1e3;                 // mmol / m^2 / s
+            result.Ci[i] = x.Ci[k];                       // micromol / mol
+            result.GrossAssim[i] = x.assim[k] + c.Rd[k];  // micromol / m^2 / s
+            result.iterTimes[i] = x.iter[k];
+            negative_Cs = negative_Cs || x.bad_Cs[k] != 0.0;
+        } else {
+            c.move_lane(k, remaining);
+            x.move_lane(k, remaining);
+            ++remaining;
+        }
+    }
+    return remaining;
+}
+}  // namespace
+
+void c3_fvcb_batch_inputs::resize(size_t n)
+{
+    for (std::vector<double>* v : {&Qp, &Tleaf, &RH, &Vcmax0, &Jmax0,
+                                   &TPU_rate_max, &Rd0, &bb0, &bb1, &Gs_min,
+                                   &Ca, &AP, &O2, &thet, &StomWS}) {
+        v->resize(n);
+    }
+}
+
+// This function applies the same fixed point iteration as `c3photoC_FvCB` to
+// many leaves at once. The inputs and outputs are stored as structures of
+// arrays, and each step of the iteration is applied to all leaves in a single
+// loop without branches, so that the compiler can vectorize it (the loop is
+// marked with `omp simd`). Each lane holds one leaf and has a mask that is
+// cleared when the iteration for that leaf converges; masked lanes keep their
+// values. Once half of the lanes have converged, their results are stored and
+// the remaining lanes are packed together, so a few slowly converging leaves
+// do not make the others more expensive. Each leaf follows the same sequence
+// of steps as in `c3photoC_FvCB`, so the results agree with it apart from
+// floating point contraction.
+//
+// The vectorized loop is only faster than calling `c3photoC_FvCB` for each
+// leaf when the iteration is long enough and there are enough leaves to fill
+// the lanes. With `water_stress_approach` set to 1, the benchmark in
+// `benchmarks/c3photo_fvcb_batch.cpp` is about twice as fast for large
+// batches and is consistently faster from about 32 leaves
+// (`c3_fvcb_min_batch_size`); with other values, where the iteration usually
+// takes only a few steps, it is no faster. In those cases, `c3photoC_FvCB` is
+// called for each leaf instead.
+//
+// As in `ball_berry`, an exception is thrown if the CO2 mole fraction at the
+// leaf surface is negative for any leaf.
+struct c3_fvcb_batch_outputs c3photoC_FvCB_batch(
+    struct c3_fvcb_batch_inputs const& leaves,
+    int const water_stress_approach,           // (flag)
+    double const electrons_per_carboxylation,  // self-explanatory units
+    double const electrons_per_oxygenation     // self-explanatory units
+)
+{
+    size_t const n = leaves.size();
+
+    for (std::vector<double> const* v :
+         {&leaves.Tleaf, &leaves.RH, &leaves.Vcmax0, &leaves.Jmax0,
+          &leaves.TPU_rate_max, &leaves.Rd0, &leaves.bb0, &leaves.bb1,
+          &leaves.Gs_min, &leaves.Ca, &leaves.AP, &leaves.O2, &leaves.thet,
+          &leaves.StomWS}) {
+        if (v->size() != n) {
+            throw std::logic_error("Thrown by c3photoC_FvCB_batch: all inputs must have the same number of leaves.");
+        }
+    }
+
+    struct c3_fvcb_batch_outputs result;
+    result.Assim.resize(n);
+    result.Gs.resize(n);
+    result.Ci.resize(n);
+    result.GrossAssim.resize(n);
+    result.iterTimes.resize(n);
+
+    if (water_stress_approach != 1 || n < c3_fvcb_min_batch_size) {
+        for (size_t i = 0; i < n; ++i) {
+            const struct c3_str photo = c3photoC_FvCB(
+                leaves.Qp[i], leaves.Tleaf[i], leaves.RH[i], leaves.Vcmax0[i],
+                leaves.Jmax0[i], leaves.TPU_rate_max[i], leaves.Rd0[i],
+                leaves.bb0[i], leaves.bb1[i], leaves.Gs_min[i], leaves.Ca[i],
+                leaves.AP[i], leaves.O2[i], leaves.thet[i], leaves.StomWS[i],
+                water_stress_approach, electrons_per_carboxylation,
+                electrons_per_oxygenation);
+
+            result.Assim[i] = photo.Assim;            // micromol / m^2 / s
+            result.Gs[i] = photo.Gs;                  // mmol / m^2 / s
+            result.Ci[i] = photo.Ci;                  // micromol / mol
+            result.GrossAssim[i] = photo.GrossAssim;  // micromol / m^2 / s
+            result.iterTimes[i] = photo.iterTimes;
+        }
+        return result;
+    }
+
+    // Define the leaf reflectance
+    double const leaf_reflectance = 0.2;  // dimensionless
+
+    int const max_iter = 1000;
+
+    fvcb_batch_constants c(n);
+
+    for (size_t i = 0; i < n; ++i) {
+        const struct c3_temperature_response tr = c3_temperature_response_at(
+            leaves.Tleaf[i], leaves.Vcmax0[i], leaves.Jmax0[i],
+            leaves.TPU_rate_max[i], leaves.Rd0[i], leaves.thet[i], leaves.O2[i]);
+
+        double const I2 =
+            leaves.Qp[i] * tr.dark_adapted_phi_PSII * (1.0 - leaf_reflectance) / 2.0;  // micromol / m^2 / s
+
+        c.AP[i] = leaves.AP[i];
+        c.RH[i] = leaves.RH[i];
+        c.bb0[i] = leaves.bb0[i];
+        c.bb1[i] = leaves.bb1[i];
+        c.Gs_min[i] = leaves.Gs_min[i];
+        c.StomWS[i] = leaves.StomWS[i];
+        c.Vcmax[i] = tr.Vcmax;
+        c.Kco[i] = tr.Kc * (1.0 + tr.Oi / tr.Ko);
+        c.Gstar[i] = tr.Gstar;
+        c.Rd[i] = tr.Rd;
+        c.TPU[i] = tr.TPU;
+        c.J[i] = (tr.Jmax + I2 - sqrt(pow(tr.Jmax + I2, 2) - 4.0 * tr.theta * I2 * tr.Jmax)) /
+                 (2.0 * tr.theta);
+        c.Ca[i] = leaves.Ca[i] <= 0 ? 1e-4 : leaves.Ca[i];
+        c.Ca_pa[i] = c.Ca[i] * 1e-6 * c.AP[i];
+        c.ws[i] = water_stress_approach == 0 ? c.StomWS[i] : 1.0;
+        c.leaf[i] = i;
+    }
+
+    fvcb_batch_state x(n);
+    fvcb_batch_state next(n);
+
+    bool negative_Cs = false;
+
+    size_t m = n;  // number of lanes in use
+    for (int iterCounter = 0; iterCounter < max_iter && m > 0; ++iterCounter) {
+        fvcb_batch_step(
+            m, water_stress_approach, electrons_per_carboxylation,
+            electrons_per_oxygenation, c, x, next);
+
+        x.swap(next);
+
+        double n_active = 0.0;
+        for (size_t k = 0; k < m; ++k) {
+            n_active += x.active[k];
+        }
+
+        if (n_active <= 0.5 * m) {
+            m = finish_batch_lanes(m, false, c, x, result, negative_Cs);
+        }
+    }
+
+    finish_batch_lanes(m, true, c, x, result, negative_Cs);
+
+    if (negative_Cs) {
+        throw std::range_error("Thrown in c3photoC_FvCB_batch: Cs is less than 0.");
+    }
+
     return result;
 }
 
@@ -3,6 +3,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 struct c3_str {
     double Assim;
     double Gs;
@@ -12,11 +13,166 @@ struct c3_str {
     double penalty;
 };
 
+// Leaf photosynthesis parameters that depend only on leaf temperature, as
+// used by the FvCB model
+struct c3_temperature_response {
+    double Kc;                     // micromol / mol
+    double Ko;                     // mmol / mol
+    double Gstar;                  // micromol / mol
+    double Vcmax;                  // micromol / m^2 / s
+    double Jmax;                   // micromol / m^2 / s
+    double Rd;                     // micromol / m^2 / s
+    double theta;                  // dimensionless
+    double dark_adapted_phi_PSII;  // dimensionless
+    double Oi;                     // mmol / mol
+    double TPU;                    // micromol / m^2 / s
+};
+
+// Initial values for the Ci iteration in `c3photoC`, typically taken from an
+// FvCB solution at the same leaf temperature; the initial Ci is determined
+// from the assimilation rate
+struct c3_warm_start {
+    double Assim;  // micromol / m^2 / s
+    double Rd;     // micromol / m^2 / s
+};
+
 #ifdef WITH_YGGDRASIL
 
 // Forward declaration
 class YggRpcClient;
 
+// The Ci iteration for a single leaf, which is shared by `c3photoC` and
+// `c3photoC_batch`. It is written as a coroutine that suspends each time it
+// needs a gross assimilation rate from the ePhotosynthesis server: while
+// `done()` is false, the leaf is waiting for the rate at `requested_Ci()`, and
+// `step()` resumes it with the server's reply. A single thread can therefore
+// keep many leaves in progress at once and send the requests from all of the
+// waiting leaves to the server together; see `c3photoC_resume_batch`.
+//
+// When `ci_solver_approach` is 1, each request to the ePhotosynthesis server
+// also asks for the slope of the assimilation curve (`dCO2AR_dCi`), which the
+// server may compute analytically or by a finite difference of size
+// `CO2_in_step` within the same call. Ci is then updated with a safeguarded
+// Newton step on the supply/demand residual instead of the plain fixed point.
+// If the server does not return the slope, a secant estimate from the previous
+// call is used instead.
+//
+// The iteration stops when the change in net assimilation is below `Tol`.
+//
+// If a warm start is provided, the iteration begins from its net assimilation
+// rate and the corresponding Ci rather than from 30 Pa, and its day
+// respiration rate is used instead of recalculating it from `Rd0`. When the
+// ePhotosynthesis rate at that Ci matches the warm start assimilation, a
+// single call suffices.
+class c3photoC_coroutine
+{
+   public:
+    c3photoC_coroutine(
+        double const Qp,                   // micromol / m^2 / s
+        double const Tleaf,                // degrees C
+        double const RH,                   // dimensionless
+        double const Rd0,                  // micromol / m^2 / s
+        double const bb0,                  // mol / m^2 / s
+        double const bb1,                  // dimensionless
+        double const Gs_min,               // mol / m^2 / s
+        double const Ca,                   // micromol / mol
+        double const AP,                   // Pa
+        double const StomWS,               // dimensionless
+        int const water_stress_approach,   // (flag)
+        double const enzyme_sf,            // dimensionless
+        int const ci_solver_approach,      // (flag)
+        double const Tol,                  // micromol / m^2 / s
+        struct c3_warm_start const* warm_start);
+
+    // Whether the iteration has converged or reached the iteration limit
+    bool done() const { return converged || iterCounter >= max_iter; }
+
+    // Whether the server should be asked for the slope of the assimilation
+    // curve
+    bool wants_slope() const { return use_newton; }
+
+    // The Ci value at which the next gross assimilation rate is needed
+    double requested_Ci() const { return (Ci_pa / AP) * 1e6; }  // micromol / mol
+
+    // The conditions at which the gross assimilation rate is needed
+    double incident_ppfd() const { return Qp; }                 // micromol / m^2 / s
+    double leaf_temperature() const { return Tleaf; }           // degrees C
+    double enzyme_scaling_factor() const { return enzyme_sf; }  // dimensionless
+
+    // Advance the iteration using the gross assimilation rate returned by the
+    // server and its slope with respect to Ci, where a negative slope
+    // indicates that it is not available
+    void step(double co2_assim_ephoto, double dAdCi);
+
+    struct c3_str result() const;
+
+   private:
+    double stomatal_conductance(double assim) const;
+
+    // Leaf parameters
+    double const Qp;
+    double const Tleaf;
+    double const RH;
+    double const bb0;
+    double const bb1;
+    double const Gs_min;
+    double const Ca;
+    double const AP;
+    double const StomWS;
+    int const water_stress_approach;
+    double const enzyme_sf;
+    bool const use_newton;
+    double const Tol;
+    double const Rd;     // micromol / m^2 / s
+    double const Ca_pa;  // Pa
+
+    // Iteration state
+    double Gs{};                         // mol / m^2 / s
+    double Ci{};                         // micromol / mol
+    double Ci_pa = 30.0;                 // Pa                 (initial guess)
+    double co2_assimilation_rate = 0.0;  // micromol / m^2 / s (initial guess)
+    int iterCounter = 0;
+    int const max_iter = 10;
+    double penalty = 0.0;
+    bool converged = false;
+
+    // Quantities used by the Newton update
+    double const dA_step = 1e-3;         // micromol / m^2 / s (finite difference step for dGs / dA)
+    double previous_Ci = -1.0;           // micromol / mol
+    double previous_assim_ephoto = 0.0;  // micromol / m^2 / s
+};
+
+
+// Sends a request for the leaf's next gross assimilation rate to the
+// ePhotosynthesis server and resumes the leaf with the reply. The leaf must
+// not be done.
+//
+// The request is a JSON object with the members `Tp` (leaf temperature),
+// `CO2_in` (Ci), `TestLi` (incident PPFD), and `enzyme_sf`, along with
+// `CO2_in_step` when the slope is wanted. The reply must contain `CO2AR`
+// (gross assimilation) and may contain `dCO2AR_dCi`. A server that predates
+// the `enzyme_sf` and `CO2_in_step` members ignores them, so `enzyme_sf` only
+// has an effect with a server that applies it to each request; such a server
+// is not part of this package.
+void c3photoC_resume(
+    YggRpcClient& rpc,
+    c3photoC_coroutine& leaf);
+
+// Sends the requests from several leaves to the ePhotosynthesis server in a
+// single message, which has the form `{"batch": [request_0, request_1, ...]}`,
+// and resumes each leaf with its reply. The reply must have the form
+// `{"batch": [reply_0, reply_1, ...]}`, with the replies in the same order as
+// the requests. None of the leaves may be done. Each request has the same
+// members as in `c3photoC_resume`. The server in models/ does not support the
+// batched form; when a reply has no `batch` member, each leaf is resumed with
+// its own request using `c3photoC_resume` instead, and so are the leaves in
+// every later call. The results are the same either way, but the number of
+// messages is then the total over all leaves. A single leaf is always sent as
+// a single request.
+void c3photoC_resume_batch(
+    YggRpcClient& rpc,
+    std::vector<c3photoC_coroutine*> const& leaves);
+
 struct c3_str c3photoC(
     YggRpcClient& rpc,
     double const Qp,
@@ -37,7 +193,28 @@ struct c3_str c3photoC(
     int const water_stress_approach,
     double const electrons_per_carboxylation,
     double const electrons_per_oxygenation,
-    double const enzyme_sf);
+    double const enzyme_sf,
+    int const ci_solver_approach,
+    double const Tol,
+    struct c3_warm_start const* warm_start = nullptr);
+
+std::vector<struct c3_str> c3photoC_batch(
+    YggRpcClient& rpc,
+    double const Qp,
+    double const Tleaf,
+    double const RH,
+    double const Rd0,
+    double const bb0,
+    double const bb1,
+    double const Gs_min,
+    double Ca,
+    double const AP,
+    double const StomWS,
+    int const water_stress_approach,
+    std::vector<double> const& enzyme_sf,
+    int const ci_solver_approach,
+    double const Tol,
+    struct c3_warm_start const* warm_start = nullptr);
 
 #endif // WITH_YGGDRASIL
 
@@ -61,6 +238,87 @@ struct c3_str c3photoC_FvCB(
     double const electrons_per_carboxylation,
     double const electrons_per_oxygenation);
 
+struct c3_temperature_response c3_temperature_response_at(
+    double const Tleaf,
+    double const Vcmax0,
+    double const Jmax0,
+    double const TPU_rate_max,
+    double const Rd0,
+    double const thet,
+    double const O2);
+
+struct c3_str c3photoC_FvCB(
+    struct c3_temperature_response const& tr,
+    double const Qp,
+    double const RH,
+    double const bb0,
+    double const bb1,
+    double const Gs_min,
+    double Ca,
+    double const AP,
+    double const StomWS,
+    int const water_stress_approach,
+    double const electrons_per_carboxylation,
+    double const electrons_per_oxygenation,
+    double const Ci_initial,
+    int const fvcb_solver_approach = 0);
+
+struct c3_str c3photoC_FvCB_analytic(
+    struct c3_temperature_response const& tr,
+    double const Qp,
+    double const RH,
+    double const bb0,
+    double const bb1,
+    double const Gs_min,
+    double Ca,
+    double const AP,
+    double const StomWS,
+    int const water_stress_approach,
+    double const electrons_per_carboxylation,
+    double const electrons_per_oxygenation);
+
+// Inputs to `c3photoC_FvCB_batch`, stored as a structure of arrays with one
+// element for each leaf; all members must have the same size
+struct c3_fvcb_batch_inputs {
+    std::vector<double> Qp;            // micromol / m^2 / s
+    std::vector<double> Tleaf;         // degrees C
+    std::vector<double> RH;            // dimensionless
+    std::vector<double> Vcmax0;        // micromol / m^2 / s
+    std::vector<double> Jmax0;         // micromol / m^2 / s
+    std::vector<double> TPU_rate_max;  // micromol / m^2 / s
+    std::vector<double> Rd0;           // micromol / m^2 / s
+    std::vector<double> bb0;           // mol / m^2 / s
+    std::vector<double> bb1;           // dimensionless
+    std::vector<double> Gs_min;        // mol / m^2 / s
+    std::vector<double> Ca;            // micromol / mol
+    std::vector<double> AP;            // Pa
+    std::vector<double> O2;            // millimol / mol
+    std::vector<double> thet;          // dimensionless
+    std::vector<double> StomWS;        // dimensionless
+
+    size_t size() const { return Qp.size(); }
+    void resize(size_t n);
+};
+
+// Outputs from `c3photoC_FvCB_batch`, with one element for each leaf
+struct c3_fvcb_batch_outputs {
+    std::vector<double> Assim;       // micromol / m^2 / s
+    std::vector<double> Gs;          // mmol / m^2 / s
+    std::vector<double> Ci;          // micromol / mol
+    std::vector<double> GrossAssim;  // micromol / m^2 / s
+    std::vector<double> iterTimes;   // dimensionless
+};
+
+// Below this number of leaves, `c3photoC_FvCB_batch` calls `c3photoC_FvCB` for
+// each leaf, which is faster
+size_t const c3_fvcb_min_batch_size = 32;
+
+struct c3_fvcb_batch_outputs c3photoC_FvCB_batch(
+    struct c3_fvcb_batch_inputs const& leaves,
+    int const water_stress_approach,
+    double const electrons_per_carboxylation,
+    double const electrons_per_oxygenation);
+
 double solc(double LeafT);
 double solo(double LeafT);
 
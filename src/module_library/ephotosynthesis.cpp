@@ -1,5 +1,8 @@
+#include <algorithm>    // for std::min
+#include <string>       // for std::to_string
+#include <vector>
 #include "ephotosynthesis.h"
-#include "c3photo.hpp"  // for c3photoC
+#include "c3photo.hpp"  // for c3photoC_batch, c3photoC_FvCB, c3photoC_resume
 #include "BioCro.h"     // for c3EvapoTrans
 
 #ifdef WITH_YGGDRASIL
@@ -34,7 +37,11 @@ string_vector ephotosynthesis<C4>::get_inputs()
         "specific_heat_of_air",         // J / kg / K
         "minimum_gbw",                  // mol / m^2 / s
         "windspeed_height",             // m
-        "enzyme_sf"                     // dimensionless 
+        "enzyme_sf",                    // dimensionless
+        "ci_solver_approach",           // a dimensionless switch
+        "tolerance_approach",           // a dimensionless switch
+        "relative_canopy_weight",       // dimensionless
+        "fvcb_solver_approach"          // a dimensionless switch
     };
 }
 
@@ -42,56 +49,89 @@ template<bool C4>
 string_vector ephotosynthesis<C4>::get_outputs()
 {
     return {
-        "Assim",             // micromole / m^2 /s
-        "GrossAssim",        // micromole / m^2 /s
-        "Ci",                // micromole / mol
-        "Gs",                // mmol / m^2 / s
-        "iterTimes",         // 
-        "penalty",           // 
-        "TransR",            // mmol / m^2 / s
-        "EPenman",           // mmol / m^2 / s
-        "EPriestly",         // mmol / m^2 / s
-        "leaf_temperature",  // deg. C
-        "gbw"                // mol / m^2 / s
+        "Assim",                  // micromole / m^2 /s
+        "GrossAssim",             // micromole / m^2 /s
+        "Ci",                     // micromole / mol
+        "Gs",                     // mmol / m^2 / s
+        "iterTimes",              // 
+        "penalty",                // 
+        "TransR",                 // mmol / m^2 / s
+        "EPenman",                // mmol / m^2 / s
+        "EPriestly",              // mmol / m^2 / s
+        "leaf_temperature",       // deg. C
+        "gbw",                    // mol / m^2 / s
+        "assimilation_tolerance"  // micromole / m^2 / s
     };
 }
 
 template<>
-void ephotosynthesis<false>::do_operation() const
+struct c3_str ephotosynthesis<false>::initial_photosynthesis() const
 {
-    // Get an initial estimate of stomatal conductance, assuming the leaf is at
-    // air temperature
+    // Get an initial estimate of stomatal conductance and Ci, assuming the
+    // leaf is at air temperature
     // YH:I use FvCB c3 here just to get the initial Gs quickly
-    double const initial_stomatal_conductance =
-        c3photoC_FvCB(
-            incident_ppfd, temp, rh, vmax1, jmax, tpu_rate_max, Rd, b0,
-            b1, Gs_min, Catm, atmospheric_pressure, O2, theta, StomataWS,
-            water_stress_approach, electrons_per_carboxylation,
-            electrons_per_oxygenation)
-            .Gs;  // mmol / m^2 / s
+    return c3photoC_FvCB(
+        c3_temperature_response_at(
+            temp, vmax1, jmax, tpu_rate_max, Rd, theta, O2),
+        incident_ppfd, rh, b0, b1, Gs_min, Catm, atmospheric_pressure,
+        StomataWS, water_stress_approach, electrons_per_carboxylation,
+        electrons_per_oxygenation, 0.0, fvcb_solver_approach);
+}
 
+template<>
+struct ET_Str ephotosynthesis<false>::leaf_energy_balance(
+    double initial_stomatal_conductance) const
+{
     // Calculate a new value for leaf temperature using the estimate for
     // stomatal conductance
-    const struct ET_Str et =
-        c3EvapoTrans(
-            average_absorbed_shortwave, temp, rh, windspeed, height,
-            specific_heat_of_air, initial_stomatal_conductance, minimum_gbw,
-            windspeed_height);
+    return c3EvapoTrans(
+        average_absorbed_shortwave, temp, rh, windspeed, height,
+        specific_heat_of_air, initial_stomatal_conductance, minimum_gbw,
+        windspeed_height);
+}
 
-    double const leaf_temperature = temp + et.Deltat;  // deg. C
+template<>
+struct c3_warm_start ephotosynthesis<false>::get_warm_start(
+    double leaf_temperature,
+    double initial_Ci) const
+{
+    // Correct the FvCB solution to the leaf temperature, starting from the Ci
+    // found at air temperature; the temperature-dependent parameters are
+    // calculated once and the day respiration rate is passed on to the
+    // ePhotosynthesis iteration
+    const struct c3_temperature_response tr =
+        c3_temperature_response_at(
+            leaf_temperature, vmax1, jmax, tpu_rate_max, Rd, theta, O2);
 
-    // Calculate final values for assimilation, stomatal conductance, and Ci
-    // using the new leaf temperature
-    YggRpcClient rpc = get_comm();
     const struct c3_str photo =
-        c3photoC(
-            rpc,
-            incident_ppfd, leaf_temperature, rh, vmax1, jmax,
-            tpu_rate_max, Rd, b0, b1, Gs_min, Catm, atmospheric_pressure, O2,
-            theta, StomataWS, water_stress_approach,
-            electrons_per_carboxylation, electrons_per_oxygenation,enzyme_sf);
+        c3photoC_FvCB(
+            tr, incident_ppfd, rh, b0, b1, Gs_min, Catm, atmospheric_pressure,
+            StomataWS, water_stress_approach, electrons_per_carboxylation,
+            electrons_per_oxygenation, initial_Ci, fvcb_solver_approach);
 
-    // Update the outputs
+    return {photo.Assim, tr.Rd};
+}
+
+template<>
+double ephotosynthesis<false>::get_assimilation_tolerance() const
+{
+    // Determine the tolerance for the Ci iteration, scaling it by the weight
+    // of this leaf in the canopy integral if required
+    double const base_tolerance = 0.01;  // micromol / m^2 / s
+    if (tolerance_approach == 1) {
+        return relative_canopy_weight > 0.01
+                   ? std::min(base_tolerance / relative_canopy_weight, 100 * base_tolerance)
+                   : 100 * base_tolerance;  // micromol / m^2 / s
+    }
+    return base_tolerance;  // micromol / m^2 / s
+}
+
+template<>
+void ephotosynthesis<false>::update_outputs(
+    struct c3_str const& photo,
+    struct ET_Str const& et,
+    double assimilation_tolerance) const
+{
     update(Assim_op, photo.Assim);
     update(GrossAssim_op, photo.GrossAssim);
     update(Ci_op, photo.Ci);
@@ -101,13 +141,157 @@ void ephotosynthesis<false>::do_operation() const
     update(TransR_op, et.TransR);
     update(EPenman_op, et.EPenman);
     update(EPriestly_op, et.EPriestly);
-    update(leaf_temperature_op, leaf_temperature);
+    update(leaf_temperature_op, temp + et.Deltat);
     update(gbw_op, et.boundary_layer_conductance);
+    update(assimilation_tolerance_op, assimilation_tolerance);
+}
+
+template<>
+ephotosynthesis<false>::suspended_leaf ephotosynthesis<false>::start_leaf() const
+{
+    const struct c3_str initial_photo = initial_photosynthesis();
+
+    const struct ET_Str et = leaf_energy_balance(initial_photo.Gs);
+
+    double const leaf_temperature = temp + et.Deltat;  // deg. C
+
+    const struct c3_warm_start warm_start =
+        get_warm_start(leaf_temperature, initial_photo.Ci);
+
+    double const assimilation_tolerance = get_assimilation_tolerance();  // micromol / m^2 / s
+
+    // Prepare to calculate final values for assimilation, stomatal
+    // conductance, and Ci using the new leaf temperature
+    return {
+        et,
+        assimilation_tolerance,
+        c3photoC_coroutine(
+            incident_ppfd, leaf_temperature, rh, Rd, b0, b1, Gs_min, Catm,
+            atmospheric_pressure, StomataWS, water_stress_approach, enzyme_sf,
+            ci_solver_approach, assimilation_tolerance, &warm_start)};
+}
+
+template<>
+void ephotosynthesis<false>::resume_leaves(
+    std::vector<suspended_leaf*> const& leaves) const
+{
+    std::vector<c3photoC_coroutine*> photo;
+    for (suspended_leaf* leaf : leaves) {
+        photo.push_back(&leaf->photo);
+    }
+
+    YggRpcClient rpc = get_comm();
+    c3photoC_resume_batch(rpc, photo);
+}
+
+template<>
+void ephotosynthesis<false>::finish_leaf(suspended_leaf const& leaf) const
+{
+    update_outputs(leaf.photo.result(), leaf.et, leaf.assimilation_tolerance);
+}
+
+template<>
+void ephotosynthesis<false>::do_operation() const
+{
+    suspended_leaf leaf = start_leaf();
+
+    YggRpcClient rpc = get_comm();
+    while (!leaf.photo.done()) {
+        c3photoC_resume(rpc, leaf.photo);
+    }
+
+    // Update the outputs
+    finish_leaf(leaf);
 }
 
 template class ephotosynthesis<false>;
 // template class ephotosynthesis<true>;
 
+int const c3_ephotosynthesis_sweep::nsweep = 4;  // Set the number of additional values
+
+std::string c3_ephotosynthesis_sweep::get_sweep_name(std::string const& name, int k)
+{
+    return name + "_sf_" + std::to_string(k);
+}
+
+c3_ephotosynthesis_sweep::c3_ephotosynthesis_sweep(
+    state_map const& input_quantities,
+    state_map* output_quantities)
+    : c3_ephotosynthesis(input_quantities, output_quantities)
+{
+    for (int k = 1; k <= nsweep; ++k) {
+        enzyme_sf_ips.push_back(get_ip(input_quantities, "enzyme_sf_" + std::to_string(k)));
+        Assim_ops.push_back(get_op(output_quantities, get_sweep_name("Assim", k)));
+        GrossAssim_ops.push_back(get_op(output_quantities, get_sweep_name("GrossAssim", k)));
+        Ci_ops.push_back(get_op(output_quantities, get_sweep_name("Ci", k)));
+        Gs_ops.push_back(get_op(output_quantities, get_sweep_name("Gs", k)));
+        iterTimes_ops.push_back(get_op(output_quantities, get_sweep_name("iterTimes", k)));
+    }
+}
+
+string_vector c3_ephotosynthesis_sweep::get_inputs()
+{
+    string_vector inputs = c3_ephotosynthesis::get_inputs();
+    for (int k = 1; k <= nsweep; ++k) {
+        inputs.push_back("enzyme_sf_" + std::to_string(k));  // dimensionless
+    }
+    return inputs;
+}
+
+string_vector c3_ephotosynthesis_sweep::get_outputs()
+{
+    string_vector outputs = c3_ephotosynthesis::get_outputs();
+    for (int k = 1; k <= nsweep; ++k) {
+        outputs.push_back(get_sweep_name("Assim", k));       // micromole / m^2 /s
+        outputs.push_back(get_sweep_name("GrossAssim", k));  // micromole / m^2 /s
+        outputs.push_back(get_sweep_name("Ci", k));          // micromole / mol
+        outputs.push_back(get_sweep_name("Gs", k));          // mmol / m^2 / s
+        outputs.push_back(get_sweep_name("iterTimes", k));   //
+    }
+    return outputs;
+}
+
+void c3_ephotosynthesis_sweep::do_operation() const
+{
+    const struct c3_str initial_photo = initial_photosynthesis();
+
+    const struct ET_Str et = leaf_energy_balance(initial_photo.Gs);
+
+    double const leaf_temperature = temp + et.Deltat;  // deg. C
+
+    const struct c3_warm_start warm_start =
+        get_warm_start(leaf_temperature, initial_photo.Ci);
+
+    double const assimilation_tolerance = get_assimilation_tolerance();  // micromol / m^2 / s
+
+    std::vector<double> sweep_values = {enzyme_sf};
+    for (const double* ip : enzyme_sf_ips) {
+        sweep_values.push_back(*ip);
+    }
+
+    // Calculate final values for assimilation, stomatal conductance, and Ci
+    // for all values of enzyme_sf at once
+    YggRpcClient rpc = get_comm();
+    std::vector<struct c3_str> const photo =
+        c3photoC_batch(
+            rpc,
+            incident_ppfd, leaf_temperature, rh, Rd, b0, b1, Gs_min, Catm,
+            atmospheric_pressure, StomataWS, water_stress_approach,
+            sweep_values, ci_solver_approach, assimilation_tolerance,
+            &warm_start);
+
+    // Update the outputs
+    update_outputs(photo[0], et, assimilation_tolerance);
+
+    for (size_t k = 0; k < enzyme_sf_ips.size(); ++k) {
+        update(Assim_ops[k], photo[k + 1].Assim);
+        update(GrossAssim_ops[k], photo[k + 1].GrossAssim);
+        update(Ci_ops[k], photo[k + 1].Ci);
+        update(Gs_ops[k], photo[k + 1].Gs);
+        update(iterTimes_ops[k], photo[k + 1].iterTimes);
+    }
+}
+
 }
 
 #endif // WITH_YGGDRASIL
@@ -6,7 +6,10 @@
 
 #ifdef WITH_YGGDRASIL
 
+#include <vector>
 #include "yggdrasil_modules.h"
+#include "AuxBioCro.h"  // for ET_Str
+#include "c3photo.hpp"  // for c3_str, c3_warm_start, c3photoC_coroutine
 
 namespace yggdrasilBML
 {
@@ -17,6 +20,34 @@ namespace yggdrasilBML
  * @brief Uses the ePhotosynthesis model to calculate leaf photosynthesis
  *   parameters for C3/C4 plants
  *
+ * The Ci iteration stops when the change in net assimilation falls below a
+ * tolerance. When `tolerance_approach` is 0, this is 0.01 micromol / m^2 / s
+ * for every leaf. When `tolerance_approach` is 1, it is divided by
+ * `relative_canopy_weight` (the weight of the leaf in the canopy integral
+ * relative to the mean weight; see `multilayer_canopy_photosynthesis`), so
+ * that leaves contributing little to the canopy totals are solved less
+ * precisely while the weighted sum of tolerances over the canopy is
+ * unchanged. The tolerance is never loosened by more than a factor of 100.
+ * The value used is reported as `assimilation_tolerance`.
+ *
+ * The leaf temperature is found from an FvCB solution at air temperature. The
+ * FvCB solution is then corrected to the leaf temperature, starting from the
+ * Ci found at air temperature, and used as the starting point for the Ci
+ * iteration with ePhotosynthesis. The temperature response of the day
+ * respiration rate is calculated once and shared by both models. The FvCB
+ * solutions are found iteratively when `fvcb_solver_approach` is 0, in closed
+ * form when it is 1, and iteratively with an accelerated Ci update when it is
+ * 2.
+ *
+ * The calculation can also be split into steps so that a canopy module can
+ * solve many leaves together from a single thread: `start_leaf()` runs the
+ * FvCB and energy balance calculations and returns the Ci iteration suspended
+ * at its first request to the ePhotosynthesis server, `resume_leaves()`
+ * advances several suspended leaves with a single batched message (or one
+ * message per leaf if the server does not accept batches), and
+ * `finish_leaf()` sets the outputs once the iteration is done. Running these
+ * steps for a single leaf gives the same results as `run()`.
+ *
  * @tparam C4 If true, the C4 version of the ePhotosynthesis model will
  *   be used (not currently implemented).
  */
@@ -57,6 +88,10 @@ public ygg_direct_module< ephotosynthesis< C4 > >
           minimum_gbw(get_input(input_quantities, "minimum_gbw")),
           windspeed_height{get_input(input_quantities, "windspeed_height")},
           enzyme_sf{get_input(input_quantities, "enzyme_sf")},
+          ci_solver_approach{get_input(input_quantities, "ci_solver_approach")},
+          tolerance_approach{get_input(input_quantities, "tolerance_approach")},
+          relative_canopy_weight{get_input(input_quantities, "relative_canopy_weight")},
+          fvcb_solver_approach{get_input(input_quantities, "fvcb_solver_approach")},
 
           // Get pointers to output quantities
           Assim_op(get_op(output_quantities, "Assim")),
@@ -69,14 +104,32 @@ public ygg_direct_module< ephotosynthesis< C4 > >
           EPenman_op(get_op(output_quantities, "EPenman")),
           EPriestly_op(get_op(output_quantities, "EPriestly")),
           leaf_temperature_op(get_op(output_quantities, "leaf_temperature")),
-          gbw_op(get_op(output_quantities, "gbw"))
+          gbw_op(get_op(output_quantities, "gbw")),
+          assimilation_tolerance_op(get_op(output_quantities, "assimilation_tolerance"))
     {
     }
     static string_vector get_inputs();
     static string_vector get_outputs();
     static std::string get_name() { return "ephotosynthesis"; }
 
-   private:
+    // A leaf whose Ci iteration is in progress, along with the quantities
+    // needed to set the outputs once it is done
+    struct suspended_leaf {
+        struct ET_Str et;
+        double assimilation_tolerance;  // micromol / m^2 / s
+        c3photoC_coroutine photo;
+    };
+
+    // Steps of the main operation; see above
+    suspended_leaf start_leaf() const;
+    void resume_leaves(std::vector<suspended_leaf*> const& leaves) const;
+    void finish_leaf(suspended_leaf const& leaf) const;
+
+    // The outputs only depend on `relative_canopy_weight` when it is used to
+    // scale the tolerance; see `MLCPnew::leaf_uses_relative_canopy_weight()`
+    bool uses_relative_canopy_weight() const { return tolerance_approach == 1; }
+
+   protected:
     // References to input quantities
     double const& incident_ppfd;
     double const& temp;
@@ -103,6 +156,10 @@ public ygg_direct_module< ephotosynthesis< C4 > >
     double const& minimum_gbw;
     double const& windspeed_height;
     double const& enzyme_sf;
+    double const& ci_solver_approach;
+    double const& tolerance_approach;
+    double const& relative_canopy_weight;
+    double const& fvcb_solver_approach;
 
     // Pointers to output quantities
     double* Assim_op;
@@ -116,7 +173,19 @@ public ygg_direct_module< ephotosynthesis< C4 > >
     double* EPriestly_op;
     double* leaf_temperature_op;
     double* gbw_op;
+    double* assimilation_tolerance_op;
+
+    // Steps shared with `c3_ephotosynthesis_sweep`
+    struct c3_str initial_photosynthesis() const;
+    struct ET_Str leaf_energy_balance(double initial_stomatal_conductance) const;
+    struct c3_warm_start get_warm_start(double leaf_temperature, double initial_Ci) const;
+    double get_assimilation_tolerance() const;
+    void update_outputs(
+        struct c3_str const& photo,
+        struct ET_Str const& et,
+        double assimilation_tolerance) const;
 
+   private:
     // Main operation
     void do_operation() const;
 };
@@ -124,6 +193,66 @@ public ygg_direct_module< ephotosynthesis< C4 > >
 typedef ephotosynthesis<false> c3_ephotosynthesis;
 // typedef ephotosynthesis<true> c4_ephotosynthesis;
 
+/**
+ * @class c3_ephotosynthesis_sweep
+ *
+ * @brief Calculates the same quantities as `c3_ephotosynthesis` for
+ *   `enzyme_sf`, and also calculates assimilation, stomatal conductance, and
+ *   Ci for several other values of `enzyme_sf` (`enzyme_sf_1`, `enzyme_sf_2`,
+ *   and so on).
+ *
+ * The leaf temperature is calculated once, from the FvCB model, which does not
+ * depend on `enzyme_sf`. The Ci iteration is then run for all values together
+ * with `c3photoC_batch`, which sends a single batched message to the
+ * ePhotosynthesis server per iteration.
+ *
+ * The outputs for each additional value have a suffix identifying the value;
+ * for example, `Assim_sf_1` is the net assimilation rate calculated using
+ * `enzyme_sf_1`. The outputs without a suffix are calculated using
+ * `enzyme_sf`, so this module can replace `c3_ephotosynthesis` in a canopy.
+ *
+ * This is not a replacement for a separate simulation with each value. Only
+ * the outputs for `enzyme_sf` affect the rest of a simulation, so the state
+ * variables (leaf area, biomass, and so on), the canopy light profile, and
+ * the leaf temperature all follow the trajectory determined by `enzyme_sf`.
+ * The other outputs are the responses of a leaf to each value under those
+ * same conditions, which is a sensitivity of instantaneous leaf
+ * photosynthesis rather than of the growing season.
+ *
+ * The ePhotosynthesis server must apply the `enzyme_sf` member of each
+ * request. The server in `models/ePhotosynthesis_C` does not, so this module
+ * and `ten_layer_c3_canopy_sweep` are not registered in the module library.
+ */
+class c3_ephotosynthesis_sweep : public c3_ephotosynthesis
+{
+   public:
+    c3_ephotosynthesis_sweep(
+        state_map const& input_quantities,
+        state_map* output_quantities);
+    static string_vector get_inputs();
+    static string_vector get_outputs();
+    static std::string get_name() { return "c3_ephotosynthesis_sweep"; }
+
+   private:
+    // Number of additional enzyme_sf values
+    int static const nsweep;
+
+    static std::string get_sweep_name(std::string const& name, int k);
+
+    // Pointers to input quantities for each additional value
+    std::vector<const double*> enzyme_sf_ips;
+
+    // Pointers to output quantities for each additional value
+    std::vector<double*> Assim_ops;
+    std::vector<double*> GrossAssim_ops;
+    std::vector<double*> Ci_ops;
+    std::vector<double*> Gs_ops;
+    std::vector<double*> iterTimes_ops;
+
+    // Main operation
+    void do_operation() const;
+};
+
 }  // namespace yggdrasilBML
 
 #endif // WITH_YGGDRASIL
@@ -0,0 +1,439 @@
+#include "fused_c3_canopy_fvcb.h"
+#include "../framework/constants.h"  // for molar_mass_of_water, molar_mass_of_glucose
+#include "BioCro.h"                  // for sunML, RHprof, WINDprof, c3_air_conditions_at, c3EvapoTrans
+#include "c3photo.hpp"               // for c3photoC_FvCB, c3photoC_FvCB_batch, c3_temperature_response_at
+#include "c3_leaf_fvcb.h"            // for c3_leaf_fvcb
+
+using yggdrasilBML::fused_c3_canopy_fvcb;
+
+// The canopy inputs and leaf classes do not depend on the number of layers
+using one_layer_canopy_properties = yggdrasilBML::n_layer_canopy_properties<1>;
+
+namespace
+{
+// The outputs of one leaf, in the same order as `c3_leaf_fvcb::get_outputs()`
+struct leaf_outputs {
+    double Assim;             // micromole / m^2 /s
+    double GrossAssim;        // micromole / m^2 /s
+    double Ci;                // micromole / mol
+    double Gs;                // mmol / m^2 / s
+    double iterTimes;         //
+    double TransR;            // mmol / m^2 / s
+    double EPenman;           // mmol / m^2 / s
+    double EPriestly;         // mmol / m^2 / s
+    double leaf_temperature;  // deg. C
+    double gbw;               // mol / m^2 / s
+};
+
+// The members of `leaf_outputs`, in order
+double leaf_outputs::*const leaf_output_members[] = {
+    &leaf_outputs::Assim,
+    &leaf_outputs::GrossAssim,
+    &leaf_outputs::Ci,
+    &leaf_outputs::Gs,
+    &leaf_outputs::iterTimes,
+    &leaf_outputs::TransR,
+    &leaf_outputs::EPenman,
+    &leaf_outputs::EPriestly,
+    &leaf_outputs::leaf_temperature,
+    &leaf_outputs::gbw};
+}  // namespace
+
+fused_c3_canopy_fvcb::fused_c3_canopy_fvcb(
+    int const& nlayers,
+    bool const& report_diagnostics,
+    state_map const& input_quantities,
+    state_map* output_quantities)
+    : direct_module(),
+
+      // Store the number of layers
+      nlayers(nlayers),
+
+      // Get references to canopy input quantities
+      par_incident_direct(get_input(input_quantities, "par_incident_direct")),
+      par_incident_diffuse(get_input(input_quantities, "par_incident_diffuse")),
+      absorptivity_par(get_input(input_quantities, "absorptivity_par")),
+      lai(get_input(input_quantities, "lai")),
+      cosine_zenith_angle(get_input(input_quantities, "cosine_zenith_angle")),
+      kd(get_input(input_quantities, "kd")),
+      chil(get_input(input_quantities, "chil")),
+      heightf(get_input(input_quantities, "heightf")),
+      rh(get_input(input_quantities, "rh")),
+      windspeed(get_input(input_quantities, "windspeed")),
+      LeafN(get_input(input_quantities, "LeafN")),
+      kpLN(get_input(input_quantities, "kpLN")),
+      lnfun(get_input(input_quantities, "lnfun")),
+      par_energy_content(get_input(input_quantities, "par_energy_content")),
+      par_energy_fraction(get_input(input_quantities, "par_energy_fraction")),
+      leaf_transmittance(get_input(input_quantities, "leaf_transmittance")),
+      leaf_reflectance(get_input(input_quantities, "leaf_reflectance")),
+      canopy_layer_approach(get_input(input_quantities, "canopy_layer_approach")),
+
+      // Get references to leaf input quantities
+      temp(get_input(input_quantities, "temp")),
+      vmax1(get_input(input_quantities, "vmax1")),
+      jmax(get_input(input_quantities, "jmax")),
+      tpu_rate_max(get_input(input_quantities, "tpu_rate_max")),
+      Rd(get_input(input_quantities, "Rd")),
+      b0(get_input(input_quantities, "b0")),
+      b1(get_input(input_quantities, "b1")),
+      Gs_min(get_input(input_quantities, "Gs_min")),
+      Catm(get_input(input_quantities, "Catm")),
+      atmospheric_pressure(get_input(input_quantities, "atmospheric_pressure")),
+      O2(get_input(input_quantities, "O2")),
+      theta(get_input(input_quantities, "theta")),
+      StomataWS(get_input(input_quantities, "StomataWS")),
+      water_stress_approach(get_input(input_quantities, "water_stress_approach")),
+      electrons_per_carboxylation(get_input(input_quantities, "electrons_per_carboxylation")),
+      electrons_per_oxygenation(get_input(input_quantities, "electrons_per_oxygenation")),
+      specific_heat_of_air(get_input(input_quantities, "specific_heat_of_air")),
+      minimum_gbw(get_input(input_quantities, "minimum_gbw")),
+      windspeed_height(get_input(input_quantities, "windspeed_height")),
+      fvcb_solver_approach(get_input(input_quantities, "fvcb_solver_approach")),
+      growth_respiration_fraction(get_input(input_quantities, "growth_respiration_fraction")),
+
+      // Get pointers to output quantities
+      canopy_assimilation_rate_op(get_op(output_quantities, "canopy_assimilation_rate")),
+      canopy_transpiration_rate_op(get_op(output_quantities, "canopy_transpiration_rate")),
+      canopy_conductance_op(get_op(output_quantities, "canopy_conductance")),
+      GrossAssim_op(get_op(output_quantities, "GrossAssim")),
+      canopy_direct_transmission_fraction_op(nullptr),
+      profile_values(nprofiles * nlayers)
+{
+    if (report_diagnostics) {
+        for (std::string const& name : c3_leaf_fvcb::get_outputs()) {
+            for (std::string const& class_name : one_layer_canopy_properties::define_leaf_classes()) {
+                for (int i = 0; i < nlayers; ++i) {
+                    leaf_diagnostic_ops.push_back(get_op(
+                        output_quantities,
+                        add_class_prefix_to_quantity_name(
+                            class_name,
+                            add_layer_suffix_to_quantity_name(nlayers, i, name))));
+                }
+            }
+        }
+
+        canopy_direct_transmission_fraction_op =
+            get_op(output_quantities, "canopy_direct_transmission_fraction");
+    }
+}
+
+string_vector fused_c3_canopy_fvcb::generate_inputs(int /*nlayers*/)
+{
+    // The canopy inputs are the same as those of the canopy properties module
+    string_vector inputs = one_layer_canopy_properties::get_inputs();
+
+    string_vector const leaf_inputs = {
+        "temp",                         // deg. C
+        "vmax1",                        // micromole / m^2 / s
+        "jmax",                         // micromole / m^2 / s
+        "tpu_rate_max",                 // micromole / m^2 / s
+        "Rd",                           // micromole / m^2 / s
+        "b0",                           // mol / m^2 / s
+        "b1",                           // dimensionless
+        "Gs_min",                       // mol / m^2 / s
+        "Catm",                         // micromole / mol
+        "atmospheric_pressure",         // Pa
+        "O2",                           // mmol / mol
+        "theta",                        // dimensionless
+        "StomataWS",                    // dimensionless
+        "water_stress_approach",        // a dimensionless switch
+        "electrons_per_carboxylation",  // electron / carboxylation
+        "electrons_per_oxygenation",    // electron / oxygenation
+        "specific_heat_of_air",         // J / kg / K
+        "minimum_gbw",                  // mol / m^2 / s
+        "windspeed_height",             // m
+        "fvcb_solver_approach",         // a dimensionless switch
+        "growth_respiration_fraction"   // dimensionless
+    };
+
+    for (std::string const& name : leaf_inputs) {
+        inputs.push_back(name);
+    }
+
+    return inputs;
+}
+
+string_vector fused_c3_canopy_fvcb::generate_outputs(int nlayers, bool report_diagnostics)
+{
+    string_vector outputs = {
+        "canopy_assimilation_rate",   // Mg / ha / hr
+        "canopy_transpiration_rate",  // Mg / ha / hr
+        "canopy_conductance",         // mmol / m^2 / s
+        "GrossAssim"                  // Mg / ha / hr
+    };
+
+    if (report_diagnostics) {
+        // Add prefixes and suffixes to the leaf module outputs
+        string_vector leaf_outputs = generate_multilayer_quantity_names(
+            nlayers,
+            generate_multiclass_quantity_names(
+                one_layer_canopy_properties::define_leaf_classes(),
+                c3_leaf_fvcb::get_outputs()));
+
+        for (std::string const& name : leaf_outputs) {
+            outputs.push_back(name);
+        }
+
+        outputs.push_back("canopy_direct_transmission_fraction");  // dimensionless
+    }
+
+    return outputs;
+}
+
+void fused_c3_canopy_fvcb::run() const
+{
+    // Calculate the light profile as in `multilayer_canopy_properties`,
+    // storing only the quantities used by the leaves and the canopy integral
+    auto profile = [this](int k) { return &profile_values[k * nlayers]; };
+
+    double* const sunlit_incident_ppfd = profile(0);
+    double* const shaded_incident_ppfd = profile(1);
+    double* const average_absorbed_shortwave = profile(2);
+    double* const sunlit_fraction = profile(3);
+    double* const shaded_fraction = profile(4);
+    double* const height = profile(5);
+    double* const layer_depth = profile(6);
+    double* const layer_weight = profile(7);
+
+    double const canopy_direct_transmission_fraction = sunML(
+        par_incident_direct / par_energy_content,   // micromol / (m^2 beam) / s
+        par_incident_diffuse / par_energy_content,  // micromol / m^2 / s
+        lai,
+        nlayers,
+        cosine_zenith_angle,
+        kd,
+        chil,
+        absorptivity_par,
+        heightf,
+        par_energy_content,
+        par_energy_fraction,
+        leaf_transmittance,
+        leaf_reflectance,
+        static_cast<int>(canopy_layer_approach),
+        {sunlit_incident_ppfd,
+         nullptr,
+         shaded_incident_ppfd,
+         nullptr,
+         nullptr,
+         nullptr,
+         average_absorbed_shortwave,
+         sunlit_fraction,
+         shaded_fraction,
+         height,
+         layer_depth,
+         layer_weight});
+
+    double* const relative_humidity_profile = profile(8);
+    double* const wind_speed_profile = profile(9);
+
+    if (canopy_layer_approach == 0) {
+        RHprof(rh, nlayers, relative_humidity_profile);         // Modifies relative_humidity_profile
+        WINDprof(windspeed, lai, nlayers, wind_speed_profile);  // Modifies wind_speed_profile
+    } else {
+        RHprof(rh, nlayers, layer_depth, relative_humidity_profile);         // Modifies relative_humidity_profile
+        WINDprof(windspeed, lai, nlayers, layer_depth, wind_speed_profile);  // Modifies wind_speed_profile
+    }
+
+    // Don't calculate anything based on the nitrogen profile, which is
+    // therefore not needed
+    if (lnfun != 0) {
+        throw std::logic_error("Thrown by the fused_c3_canopy_fvcb module: lnfun != 0 is not yet supported.");
+    }
+
+    // The temperature response at air temperature is the same for every leaf
+    struct c3_temperature_response const air_temperature_response =
+        c3_temperature_response_at(
+            temp, vmax1, jmax, tpu_rate_max, Rd, theta, O2);
+
+    bool const report_diagnostics = !leaf_diagnostic_ops.empty();
+
+    double const LAIc = lai / nlayers;
+
+    // The leaf area of each leaf class (0 for sunlit, 1 for shaded) in each
+    // layer
+    auto leaf_lai = [&](int c, int i) -> double {
+        double const layer_lai = LAIc * layer_weight[i];
+        return (c == 0 ? sunlit_fraction[i] : shaded_fraction[i]) * layer_lai;
+    };
+
+    // Whether a leaf is calculated; leaves with no weight in the canopy are
+    // not, and a shaded leaf uses the sunlit leaf's results when the two
+    // receive the same PPFD, since they then have the same inputs
+    auto is_calculated = [&](int c, int i) -> bool {
+        bool const sunlit_calculated = leaf_lai(0, i) != 0;
+        if (c == 0) {
+            return sunlit_calculated;
+        }
+        return leaf_lai(1, i) != 0 &&
+               !(sunlit_calculated && shaded_incident_ppfd[i] == sunlit_incident_ppfd[i]);
+    };
+
+    // The FvCB solutions at air temperature (the first step of `c3_leaf_fvcb`)
+    // do not depend on the energy balance. For the iterative solver, they can
+    // be found for all calculated leaves at once with `c3photoC_FvCB_batch`,
+    // which gives the same results. This is only done when the batch solver
+    // is faster, i.e., with `water_stress_approach` set to 1 and at least
+    // `c3_fvcb_min_batch_size` leaves (16 or more layers in the daytime).
+    std::vector<int> batch_leaves;  // the class index times `nlayers` plus the layer index for each leaf
+    if (fvcb_solver_approach == 0 && water_stress_approach == 1) {
+        for (int c = 0; c < 2; ++c) {
+            for (int i = 0; i < nlayers; ++i) {
+                if (is_calculated(c, i)) {
+                    batch_leaves.push_back(c * nlayers + i);
+                }
+            }
+        }
+    }
+
+    std::vector<struct c3_str> batch_initial_photo;  // indexed by class and then by layer
+    if (batch_leaves.size() >= c3_fvcb_min_batch_size) {
+        size_t const n = batch_leaves.size();
+
+        struct c3_fvcb_batch_inputs batch;
+        for (int const leaf : batch_leaves) {
+            int const i = leaf % nlayers;
+            batch.Qp.push_back(leaf < nlayers ? sunlit_incident_ppfd[i] : shaded_incident_ppfd[i]);
+            batch.RH.push_back(relative_humidity_profile[i]);
+        }
+
+        batch.Tleaf.assign(n, temp);
+        batch.Vcmax0.assign(n, vmax1);
+        batch.Jmax0.assign(n, jmax);
+        batch.TPU_rate_max.assign(n, tpu_rate_max);
+        batch.Rd0.assign(n, Rd);
+        batch.bb0.assign(n, b0);
+        batch.bb1.assign(n, b1);
+        batch.Gs_min.assign(n, Gs_min);
+        batch.Ca.assign(n, Catm);
+        batch.AP.assign(n, atmospheric_pressure);
+        batch.O2.assign(n, O2);
+        batch.thet.assign(n, theta);
+        batch.StomWS.assign(n, StomataWS);
+
+        struct c3_fvcb_batch_outputs const photo = c3photoC_FvCB_batch(
+            batch, water_stress_approach, electrons_per_carboxylation,
+            electrons_per_oxygenation);
+
+        batch_initial_photo.resize(2 * nlayers);
+        for (size_t k = 0; k < n; ++k) {
+            batch_initial_photo[batch_leaves[k]] = {
+                photo.Assim[k], photo.Gs[k], photo.Ci[k], photo.GrossAssim[k],
+                photo.iterTimes[k], 0.0};
+        }
+    }
+
+    // Calculate the outputs of one leaf, following the same steps as
+    // `c3_leaf_fvcb`
+    auto solve_leaf = [&](int c, int i,
+                          struct c3_air_conditions const& air) -> leaf_outputs {
+        double const incident_ppfd = c == 0 ? sunlit_incident_ppfd[i] : shaded_incident_ppfd[i];  // micromol / m^2 / s
+        double const leaf_rh = relative_humidity_profile[i];                                       // dimensionless
+
+        const struct c3_str initial_photo =
+            batch_initial_photo.empty()
+                ? c3photoC_FvCB(
+                      air_temperature_response,
+                      incident_ppfd, leaf_rh, b0, b1, Gs_min, Catm, atmospheric_pressure,
+                      StomataWS, water_stress_approach, electrons_per_carboxylation,
+                      electrons_per_oxygenation, 0.0, fvcb_solver_approach)
+                : batch_initial_photo[c * nlayers + i];
+
+        const struct ET_Str et =
+            c3EvapoTrans(air, average_absorbed_shortwave[i], initial_photo.Gs);
+
+        double const leaf_temperature = temp + et.Deltat;  // deg. C
+
+        const struct c3_str photo =
+            c3photoC_FvCB(
+                c3_temperature_response_at(
+                    leaf_temperature, vmax1, jmax, tpu_rate_max, Rd, theta, O2),
+                incident_ppfd, leaf_rh, b0, b1, Gs_min, Catm, atmospheric_pressure,
+                StomataWS, water_stress_approach, electrons_per_carboxylation,
+                electrons_per_oxygenation, initial_photo.Ci, fvcb_solver_approach);
+
+        return {photo.Assim, photo.GrossAssim, photo.Ci, photo.Gs,
+                photo.iterTimes, et.TransR, et.EPenman, et.EPriestly,
+                leaf_temperature, et.boundary_layer_conductance};
+    };
+
+    double canopy_assimilation_rate = 0;
+    double canopy_transpiration_rate = 0;
+    double canopy_conductance = 0;
+    double GrossAssim = 0;
+
+    // Calculate the sunlit and shaded leaves in each layer and add them to the
+    // canopy integral as in `multilayer_canopy_integrator`
+    for (int i = 0; i < nlayers; ++i) {
+        double const sunlit_lai = leaf_lai(0, i);
+        double const shaded_lai = leaf_lai(1, i);
+
+        // The air conditions are the same for both leaves in the layer
+        struct c3_air_conditions const air =
+            c3_air_conditions_at(
+                temp, relative_humidity_profile[i], wind_speed_profile[i],
+                height[i], specific_heat_of_air, minimum_gbw,
+                windspeed_height);
+
+        leaf_outputs sunlit = is_calculated(0, i) ? solve_leaf(0, i, air) : leaf_outputs{};
+
+        // A leaf that is not calculated uses the other leaf's results when the
+        // two receive the same PPFD and the other leaf was calculated, as in
+        // `multilayer_canopy_photosynthesis`; otherwise its outputs are zero
+        bool const same_ppfd = shaded_incident_ppfd[i] == sunlit_incident_ppfd[i];
+
+        leaf_outputs shaded = {};
+        if (is_calculated(1, i)) {
+            shaded = solve_leaf(1, i, air);
+            if (sunlit_lai == 0 && same_ppfd) {
+                sunlit = shaded;
+            }
+        } else if (shaded_lai != 0 || (same_ppfd && sunlit_lai != 0)) {
+            shaded = sunlit;
+        }
+
+        if (report_diagnostics) {
+            size_t k = 0;
+            for (double leaf_outputs::*member : leaf_output_members) {
+                update(leaf_diagnostic_ops[(k * 2) * nlayers + i], sunlit.*member);
+                update(leaf_diagnostic_ops[(k * 2 + 1) * nlayers + i], shaded.*member);
+                ++k;
+            }
+        }
+
+        if (sunlit.Assim > 50.0 || shaded.Assim > 50.0) {
+            continue;
+        }
+
+        canopy_assimilation_rate += sunlit.Assim * sunlit_lai +
+                                    shaded.Assim * shaded_lai;
+
+        canopy_transpiration_rate += sunlit.TransR * sunlit_lai +
+                                     shaded.TransR * shaded_lai;
+
+        canopy_conductance += sunlit.Gs * sunlit_lai +
+                              shaded.Gs * shaded_lai;
+
+        GrossAssim += sunlit.GrossAssim * sunlit_lai +
+                      shaded.GrossAssim * shaded_lai;
+    }
+
+    // Modify net assimilation to account for respiration, and convert the
+    // totals to the same units as `multilayer_canopy_integrator`
+    canopy_assimilation_rate *= (1.0 - growth_respiration_fraction);
+
+    const double cf = physical_constants::molar_mass_of_glucose * 6e-3;  // (Mg / ha / hr) / (micromol / m^2 / s)
+    const double cf2 = physical_constants::molar_mass_of_water * 36;     // (Mg / ha / hr) / (mmol / m^2 / s)
+
+    update(canopy_assimilation_rate_op, canopy_assimilation_rate * cf);
+
+    update(GrossAssim_op, GrossAssim * cf);
+
+    update(canopy_transpiration_rate_op, canopy_transpiration_rate * cf2);
+
+    update(canopy_conductance_op, canopy_conductance);
+
+    if (canopy_direct_transmission_fraction_op) {
+        update(canopy_direct_transmission_fraction_op, canopy_direct_transmission_fraction);
+    }
+}
@@ -0,0 +1,186 @@
+#ifndef FUSED_C3_CANOPY_FVCB_H
+#define FUSED_C3_CANOPY_FVCB_H
+
+#include "../framework/state_map.h"
+#include "../framework/module.h"
+#include "AuxBioCro.h"                     // for MAXLAY
+#include "multilayer_canopy_properties.h"  // for layer_count_name
+
+namespace yggdrasilBML
+{
+/**
+ * @class fused_c3_canopy_fvcb
+ *
+ * @brief Calculates canopy assimilation, transpiration, and conductance for a
+ * multilayer canopy with `c3_leaf_fvcb` leaves in a single module, producing
+ * the same canopy totals as the `multilayer_canopy_properties`,
+ * `n_layer_c3_canopy_fvcb`, and `multilayer_canopy_integrator` modules run in
+ * turn.
+ *
+ * When those three modules are used, every property of every layer and leaf
+ * class (hundreds of quantities for a ten-layer canopy) is written to the
+ * model state by one module and read back by the next in each evaluation. Here
+ * the light profile, the leaf calculations, and the canopy integral are done
+ * in one pass over local arrays, and only the canopy totals are reported. The
+ * leaf temperature response at air temperature is calculated once for the
+ * whole canopy, and the air conditions used by `c3EvapoTrans` are calculated
+ * once for each layer, since they are the same for every leaf that shares
+ * them. A shaded leaf that receives the same PPFD as the sunlit leaf in its
+ * layer uses the sunlit leaf's results.
+ *
+ * When `report_diagnostics` is true, the `c3_leaf_fvcb` outputs for each leaf
+ * class and layer are also reported, with the same names and values as the
+ * outputs of `n_layer_c3_canopy_fvcb`, along with
+ * `canopy_direct_transmission_fraction`. Leaves with no weight in the canopy
+ * (such as the sunlit leaves when the sun is below the horizon) are not
+ * calculated, since they do not affect the canopy totals; as in
+ * `multilayer_canopy_photosynthesis`, such a leaf reports the results of the
+ * other leaf in its layer when the two receive the same PPFD, and zero
+ * otherwise.
+ *
+ * Note that this module has a non-standard constructor, so it cannot be created
+ * using the module_factory. Rather, it is expected that directly-usable
+ * classes will be derived from this class.
+ */
+class fused_c3_canopy_fvcb : public direct_module
+{
+   public:
+    fused_c3_canopy_fvcb(
+        int const& nlayers,
+        bool const& report_diagnostics,
+        state_map const& input_quantities,
+        state_map* output_quantities);
+
+   private:
+    // Number of layers
+    int const nlayers;
+
+    // References to canopy input quantities
+    double const& par_incident_direct;
+    double const& par_incident_diffuse;
+    double const& absorptivity_par;
+    double const& lai;
+    double const& cosine_zenith_angle;
+    double const& kd;
+    double const& chil;
+    double const& heightf;
+    double const& rh;
+    double const& windspeed;
+    double const& LeafN;
+    double const& kpLN;
+    double const& lnfun;
+    double const& par_energy_content;
+    double const& par_energy_fraction;
+    double const& leaf_transmittance;
+    double const& leaf_reflectance;
+    double const& canopy_layer_approach;
+
+    // References to leaf input quantities
+    double const& temp;
+    double const& vmax1;
+    double const& jmax;
+    double const& tpu_rate_max;
+    double const& Rd;
+    double const& b0;
+    double const& b1;
+    double const& Gs_min;
+    double const& Catm;
+    double const& atmospheric_pressure;
+    double const& O2;
+    double const& theta;
+    double const& StomataWS;
+    double const& water_stress_approach;
+    double const& electrons_per_carboxylation;
+    double const& electrons_per_oxygenation;
+    double const& specific_heat_of_air;
+    double const& minimum_gbw;
+    double const& windspeed_height;
+    double const& fvcb_solver_approach;
+    double const& growth_respiration_fraction;
+
+    // Pointers to output quantities
+    double* canopy_assimilation_rate_op;
+    double* canopy_transpiration_rate_op;
+    double* canopy_conductance_op;
+    double* GrossAssim_op;
+
+    // Pointers to diagnostic output quantities, if they are reported; the
+    // leaf outputs are stored as one array for each output, ordered by leaf
+    // class and then by layer, so output `k` for class `c` and layer `i` is at
+    // `(k * 2 + c) * nlayers + i`
+    std::vector<double*> leaf_diagnostic_ops;
+    double* canopy_direct_transmission_fraction_op;
+
+    // Storage for the profiles calculated in each evaluation, with `nlayers`
+    // elements for each of the `nprofiles` profiles
+    static int const nprofiles = 10;
+    mutable std::vector<double> profile_values;
+
+   protected:
+    static string_vector generate_inputs(int nlayers);
+    static string_vector generate_outputs(int nlayers, bool report_diagnostics);
+    void run() const;
+};
+
+////////////////////////////////////////
+// N LAYER FUSED C3 CANOPY FVCB MODULE //
+////////////////////////////////////////
+
+/**
+ * @class n_layer_fused_c3_canopy_fvcb
+ *
+ * @brief A child class of fused_c3_canopy_fvcb where the number of layers has
+ * been defined by the template parameter `N`, which must be between 1 and
+ * `MAXLAY`, and diagnostic outputs are reported if `D` is true. Instances of
+ * this class can be created using the module factory, unlike the parent class
+ * `fused_c3_canopy_fvcb`.
+ *
+ * The module name is formed from the number of layers; for example, the module
+ * with `N = 10` is called `ten_layer_fused_c3_canopy_fvcb`, and the module
+ * that also reports diagnostic outputs is called
+ * `ten_layer_fused_c3_canopy_fvcb_diagnostics`.
+ */
+template <int N, bool D>
+class n_layer_fused_c3_canopy_fvcb : public fused_c3_canopy_fvcb
+{
+    static_assert(N >= 1 && N <= MAXLAY, "N must be at least 1 but no more than MAXLAY");
+
+   public:
+    n_layer_fused_c3_canopy_fvcb(
+        state_map const& input_quantities,
+        state_map* output_quantities)
+        : fused_c3_canopy_fvcb(
+              N,
+              D,
+              input_quantities,
+              output_quantities)
+    {
+    }
+    static string_vector get_inputs()
+    {
+        // Just call the parent class's input function with the appropriate
+        // number of layers
+        return fused_c3_canopy_fvcb::generate_inputs(N);
+    }
+    static string_vector get_outputs()
+    {
+        // Just call the parent class's output function with the appropriate
+        // number of layers
+        return fused_c3_canopy_fvcb::generate_outputs(N, D);
+    }
+    static std::string get_name()
+    {
+        return layer_count_name(N) + "_layer_fused_c3_canopy_fvcb" +
+               (D ? "_diagnostics" : "");
+    }
+
+   private:
+    // Main operation
+    void do_operation() const { fused_c3_canopy_fvcb::run(); }
+};
+
+using ten_layer_fused_c3_canopy_fvcb = n_layer_fused_c3_canopy_fvcb<10, false>;
+using ten_layer_fused_c3_canopy_fvcb_diagnostics = n_layer_fused_c3_canopy_fvcb<10, true>;
+
+}  // namespace yggdrasilBML
+#endif
@@ -0,0 +1,308 @@
+#ifndef HYBRID_CANOPY_PHOTOSYNTHESIS_H
+#define HYBRID_CANOPY_PHOTOSYNTHESIS_H
+
+#include <algorithm>  // for std::find, std::sort, std::min
+#include <numeric>    // for std::iota
+#include "../framework/module.h"
+#include "../framework/state_map.h"
+#include "multilayer_canopy_photosynthesis.h"
+
+namespace yggdrasilBML
+{
+/**
+ * @class hybrid_canopy_photosynthesis
+ *
+ * @brief Applies one of two leaf photosynthesis modules to each layer and leaf
+ * class of a multilayer canopy, using the expensive high-fidelity module only
+ * for the leaves that matter most.
+ *
+ * Three modules must be specified as template arguments: a canopy properties
+ * module and two leaf photosynthesis modules, which are each applied to the
+ * canopy as in `multilayer_canopy_photosynthesis`. The low-fidelity leaf
+ * module must not produce any outputs that the high-fidelity module does not
+ * also produce.
+ *
+ * The leaf model used for each leaf is chosen according to the
+ * `hybrid_policy` input:
+ *
+ * - `0`: the high-fidelity model is used for leaves whose incident PPFD is at
+ *   least `high_fidelity_ppfd_threshold`
+ *
+ * - `1`: the high-fidelity model is used for leaves whose relative canopy
+ *   weight (see `multilayer_canopy_photosynthesis`) is at least
+ *   `high_fidelity_weight_threshold`
+ *
+ * - `2`: the low-fidelity model is first applied to every leaf, and the
+ *   high-fidelity model is then used for the `high_fidelity_leaf_count` leaves
+ *   with the largest contribution to canopy assimilation, i.e., the largest
+ *   product of relative canopy weight and low-fidelity net assimilation
+ *
+ * Outputs produced only by the high-fidelity module are set to zero for leaves
+ * served by the low-fidelity module. The model used for each leaf is reported
+ * by the `high_fidelity_used` output (1 for the high-fidelity model, 0 for the
+ * low-fidelity model), which receives the same class prefixes and layer
+ * suffixes as the other leaf outputs.
+ *
+ * Note that this module has a non-standard constructor, so it cannot be created
+ * using the module_factory. Rather, it is expected that directly-usable
+ * classes will be derived from this class.
+ */
+template <typename canopy_module_type,
+          typename high_fidelity_leaf_module_type,
+          typename low_fidelity_leaf_module_type>
+class hybrid_canopy_photosynthesis : public direct_module
+{
+   public:
+    hybrid_canopy_photosynthesis(
+        const int& nlayers,
+        state_map const& input_quantities,
+        state_map* output_quantities);
+
+   private:
+    // A canopy photosynthesis module for one of the leaf models, whose leaves
+    // can be run individually
+    template <typename leaf_module_type>
+    class single_model_canopy
+        : public multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>
+    {
+        using parent = multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>;
+
+       public:
+        single_model_canopy(
+            const int& nlayers,
+            state_map const& input_quantities,
+            state_map* output_quantities)
+            : parent(nlayers, input_quantities, output_quantities)
+        {
+        }
+        using parent::generate_inputs;
+        using parent::generate_outputs;
+        using parent::gather_leaf_inputs;
+        using parent::get_relative_canopy_weights;
+        using parent::run_leaf;
+
+       private:
+        void do_operation() const { parent::run(); }
+    };
+
+    using high_fidelity_canopy = single_model_canopy<high_fidelity_leaf_module_type>;
+    using low_fidelity_canopy = single_model_canopy<low_fidelity_leaf_module_type>;
+
+    // Number of layers
+    const int nlayers;
+
+    // Canopy photosynthesis modules for each leaf model
+    high_fidelity_canopy high_fidelity;
+    low_fidelity_canopy low_fidelity;
+
+    // References to input parameters
+    double const& hybrid_policy;
+    double const& high_fidelity_ppfd_threshold;
+    double const& high_fidelity_weight_threshold;
+    double const& high_fidelity_leaf_count;
+
+    // Pointers to input parameters for each leaf
+    std::vector<const double*> leaf_incident_ppfd_ips;
+
+    // Pointers to output parameters for each leaf
+    std::vector<const double*> leaf_low_fidelity_assim_ips;
+    std::vector<std::vector<double*>> leaf_high_fidelity_only_ops;
+    std::vector<double*> high_fidelity_used_ops;
+
+    static string_vector get_high_fidelity_only_outputs();
+
+   protected:
+    static string_vector generate_inputs(int nlayers);
+    static string_vector generate_outputs(int nlayers);
+    void run() const;
+};
+
+/**
+ * @brief Constructor for a hybrid canopy photosynthesis module, which
+ * initializes a canopy photosynthesis module for each leaf model and collects
+ * the pointers needed to choose between them.
+ */
+template <typename canopy_module_type,
+          typename high_fidelity_leaf_module_type,
+          typename low_fidelity_leaf_module_type>
+hybrid_canopy_photosynthesis<canopy_module_type, high_fidelity_leaf_module_type, low_fidelity_leaf_module_type>::hybrid_canopy_photosynthesis(
+    const int& nlayers,
+    state_map const& input_quantities,
+    state_map* output_quantities)
+    : direct_module(),
+      nlayers(nlayers),
+      high_fidelity(nlayers, input_quantities, output_quantities),
+      low_fidelity(nlayers, input_quantities, output_quantities),
+      hybrid_policy(get_input(input_quantities, "hybrid_policy")),
+      high_fidelity_ppfd_threshold(get_input(input_quantities, "high_fidelity_ppfd_threshold")),
+      high_fidelity_weight_threshold(get_input(input_quantities, "high_fidelity_weight_threshold")),
+      high_fidelity_leaf_count(get_input(input_quantities, "high_fidelity_leaf_count"))
+{
+    string_vector const high_fidelity_only_outputs = get_high_fidelity_only_outputs();
+
+    // The leaves must be visited in the same order as in
+    // `multilayer_canopy_photosynthesis`
+    for (std::string const& class_name : canopy_module_type::define_leaf_classes()) {
+        for (int i = 0; i < nlayers; ++i) {
+            auto specific_name = [&](std::string const& name) -> std::string {
+                return add_class_prefix_to_quantity_name(
+                    class_name,
+                    add_layer_suffix_to_quantity_name(nlayers, i, name));
+            };
+
+            leaf_incident_ppfd_ips.push_back(get_ip(input_quantities, specific_name("incident_ppfd")));
+            leaf_low_fidelity_assim_ips.push_back(get_op(output_quantities, specific_name("Assim")));
+            high_fidelity_used_ops.push_back(get_op(output_quantities, specific_name("high_fidelity_used")));
+
+            std::vector<double*> high_fidelity_only_ops;
+            for (std::string const& name : high_fidelity_only_outputs) {
+                high_fidelity_only_ops.push_back(get_op(output_quantities, specific_name(name)));
+            }
+            leaf_high_fidelity_only_ops.push_back(high_fidelity_only_ops);
+        }
+    }
+}
+
+/**
+ * @brief Returns outputs of the high-fidelity leaf module that are not
+ * produced by the low-fidelity leaf module
+ */
+template <typename canopy_module_type,
+          typename high_fidelity_leaf_module_type,
+          typename low_fidelity_leaf_module_type>
+string_vector hybrid_canopy_photosynthesis<canopy_module_type, high_fidelity_leaf_module_type, low_fidelity_leaf_module_type>::get_high_fidelity_only_outputs()
+{
+    string_vector low_fidelity_outputs = low_fidelity_leaf_module_type::get_outputs();
+    string_vector result;
+    for (std::string const& name : high_fidelity_leaf_module_type::get_outputs()) {
+        if (std::find(low_fidelity_outputs.begin(),
+                      low_fidelity_outputs.end(),
+                      name) == low_fidelity_outputs.end()) {
+            result.push_back(name);
+        }
+    }
+    return result;
+}
+
+template <typename canopy_module_type,
+          typename high_fidelity_leaf_module_type,
+          typename low_fidelity_leaf_module_type>
+string_vector hybrid_canopy_photosynthesis<canopy_module_type, high_fidelity_leaf_module_type, low_fidelity_leaf_module_type>::generate_inputs(int nlayers)
+{
+    // Combine the inputs required by each leaf model, along with the leaf
+    // class fractions, layer weights, and incident PPFD values used to choose
+    // between them
+    string_vector inputs = high_fidelity_canopy::generate_inputs(nlayers);
+
+    std::vector<string_vector> other_inputs = {
+        low_fidelity_canopy::generate_inputs(nlayers),
+        generate_multilayer_quantity_names(
+            nlayers,
+            generate_multiclass_quantity_names(
+                canopy_module_type::define_leaf_classes(),
+                {"fraction", "incident_ppfd"})),
+        generate_multilayer_quantity_names(nlayers, {"layer_weight"})};
+
+    for (string_vector const& sv : other_inputs) {
+        for (std::string const& name : sv) {
+            if (std::find(inputs.begin(), inputs.end(), name) == inputs.end()) {
+                inputs.push_back(name);
+            }
+        }
+    }
+
+    inputs.push_back("hybrid_policy");                   // a dimensionless switch
+    inputs.push_back("high_fidelity_ppfd_threshold");    // micromol / (m^2 leaf) / s
+    inputs.push_back("high_fidelity_weight_threshold");  // dimensionless
+    inputs.push_back("high_fidelity_leaf_count");        // dimensionless
+
+    return inputs;
+}
+
+template <typename canopy_module_type,
+          typename high_fidelity_leaf_module_type,
+          typename low_fidelity_leaf_module_type>
+string_vector hybrid_canopy_photosynthesis<canopy_module_type, high_fidelity_leaf_module_type, low_fidelity_leaf_module_type>::generate_outputs(int nlayers)
+{
+    // The low-fidelity outputs are a subset of the high-fidelity outputs
+    string_vector outputs = high_fidelity_canopy::generate_outputs(nlayers);
+
+    string_vector flag_outputs = generate_multilayer_quantity_names(
+        nlayers,
+        generate_multiclass_quantity_names(
+            canopy_module_type::define_leaf_classes(),
+            {"high_fidelity_used"}));
+
+    for (std::string const& name : flag_outputs) {
+        outputs.push_back(name);
+    }
+
+    return outputs;
+}
+
+template <typename canopy_module_type,
+          typename high_fidelity_leaf_module_type,
+          typename low_fidelity_leaf_module_type>
+void hybrid_canopy_photosynthesis<canopy_module_type, high_fidelity_leaf_module_type, low_fidelity_leaf_module_type>::run() const
+{
+    size_t const nleaves = leaf_incident_ppfd_ips.size();
+
+    // Determine the relative canopy weight of each leaf in the same way as
+    // `multilayer_canopy_photosynthesis`
+    std::vector<double> const relative_weight = high_fidelity.get_relative_canopy_weights();
+
+    high_fidelity.gather_leaf_inputs();
+    low_fidelity.gather_leaf_inputs();
+
+    // Choose a leaf model for each leaf
+    std::vector<bool> use_high_fidelity(nleaves, false);
+
+    if (hybrid_policy == 0) {
+        for (size_t i = 0; i < nleaves; ++i) {
+            use_high_fidelity[i] = *leaf_incident_ppfd_ips[i] >= high_fidelity_ppfd_threshold;
+        }
+    } else if (hybrid_policy == 1) {
+        for (size_t i = 0; i < nleaves; ++i) {
+            use_high_fidelity[i] = relative_weight[i] >= high_fidelity_weight_threshold;
+        }
+    } else if (hybrid_policy == 2) {
+        // Estimate the contribution of each leaf using the low-fidelity model
+        for (size_t i = 0; i < nleaves; ++i) {
+            low_fidelity.run_leaf(i, relative_weight[i]);
+        }
+
+        std::vector<size_t> order(nleaves);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return relative_weight[a] * *leaf_low_fidelity_assim_ips[a] >
+                   relative_weight[b] * *leaf_low_fidelity_assim_ips[b];
+        });
+
+        size_t const count =
+            std::min(nleaves, static_cast<size_t>(std::max(high_fidelity_leaf_count, 0.0)));
+
+        for (size_t j = 0; j < count; ++j) {
+            use_high_fidelity[order[j]] = true;
+        }
+    } else {
+        throw std::logic_error("Thrown by the hybrid_canopy_photosynthesis module: hybrid_policy must be 0, 1, or 2.");
+    }
+
+    // Run the chosen leaf model for each leaf
+    for (size_t i = 0; i < nleaves; ++i) {
+        if (use_high_fidelity[i]) {
+            high_fidelity.run_leaf(i, relative_weight[i]);
+        } else {
+            if (hybrid_policy != 2) {
+                low_fidelity.run_leaf(i, relative_weight[i]);
+            }
+            for (double* op : leaf_high_fidelity_only_ops[i]) {
+                update(op, 0.0);
+            }
+        }
+        update(high_fidelity_used_ops[i], use_high_fidelity[i] ? 1.0 : 0.0);
+    }
+}
+
+}  // namespace yggdrasilBML
+#endif
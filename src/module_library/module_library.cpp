@@ -3,19 +3,93 @@
 
 // Include all the header files that define the modules.
 #include "ephotosynthesis.h"
+#include "c3_leaf_fvcb.h"
 #include "multilayer_canopy_properties.h"
+#include "two_leaf_canopy_properties.h"
 #include "multilayer_c3_canopy.h"
 #include "multilayer_canopy_integrator.h"
+#include "adaptive_c3_canopy_fvcb.h"
+#include "fused_c3_canopy_fvcb.h"
 #include "ball_berry_module.hpp"
 #include "opensimroot.h"
 
 creator_map yggdrasilBML::module_library::library_entries =
 {
     {"ball_berry_module", &create_mc<ball_berry_module>},
+    {"ten_layer_canopy_properties", &create_mc<ten_layer_canopy_properties>},
+    {"c3_leaf_fvcb", &create_mc<c3_leaf_fvcb>},
+    {"ten_layer_c3_canopy_fvcb", &create_mc<ten_layer_c3_canopy_fvcb>},
+    {"ten_layer_canopy_integrator", &create_mc<ten_layer_canopy_integrator>},
+    // Canopy modules with other numbers of layers; more can be added here for
+    // any number of layers between 1 and MAXLAY
+    {"one_layer_canopy_properties", &create_mc<n_layer_canopy_properties<1>>},
+    {"one_layer_c3_canopy_fvcb", &create_mc<n_layer_c3_canopy_fvcb<1>>},
+    {"one_layer_canopy_integrator", &create_mc<n_layer_canopy_integrator<1>>},
+    {"two_layer_canopy_properties", &create_mc<n_layer_canopy_properties<2>>},
+    {"two_layer_c3_canopy_fvcb", &create_mc<n_layer_c3_canopy_fvcb<2>>},
+    {"two_layer_canopy_integrator", &create_mc<n_layer_canopy_integrator<2>>},
+    {"three_layer_canopy_properties", &create_mc<n_layer_canopy_properties<3>>},
+    {"three_layer_c3_canopy_fvcb", &create_mc<n_layer_c3_canopy_fvcb<3>>},
+    {"three_layer_canopy_integrator", &create_mc<n_layer_canopy_integrator<3>>},
+    {"four_layer_canopy_properties", &create_mc<n_layer_canopy_properties<4>>},
+    {"four_layer_c3_canopy_fvcb", &create_mc<n_layer_c3_canopy_fvcb<4>>},
+    {"four_layer_canopy_integrator", &create_mc<n_layer_canopy_integrator<4>>},
+    {"five_layer_canopy_properties", &create_mc<n_layer_canopy_properties<5>>},
+    {"five_layer_c3_canopy_fvcb", &create_mc<n_layer_c3_canopy_fvcb<5>>},
+    {"five_layer_canopy_integrator", &create_mc<n_layer_canopy_integrator<5>>},
+    {"six_layer_canopy_properties", &create_mc<n_layer_canopy_properties<6>>},
+    {"six_layer_c3_canopy_fvcb", &create_mc<n_layer_c3_canopy_fvcb<6>>},
+    {"six_layer_canopy_integrator", &create_mc<n_layer_canopy_integrator<6>>},
+    {"seven_layer_canopy_properties", &create_mc<n_layer_canopy_properties<7>>},
+    {"seven_layer_c3_canopy_fvcb", &create_mc<n_layer_c3_canopy_fvcb<7>>},
+    {"seven_layer_canopy_integrator", &create_mc<n_layer_canopy_integrator<7>>},
+    {"eight_layer_canopy_properties", &create_mc<n_layer_canopy_properties<8>>},
+    {"eight_layer_c3_canopy_fvcb", &create_mc<n_layer_c3_canopy_fvcb<8>>},
+    {"eight_layer_canopy_integrator", &create_mc<n_layer_canopy_integrator<8>>},
+    {"nine_layer_canopy_properties", &create_mc<n_layer_canopy_properties<9>>},
+    {"nine_layer_c3_canopy_fvcb", &create_mc<n_layer_c3_canopy_fvcb<9>>},
+    {"nine_layer_canopy_integrator", &create_mc<n_layer_canopy_integrator<9>>},
+    {"fifteen_layer_canopy_properties", &create_mc<n_layer_canopy_properties<15>>},
+    {"fifteen_layer_c3_canopy_fvcb", &create_mc<n_layer_c3_canopy_fvcb<15>>},
+    {"fifteen_layer_canopy_integrator", &create_mc<n_layer_canopy_integrator<15>>},
+    {"twenty_layer_canopy_properties", &create_mc<n_layer_canopy_properties<20>>},
+    {"twenty_layer_c3_canopy_fvcb", &create_mc<n_layer_c3_canopy_fvcb<20>>},
+    {"twenty_layer_canopy_integrator", &create_mc<n_layer_canopy_integrator<20>>},
+    // Canopy modules that represent the canopy as a sunlit and a shaded big leaf
+    {"two_leaf_canopy_properties", &create_mc<two_leaf_canopy_properties>},
+    {"two_leaf_c3_canopy_fvcb", &create_mc<two_leaf_c3_canopy_fvcb>},
+    {"two_leaf_canopy_integrator", &create_mc<two_leaf_canopy_integrator>},
+    // A canopy module that chooses its number of layers in each evaluation
+    {"adaptive_layer_c3_canopy_fvcb", &create_mc<adaptive_layer_c3_canopy_fvcb>},
+    // Canopies calculated in a single module, with and without diagnostic
+    // outputs for each leaf
+    {"ten_layer_fused_c3_canopy_fvcb", &create_mc<ten_layer_fused_c3_canopy_fvcb>},
+    {"ten_layer_fused_c3_canopy_fvcb_diagnostics", &create_mc<ten_layer_fused_c3_canopy_fvcb_diagnostics>},
+    {"twenty_layer_fused_c3_canopy_fvcb", &create_mc<n_layer_fused_c3_canopy_fvcb<20, false>>},
+#ifdef WITH_YGGDRASIL
+    // These modules communicate with models running in other processes
     {"c3_ephotosynthesis", &create_mc<c3_ephotosynthesis>},
     // {"c4_ephotosynthesis", &create_mc<c4_ephotosynthesis>},
-    {"ten_layer_canopy_properties", &create_mc<ten_layer_canopy_properties>},
     {"ten_layer_c3_canopy", &create_mc<ten_layer_c3_canopy>},
-    {"ten_layer_canopy_integrator", &create_mc<ten_layer_canopy_integrator>},
-    {"opensimroot", &create_mc<opensimroot>}
+    {"ten_layer_c3_canopy_event_loop", &create_mc<ten_layer_c3_canopy_event_loop>},
+    {"ten_layer_c3_hybrid_canopy", &create_mc<ten_layer_c3_hybrid_canopy>},
+    // These modules need an ePhotosynthesis server that applies the
+    // `enzyme_sf` of each request, which the server in models/ does not
+    // {"c3_ephotosynthesis_sweep", &create_mc<c3_ephotosynthesis_sweep>},
+    // {"ten_layer_c3_canopy_sweep", &create_mc<ten_layer_c3_canopy_sweep>},
+    // ePhotosynthesis canopy modules with other numbers of layers
+    {"one_layer_c3_canopy", &create_mc<n_layer_c3_canopy<1>>},
+    {"two_layer_c3_canopy", &create_mc<n_layer_c3_canopy<2>>},
+    {"three_layer_c3_canopy", &create_mc<n_layer_c3_canopy<3>>},
+    {"four_layer_c3_canopy", &create_mc<n_layer_c3_canopy<4>>},
+    {"five_layer_c3_canopy", &create_mc<n_layer_c3_canopy<5>>},
+    {"six_layer_c3_canopy", &create_mc<n_layer_c3_canopy<6>>},
+    {"seven_layer_c3_canopy", &create_mc<n_layer_c3_canopy<7>>},
+    {"eight_layer_c3_canopy", &create_mc<n_layer_c3_canopy<8>>},
+    {"nine_layer_c3_canopy", &create_mc<n_layer_c3_canopy<9>>},
+    {"fifteen_layer_c3_canopy", &create_mc<n_layer_c3_canopy<15>>},
+    {"twenty_layer_c3_canopy", &create_mc<n_layer_c3_canopy<20>>},
+    {"two_leaf_c3_canopy", &create_mc<two_leaf_c3_canopy>},
+    {"opensimroot", &create_mc<opensimroot>},
+#endif
 };
@@ -1,28 +1,122 @@
 #include "multilayer_c3_canopy.h"
 
-using yggdrasilBML::ten_layer_c3_canopy;
+#ifdef WITH_YGGDRASIL
+
 using yggdrasilBML::ten_layer_c3_canopy_parent;
+using yggdrasilBML::ten_layer_c3_canopy_event_loop;
+using yggdrasilBML::c3_ephotosynthesis;
+using yggdrasilBML::ten_layer_c3_canopy_sweep;
+using yggdrasilBML::ten_layer_c3_canopy_sweep_parent;
+using yggdrasilBML::ten_layer_c3_hybrid_canopy;
+using yggdrasilBML::ten_layer_c3_hybrid_canopy_parent;
 
-int const ten_layer_c3_canopy::nlayers = 10;  // Set the number of layers
+int const ten_layer_c3_canopy_event_loop::nlayers = 10;  // Set the number of layers
 
-string_vector ten_layer_c3_canopy::get_inputs()
+string_vector ten_layer_c3_canopy_event_loop::get_inputs()
 {
     // Just call the parent class's input function with the appropriate number
     // of layers
     return ten_layer_c3_canopy_parent::generate_inputs(
-        ten_layer_c3_canopy::nlayers);
+        ten_layer_c3_canopy_event_loop::nlayers);
 }
 
-string_vector ten_layer_c3_canopy::get_outputs()
+string_vector ten_layer_c3_canopy_event_loop::get_outputs()
 {
     // Just call the parent class's output function with the appropriate number
     // of layers
     return ten_layer_c3_canopy_parent::generate_outputs(
-        ten_layer_c3_canopy::nlayers);
+        ten_layer_c3_canopy_event_loop::nlayers);
+}
+
+void ten_layer_c3_canopy_event_loop::do_operation() const
+{
+    gather_leaf_inputs();
+
+    std::vector<double> const relative_canopy_weights = get_relative_canopy_weights();
+
+    // Only the leaves with distinct inputs need to be solved
+    std::vector<size_t> const distinct_leaves = find_distinct_leaves(relative_canopy_weights);
+
+    // Start each leaf; this leaves it waiting for its first reply from the
+    // ePhotosynthesis server
+    std::vector<c3_ephotosynthesis::suspended_leaf> leaves;
+    for (size_t i : distinct_leaves) {
+        leaves.push_back(load_leaf(i, relative_canopy_weights[i]).start_leaf());
+    }
+
+    // Resume all of the waiting leaves with one message per pass until every
+    // leaf is done
+    while (true) {
+        std::vector<c3_ephotosynthesis::suspended_leaf*> waiting;
+        for (c3_ephotosynthesis::suspended_leaf& leaf : leaves) {
+            if (!leaf.photo.done()) {
+                waiting.push_back(&leaf);
+            }
+        }
+
+        if (waiting.empty()) {
+            break;
+        }
+
+        load_leaf(distinct_leaves[0], relative_canopy_weights[distinct_leaves[0]]).resume_leaves(waiting);
+    }
+
+    // Set the outputs for each leaf
+    for (size_t n = 0; n < distinct_leaves.size(); ++n) {
+        size_t const i = distinct_leaves[n];
+        load_leaf(i, relative_canopy_weights[i]).finish_leaf(leaves[n]);
+        store_leaf(i);
+    }
+
+    copy_duplicate_leaf_outputs();
+}
+
+int const ten_layer_c3_canopy_sweep::nlayers = 10;  // Set the number of layers
+
+string_vector ten_layer_c3_canopy_sweep::get_inputs()
+{
+    // Just call the parent class's input function with the appropriate number
+    // of layers
+    return ten_layer_c3_canopy_sweep_parent::generate_inputs(
+        ten_layer_c3_canopy_sweep::nlayers);
 }
 
-void ten_layer_c3_canopy::do_operation() const
+string_vector ten_layer_c3_canopy_sweep::get_outputs()
+{
+    // Just call the parent class's output function with the appropriate number
+    // of layers
+    return ten_layer_c3_canopy_sweep_parent::generate_outputs(
+        ten_layer_c3_canopy_sweep::nlayers);
+}
+
+void ten_layer_c3_canopy_sweep::do_operation() const
 {
     // Just call the parent class's run operation
-    ten_layer_c3_canopy_parent::run();
+    ten_layer_c3_canopy_sweep_parent::run();
+}
+
+int const ten_layer_c3_hybrid_canopy::nlayers = 10;  // Set the number of layers
+
+string_vector ten_layer_c3_hybrid_canopy::get_inputs()
+{
+    // Just call the parent class's input function with the appropriate number
+    // of layers
+    return ten_layer_c3_hybrid_canopy_parent::generate_inputs(
+        ten_layer_c3_hybrid_canopy::nlayers);
 }
+
+string_vector ten_layer_c3_hybrid_canopy::get_outputs()
+{
+    // Just call the parent class's output function with the appropriate number
+    // of layers
+    return ten_layer_c3_hybrid_canopy_parent::generate_outputs(
+        ten_layer_c3_hybrid_canopy::nlayers);
+}
+
+void ten_layer_c3_hybrid_canopy::do_operation() const
+{
+    // Just call the parent class's run operation
+    ten_layer_c3_hybrid_canopy_parent::run();
+}
+
+#endif // WITH_YGGDRASIL
@@ -4,49 +4,389 @@
 #include "../framework/state_map.h"
 #include "multilayer_canopy_photosynthesis.h"
 #include "multilayer_canopy_properties.h"
+#include "two_leaf_canopy_properties.h"
 #include "ephotosynthesis.h"
+#include "c3_leaf_fvcb.h"
+#include "hybrid_canopy_photosynthesis.h"
 
 namespace yggdrasilBML 
 {
-using ten_layer_c3_canopy_parent =
+template <int N>
+using n_layer_c3_canopy_fvcb_parent =
     multilayer_canopy_photosynthesis<
-        ten_layer_canopy_properties,
+        n_layer_canopy_properties<N>,
+        c3_leaf_fvcb>;
+
+/**
+ * @class n_layer_c3_canopy_fvcb
+ *
+ * @brief Represents a canopy with `N` layers where leaf-level photosynthesis is
+ * calculated using the Farquhar-von-Caemmerer-Berry model for C3
+ * photosynthesis; see the `c3_leaf_fvcb` class for more information.
+ *
+ * More specifically, this is a child class of
+ * `multilayer_canopy_photosynthesis` where:
+ *
+ *  - The canopy module is set to the `n_layer_canopy_properties<N>` module
+ *
+ *  - The leaf module is set to the `c3_leaf_fvcb` module
+ *
+ *  - The number of layers is set to `N`, which must be between 1 and `MAXLAY`
+ *
+ * The module name is formed from the number of layers; for example, the module
+ * with `N = 10` is called `ten_layer_c3_canopy_fvcb`.
+ *
+ * Unlike `n_layer_c3_canopy`, this module does not use the ePhotosynthesis
+ * server, so it is available even when the package is built without
+ * yggdrasil. It can be used for fast screening runs or as a baseline for
+ * comparison with the ePhotosynthesis canopy.
+ *
+ * Instances of this class can be created using the module factory, unlike the
+ * parent class `multilayer_canopy_photosynthesis`.
+ */
+template <int N>
+class n_layer_c3_canopy_fvcb : public n_layer_c3_canopy_fvcb_parent<N>
+{
+   public:
+    n_layer_c3_canopy_fvcb(
+        state_map const& input_quantities,
+        state_map* output_quantities)
+        : n_layer_c3_canopy_fvcb_parent<N>(
+              N,
+              input_quantities,
+              output_quantities)
+    {
+    }
+    static string_vector get_inputs()
+    {
+        // Just call the parent class's input function with the appropriate
+        // number of layers
+        return n_layer_c3_canopy_fvcb_parent<N>::generate_inputs(N);
+    }
+    static string_vector get_outputs()
+    {
+        // Just call the parent class's output function with the appropriate
+        // number of layers
+        return n_layer_c3_canopy_fvcb_parent<N>::generate_outputs(N);
+    }
+    static std::string get_name() { return layer_count_name(N) + "_layer_c3_canopy_fvcb"; }
+
+   private:
+    // Main operation
+    void do_operation() const { n_layer_c3_canopy_fvcb_parent<N>::run(); }
+};
+
+using ten_layer_c3_canopy_fvcb_parent = n_layer_c3_canopy_fvcb_parent<10>;
+using ten_layer_c3_canopy_fvcb = n_layer_c3_canopy_fvcb<10>;
+
+using two_leaf_c3_canopy_fvcb_parent =
+    multilayer_canopy_photosynthesis<
+        two_leaf_canopy_properties,
+        c3_leaf_fvcb>;
+
+/**
+ * @class two_leaf_c3_canopy_fvcb
+ *
+ * @brief Represents a canopy as a sunlit and a shaded big leaf, where leaf-level
+ * photosynthesis is calculated using the Farquhar-von-Caemmerer-Berry model
+ * for C3 photosynthesis; see the `two_leaf_canopy_properties` and
+ * `c3_leaf_fvcb` classes for more information.
+ *
+ * More specifically, this is a child class of
+ * `multilayer_canopy_photosynthesis` where:
+ *
+ *  - The canopy module is set to the `two_leaf_canopy_properties` module
+ *
+ *  - The leaf module is set to the `c3_leaf_fvcb` module
+ *
+ *  - The number of layers is set to 1
+ *
+ * Canopy totals can be calculated from its outputs with the
+ * `two_leaf_canopy_integrator` module.
+ *
+ * Instances of this class can be created using the module factory, unlike the
+ * parent class `multilayer_canopy_photosynthesis`.
+ */
+class two_leaf_c3_canopy_fvcb : public two_leaf_c3_canopy_fvcb_parent
+{
+   public:
+    two_leaf_c3_canopy_fvcb(
+        state_map const& input_quantities,
+        state_map* output_quantities)
+        : two_leaf_c3_canopy_fvcb_parent(
+              1,
+              input_quantities,
+              output_quantities)
+    {
+    }
+    static string_vector get_inputs()
+    {
+        // Just call the parent class's input function with one layer
+        return two_leaf_c3_canopy_fvcb_parent::generate_inputs(1);
+    }
+    static string_vector get_outputs()
+    {
+        // Just call the parent class's output function with one layer
+        return two_leaf_c3_canopy_fvcb_parent::generate_outputs(1);
+    }
+    static std::string get_name() { return "two_leaf_c3_canopy_fvcb"; }
+
+   private:
+    // Main operation
+    void do_operation() const { two_leaf_c3_canopy_fvcb_parent::run(); }
+};
+
+#ifdef WITH_YGGDRASIL
+
+template <int N>
+using n_layer_c3_canopy_parent =
+    multilayer_canopy_photosynthesis<
+        n_layer_canopy_properties<N>,
+        c3_ephotosynthesis>;
+
+/**
+ * @class n_layer_c3_canopy
+ *
+ * @brief Represents a canopy with `N` layers where leaf-level photosynthesis is
+ * calculated using ePhotosynthesis; see the `c3_ephotosynthesis` class for
+ * more information about this model.
+ *
+ * More specifically, this is a child class of
+ * `multilayer_canopy_photosynthesis` where:
+ *
+ *  - The canopy module is set to the `n_layer_canopy_properties<N>` module
+ *
+ *  - The leaf module is set to the `c3_ephotosynthesis` module
+ *
+ *  - The number of layers is set to `N`, which must be between 1 and `MAXLAY`
+ *
+ * The module name is formed from the number of layers; for example, the module
+ * with `N = 10` is called `ten_layer_c3_canopy`. A canopy with fewer layers
+ * needs fewer calls to the ePhotosynthesis server.
+ *
+ * Instances of this class can be created using the module factory, unlike the
+ * parent class `multilayer_canopy_photosynthesis`.
+ */
+template <int N>
+class n_layer_c3_canopy : public n_layer_c3_canopy_parent<N>
+{
+   public:
+    n_layer_c3_canopy(
+        state_map const& input_quantities,
+        state_map* output_quantities)
+        : n_layer_c3_canopy_parent<N>(
+              N,
+              input_quantities,
+              output_quantities)
+    {
+    }
+    static string_vector get_inputs()
+    {
+        // Just call the parent class's input function with the appropriate
+        // number of layers
+        return n_layer_c3_canopy_parent<N>::generate_inputs(N);
+    }
+    static string_vector get_outputs()
+    {
+        // Just call the parent class's output function with the appropriate
+        // number of layers
+        return n_layer_c3_canopy_parent<N>::generate_outputs(N);
+    }
+    static std::string get_name() { return layer_count_name(N) + "_layer_c3_canopy"; }
+
+   private:
+    // Main operation
+    void do_operation() const { n_layer_c3_canopy_parent<N>::run(); }
+};
+
+using ten_layer_c3_canopy_parent = n_layer_c3_canopy_parent<10>;
+using ten_layer_c3_canopy = n_layer_c3_canopy<10>;
+
+using two_leaf_c3_canopy_parent =
+    multilayer_canopy_photosynthesis<
+        two_leaf_canopy_properties,
         c3_ephotosynthesis>;
 
 /**
- * @class ten_layer_c3_canopy
+ * @class two_leaf_c3_canopy
+ *
+ * @brief Represents a canopy as a sunlit and a shaded big leaf, where leaf-level
+ * photosynthesis is calculated using ePhotosynthesis; see the
+ * `two_leaf_canopy_properties` and `c3_ephotosynthesis` classes for more
+ * information.
+ *
+ * This is the same as `two_leaf_c3_canopy_fvcb`, except for the leaf module.
+ * Only two calls to the ePhotosynthesis server are needed for each evaluation.
+ */
+class two_leaf_c3_canopy : public two_leaf_c3_canopy_parent
+{
+   public:
+    two_leaf_c3_canopy(
+        state_map const& input_quantities,
+        state_map* output_quantities)
+        : two_leaf_c3_canopy_parent(
+              1,
+              input_quantities,
+              output_quantities)
+    {
+    }
+    static string_vector get_inputs()
+    {
+        // Just call the parent class's input function with one layer
+        return two_leaf_c3_canopy_parent::generate_inputs(1);
+    }
+    static string_vector get_outputs()
+    {
+        // Just call the parent class's output function with one layer
+        return two_leaf_c3_canopy_parent::generate_outputs(1);
+    }
+    static std::string get_name() { return "two_leaf_c3_canopy"; }
+
+   private:
+    // Main operation
+    void do_operation() const { two_leaf_c3_canopy_parent::run(); }
+};
+
+/**
+ * @class ten_layer_c3_canopy_event_loop
+ *
+ * @brief Represents the same ten layer canopy as `ten_layer_c3_canopy`, but
+ * solves all of its leaves together from a single thread.
+ *
+ * Each leaf's Ci iteration is a `c3photoC_coroutine`. The leaves are first
+ * started in turn, which runs their FvCB and energy balance calculations and
+ * leaves each one suspended at its first request to the ePhotosynthesis
+ * server. An event loop then repeatedly collects the requests from every leaf
+ * that is still waiting, sends them to the server in a single batched message
+ * (see `c3photoC_resume_batch`), and resumes each leaf with its reply, until
+ * all of the leaves are done. All of the leaves are therefore in progress at
+ * once without needing a thread for each one, and the number of messages sent
+ * to the server per canopy evaluation is the largest number of iterations
+ * needed by any leaf rather than the total over all leaves.
+ *
+ * The results are the same as those from `ten_layer_c3_canopy`. The server in
+ * `models/ePhotosynthesis_C` does not accept batched messages, so with that
+ * server `c3photoC_resume_batch` falls back to sending one request per leaf,
+ * and the number of messages is the same as for `ten_layer_c3_canopy`.
+ *
+ * Instances of this class can be created using the module factory.
+ */
+class ten_layer_c3_canopy_event_loop : public ten_layer_c3_canopy_parent
+{
+   public:
+    ten_layer_c3_canopy_event_loop(
+        state_map const& input_quantities,
+        state_map* output_quantities)
+        : ten_layer_c3_canopy_parent(
+              ten_layer_c3_canopy_event_loop::nlayers,
+              input_quantities,
+              output_quantities)
+    {
+    }
+    static string_vector get_inputs();
+    static string_vector get_outputs();
+    static std::string get_name() { return "ten_layer_c3_canopy_event_loop"; }
+
+   private:
+    // Number of layers
+    int static const nlayers;
+
+    // Main operation
+    void do_operation() const;
+};
+
+using ten_layer_c3_canopy_sweep_parent =
+    multilayer_canopy_photosynthesis<
+        ten_layer_canopy_properties,
+        c3_ephotosynthesis_sweep>;
+
+/**
+ * @class ten_layer_c3_canopy_sweep
  *
  * @brief Represents a ten layer canopy where leaf-level photosynthesis is
- * calculated using the Farquhar-von-Cammerer-Berry model for C3 photosynthesis;
- * see the `c3_leaf_photosynthesis` class for more information about this model.
+ * calculated using ePhotosynthesis for several values of `enzyme_sf` at once;
+ * see the `c3_ephotosynthesis_sweep` class for more information.
  *
  * More specifically, this is a child class of
  * `multilayer_canopy_photosynthesis` where:
+ *
+ *  - The canopy module is set to the `ten_layer_canopy_properties` module
+ *
+ *  - The leaf module is set to the `c3_ephotosynthesis_sweep` module
+ *
+ *  - The number of layers is set to 10
+ *
+ * This module is not registered in the module library, since it requires an
+ * ePhotosynthesis server that applies the `enzyme_sf` of each request.
+ */
+class ten_layer_c3_canopy_sweep : public ten_layer_c3_canopy_sweep_parent
+{
+   public:
+    ten_layer_c3_canopy_sweep(
+        state_map const& input_quantities,
+        state_map* output_quantities)
+        : ten_layer_c3_canopy_sweep_parent(
+              ten_layer_c3_canopy_sweep::nlayers,
+              input_quantities,
+              output_quantities)
+    {
+    }
+    static string_vector get_inputs();
+    static string_vector get_outputs();
+    static std::string get_name() { return "ten_layer_c3_canopy_sweep"; }
+
+   private:
+    // Number of layers
+    int static const nlayers;
+
+    // Main operation
+    void do_operation() const;
+};
 
+using ten_layer_c3_hybrid_canopy_parent =
+    hybrid_canopy_photosynthesis<
+        ten_layer_canopy_properties,
+        c3_ephotosynthesis,
+        c3_leaf_fvcb>;
+
+/**
+ * @class ten_layer_c3_hybrid_canopy
+ *
+ * @brief Represents a ten layer canopy where leaf-level photosynthesis is
+ * calculated using ePhotosynthesis for some leaves and the
+ * Farquhar-von-Caemmerer-Berry model for the others; see the
+ * `hybrid_canopy_photosynthesis` class for more information about how the
+ * model is chosen for each leaf.
+ *
+ * More specifically, this is a child class of `hybrid_canopy_photosynthesis`
+ * where:
+ *
  *  - The canopy module is set to the `ten_layer_canopy_properties` module
  *
- *  - The leaf module is set to the `c3_leaf_photosynthesis` module
+ *  - The high-fidelity leaf module is set to the `c3_ephotosynthesis` module
+ *
+ *  - The low-fidelity leaf module is set to the `c3_leaf_fvcb` module
  *
  *  - The number of layers is set to 10
  *
  * Instances of this class can be created using the module factory, unlike the
- * parent class `multilayer_canopy_photosynthesis`.
+ * parent class `hybrid_canopy_photosynthesis`.
  */
-class ten_layer_c3_canopy : public ten_layer_c3_canopy_parent
+class ten_layer_c3_hybrid_canopy : public ten_layer_c3_hybrid_canopy_parent
 {
    public:
-    ten_layer_c3_canopy(
+    ten_layer_c3_hybrid_canopy(
         state_map const& input_quantities,
         state_map* output_quantities)
-        : ten_layer_c3_canopy_parent(
-              ten_layer_c3_canopy::nlayers,
+        : ten_layer_c3_hybrid_canopy_parent(
+              ten_layer_c3_hybrid_canopy::nlayers,
               input_quantities,
               output_quantities)
     {
     }
     static string_vector get_inputs();
     static string_vector get_outputs();
-    static std::string get_name() { return "ten_layer_c3_canopy"; }
+    static std::string get_name() { return "ten_layer_c3_hybrid_canopy"; }
 
    private:
     // Number of layers
@@ -56,5 +396,7 @@ class ten_layer_c3_canopy : public ten_layer_c3_canopy_parent
     void do_operation() const;
 };
 
+#endif // WITH_YGGDRASIL
+
 }  // namespace yggdrasilBML 
 #endif
@@ -4,6 +4,8 @@
 #include "../framework/state_map.h"
 #include "../framework/module.h"
 #include "../framework/constants.h"  // for molar_mass_of_water, molar_mass_of_glucose
+#include "AuxBioCro.h"                  // for MAXLAY
+#include "multilayer_canopy_properties.h"  // for layer_count_name
 
 namespace yggdrasilBML 
 {
@@ -13,7 +15,12 @@ namespace yggdrasilBML
  * @brief Calculates canopy-level values for assimilation and other quantities
  * by adding the individual values from the sunlit and shaded leaves in each
  * canopy layer, weighted by the relative fractions of sunlit and shaded leaves
- * in each layer.
+ * in each layer and by the leaf area of each layer.
+ *
+ * The leaf area of each layer is the mean layer leaf area (`lai / nlayers`)
+ * multiplied by its `layer_weight`, which is 1 for equal layers and the
+ * scaled quadrature weight for layers placed at Gauss-Legendre points (see
+ * `multilayer_canopy_properties`).
  *
  * For more information about how multilayer modules work in BioCro, see the
  * documentation for the `multilayer_canopy_properties` and
@@ -42,6 +49,7 @@ class multilayer_canopy_integrator : public direct_module
           shaded_GrossAssim_ips{get_multilayer_ip(input_quantities, nlayers, "shaded_GrossAssim")},
           shaded_Gs_ips{get_multilayer_ip(input_quantities, nlayers, "shaded_Gs")},
           shaded_TransR_ips{get_multilayer_ip(input_quantities, nlayers, "shaded_TransR")},
+          layer_weight_ips{get_multilayer_ip(input_quantities, nlayers, "layer_weight")},
 
           // Get references to input quantities
           lai{get_input(input_quantities, "lai")},
@@ -70,6 +78,7 @@ class multilayer_canopy_integrator : public direct_module
     std::vector<double const*> const shaded_GrossAssim_ips;
     std::vector<double const*> const shaded_Gs_ips;
     std::vector<double const*> const shaded_TransR_ips;
+    std::vector<double const*> const layer_weight_ips;
 
     // References to input quantities
     double const& lai;
@@ -96,7 +105,7 @@ class multilayer_canopy_integrator : public direct_module
  * @brief Define all inputs required by the module, adding layer suffixes as
  * required
  */
-string_vector multilayer_canopy_integrator::get_inputs(int nlayers)
+inline string_vector multilayer_canopy_integrator::get_inputs(int nlayers)
 {
     // Define the multilayer inputs
     string_vector multilayer_inputs = {
@@ -110,6 +119,7 @@ string_vector multilayer_canopy_integrator::get_inputs(int nlayers)
         "shaded_GrossAssim",  // micromole / m^2 /s
         "shaded_Gs",          // mmol / m^2 / s
         "shaded_TransR",      // mmol / m^2 / s
+        "layer_weight",       // dimensionless
     };
 
     // Get the full list by appending layer numbers
@@ -125,7 +135,7 @@ string_vector multilayer_canopy_integrator::get_inputs(int nlayers)
 /**
  * @brief Define all outputs produced by the module
  */
-string_vector multilayer_canopy_integrator::get_outputs(int /*nlayers*/)
+inline string_vector multilayer_canopy_integrator::get_outputs(int /*nlayers*/)
 {
     return {
         "canopy_assimilation_rate",   // Mg / ha / hr
@@ -135,12 +145,12 @@ string_vector multilayer_canopy_integrator::get_outputs(int /*nlayers*/)
     };
 }
 
-void multilayer_canopy_integrator::do_operation() const
+inline void multilayer_canopy_integrator::do_operation() const
 {
     multilayer_canopy_integrator::run();
 }
 
-void multilayer_canopy_integrator::run() const
+inline void multilayer_canopy_integrator::run() const
 {
     double const LAIc = lai / nlayers;
     double canopy_assimilation_rate = 0;
@@ -151,8 +161,9 @@ void multilayer_canopy_integrator::run() const
     // Integrate assimilation, transpiration, and conductance throughout the
     // canopy
     for (int i = 0; i < nlayers; ++i) {
-        double const sunlit_lai = *sunlit_fraction_ips[i] * LAIc;
-        double const shaded_lai = *shaded_fraction_ips[i] * LAIc;
+        double const layer_lai = LAIc * *layer_weight_ips[i];
+        double const sunlit_lai = *sunlit_fraction_ips[i] * layer_lai;
+        double const shaded_lai = *shaded_fraction_ips[i] * layer_lai;
 
         if(*sunlit_Assim_ips[i] > 50.0 || *shaded_Assim_ips[i] > 50.0){
   		continue;
@@ -203,62 +214,74 @@ void multilayer_canopy_integrator::run() const
     update(canopy_conductance_op, canopy_conductance);
 }
 
-////////////////////////////////////////
-// TEN LAYER CANOPY INTEGRATOR MODULE //
-////////////////////////////////////////
+//////////////////////////////////////
+// N LAYER CANOPY INTEGRATOR MODULE //
+//////////////////////////////////////
 
 /**
- * @class ten_layer_canopy_integrator
+ * @class n_layer_canopy_integrator
  *
  * @brief A child class of multilayer_canopy_integrator where the number of
- * layers has been defined. Instances of this class can be created using the
- * module factory, unlike the parent class `multilayer_canopy_integrator`.
+ * layers has been defined by the template parameter `N`, which must be between
+ * 1 and `MAXLAY`. Instances of this class can be created using the module
+ * factory, unlike the parent class `multilayer_canopy_integrator`.
+ *
+ * The module name is formed from the number of layers; for example, the module
+ * with `N = 5` is called `five_layer_canopy_integrator`.
  */
-class ten_layer_canopy_integrator : public multilayer_canopy_integrator
+template <int N>
+class n_layer_canopy_integrator : public multilayer_canopy_integrator
 {
+    static_assert(N >= 1 && N <= MAXLAY, "N must be at least 1 but no more than MAXLAY");
+
    public:
-    ten_layer_canopy_integrator(
+    n_layer_canopy_integrator(
         state_map const& input_quantities,
         state_map* output_quantities)
         : multilayer_canopy_integrator(
-              ten_layer_canopy_integrator::nlayers,
+              N,
               input_quantities,
               output_quantities)
     {
     }
-    static string_vector get_inputs();
-    static string_vector get_leaf_classes();
-    static string_vector get_multiclass_multilayer_outputs();
-    static string_vector get_pure_multilayer_outputs();
-    static string_vector get_outputs();
-    static std::string get_name() { return "ten_layer_canopy_integrator"; }
+    static string_vector get_inputs()
+    {
+        return multilayer_canopy_integrator::get_inputs(N);
+    }
+    static string_vector get_outputs()
+    {
+        return multilayer_canopy_integrator::get_outputs(N);
+    }
+    static std::string get_name() { return layer_count_name(N) + "_layer_canopy_integrator"; }
 
    private:
-    // Number of layers
-    int static const nlayers;
-
     // Main operation
-    void do_operation() const;
+    void do_operation() const { multilayer_canopy_integrator::run(); }
 };
 
-int const ten_layer_canopy_integrator::nlayers = 10;
-
-string_vector ten_layer_canopy_integrator::get_inputs()
-{
-    return multilayer_canopy_integrator::get_inputs(
-        ten_layer_canopy_integrator::nlayers);
-}
-
-string_vector ten_layer_canopy_integrator::get_outputs()
-{
-    return multilayer_canopy_integrator::get_outputs(
-        ten_layer_canopy_integrator::nlayers);
-}
+using ten_layer_canopy_integrator = n_layer_canopy_integrator<10>;
 
-void ten_layer_canopy_integrator::do_operation() const
+/**
+ * @class two_leaf_canopy_integrator
+ *
+ * @brief Calculates canopy-level values from the sunlit and shaded big leaves
+ * of a two-leaf canopy (see `two_leaf_canopy_properties`). This is the same as
+ * `one_layer_canopy_integrator`, since the big leaves are stored as the only
+ * layer of a one-layer canopy.
+ */
+class two_leaf_canopy_integrator : public n_layer_canopy_integrator<1>
 {
-    multilayer_canopy_integrator::run();
-}
+   public:
+    two_leaf_canopy_integrator(
+        state_map const& input_quantities,
+        state_map* output_quantities)
+        : n_layer_canopy_integrator<1>(
+              input_quantities,
+              output_quantities)
+    {
+    }
+    static std::string get_name() { return "two_leaf_canopy_integrator"; }
+};
 
 }  // namespace yggdrasilBML
 #endif
@@ -1,9 +1,13 @@
 #ifndef MULTILAYER_CANOPY_PHOTOSYNTHESIS_H
 #define MULTILAYER_CANOPY_PHOTOSYNTHESIS_H
 
-#include <algorithm>  // for std::find
+#include <algorithm>      // for std::find, std::max
+#include <cstdlib>        // for std::getenv, std::atoi
+#include <functional>     // for std::hash
+#include <unordered_map>
 #include "../framework/module.h"
 #include "../framework/state_map.h"
+#include "work_stealing_pool.h"
 
 namespace MLCPnew  // helping functions for the MultiLayer Canopy Photosynthesis module
 {
@@ -27,6 +31,92 @@ string_vector get_leaf_input_subset(string_vector reference_names)
     return result_vector;
 }
 
+/**
+ * @brief A helping function for the multilayer canopy photosynthesis module
+ * that returns leaf module inputs whose values are calculated by the canopy
+ * photosynthesis module itself rather than passed from the canopy properties.
+ *
+ * - `relative_canopy_weight`: the weight of a leaf in the canopy integral (its
+ *   leaf class fraction times the leaf area in its layer) divided by the mean
+ *   weight of all leaves in the canopy
+ */
+inline string_vector get_canopy_calculated_leaf_inputs()
+{
+    return {
+        "relative_canopy_weight"  // dimensionless
+    };
+}
+
+/**
+ * @brief A helping function for the multilayer canopy photosynthesis module
+ * that returns the number of threads used to run the leaf module.
+ *
+ * This is set by the `YGGDRASILBML_LEAF_THREADS` environment variable when the
+ * package is built with OpenMP. Otherwise, or if the variable is not set, the
+ * leaves are run serially.
+ */
+inline int get_leaf_thread_count()
+{
+#ifdef _OPENMP
+    char const* const value = std::getenv("YGGDRASILBML_LEAF_THREADS");
+    return value ? std::max(std::atoi(value), 1) : 1;
+#else
+    return 1;
+#endif
+}
+
+/**
+ * @brief A helping function for the multilayer canopy photosynthesis module
+ * that tells a leaf module which thread will run it. Only leaf modules that
+ * call an external model (those with a `set_rpc_thread()` method) need to
+ * know; for other leaf modules, this does nothing.
+ */
+template <typename leaf_module_type>
+auto set_leaf_thread(leaf_module_type& leaf_module, int thread, int)
+    -> decltype(leaf_module.set_rpc_thread(thread), void())
+{
+    leaf_module.set_rpc_thread(thread);
+}
+
+template <typename leaf_module_type>
+void set_leaf_thread(leaf_module_type&, int, long)
+{
+}
+
+/**
+ * @brief A helping function for the multilayer canopy photosynthesis module
+ * that determines whether the outputs of a leaf module that requires
+ * `relative_canopy_weight` depend on it with its current inputs. Leaf modules
+ * that only use the weight in some modes can say so with a
+ * `uses_relative_canopy_weight()` method; otherwise, the outputs are assumed
+ * to depend on it.
+ */
+template <typename leaf_module_type>
+auto leaf_uses_relative_canopy_weight(leaf_module_type const& leaf_module, int)
+    -> decltype(leaf_module.uses_relative_canopy_weight())
+{
+    return leaf_module.uses_relative_canopy_weight();
+}
+
+template <typename leaf_module_type>
+bool leaf_uses_relative_canopy_weight(leaf_module_type const&, long)
+{
+    return true;
+}
+
+/**
+ * @brief A helping function for the multilayer canopy photosynthesis module
+ * that determines whether the leaf module requires a particular input.
+ */
+template <typename leaf_module_type>
+bool leaf_requires_input(std::string const& name)
+{
+    string_vector leaf_inputs = leaf_module_type::get_inputs();
+    return std::find(leaf_inputs.begin(),
+                     leaf_inputs.end(),
+                     name) != leaf_inputs.end();
+}
+
 /**
  * @brief A helping function for the multlayer canopy photosynthesis module that
  * returns inputs to the leaf module that will change with leaf class and canopy
@@ -70,7 +160,8 @@ string_vector get_other_leaf_inputs()
 
     std::vector<string_vector> quantities_that_change =
         {canopy_module_type::define_multiclass_multilayer_outputs(),
-         canopy_module_type::define_pure_multilayer_outputs()};
+         canopy_module_type::define_pure_multilayer_outputs(),
+         get_canopy_calculated_leaf_inputs()};
 
     for (string_vector const& sv : quantities_that_change) {
         for (std::string const& name : sv) {
@@ -148,6 +239,68 @@ namespace yggdrasilBML
  * base name (e.g. `incident_par`), a prefix that indicates the leaf class (e.g.
  * `sunlit_`), and a suffix that indicates the layer number (e.g. `_layer_0`).
  *
+ * A few leaf module inputs are calculated by this module rather than passed
+ * from the canopy properties module; see `get_canopy_calculated_leaf_inputs()`.
+ * For example, a leaf module that requires `relative_canopy_weight` receives
+ * the weight of each leaf in the canopy integral relative to the mean weight,
+ * which is determined from the leaf class `fraction` and the `layer_weight`
+ * (the relative leaf area) of each layer. This
+ * allows a leaf module to spend less effort on leaves that contribute little
+ * to the canopy totals.
+ *
+ * ### Passing quantities to the leaf module
+ *
+ * At the start of each evaluation, the values of the leaf module inputs that
+ * change with leaf class or layer are gathered from the canopy quantities into
+ * one contiguous array for each input, indexed by leaf, and the inputs that are
+ * the same for every leaf are passed to each instance of the leaf module once.
+ * Only the leaf-dependent inputs are then passed to the leaf module for each
+ * leaf, and they are read from these arrays by index rather than through a
+ * separate pointer for every input of every leaf. The pointers to the canopy
+ * quantities are shared by all instances of the leaf module. Modules that run
+ * the leaves themselves must call `gather_leaf_inputs()` before calling
+ * `load_leaf()` or `run_leaf()` in each evaluation.
+ *
+ * ### Leaves that are not run
+ *
+ * Within one evaluation, many leaves often receive identical inputs; for
+ * example, at night the sunlit and shaded leaves in every layer see the same
+ * (zero) PPFD. Before the leaves are run, the inputs of each leaf are hashed,
+ * and the leaf module is run only once for each distinct set of inputs; the
+ * outputs are then copied to the other leaves with the same inputs, so these
+ * leaves report the same outputs as if they had been run. The relative canopy
+ * weight only counts as an input when the leaf module's outputs depend on it
+ * (see `MLCPnew::leaf_uses_relative_canopy_weight()`).
+ *
+ * Leaves with no weight in the canopy integral (such as the sunlit leaves when
+ * the sun is below the horizon) do not affect the canopy totals and are never
+ * run. Each one uses the outputs of a leaf with the same inputs that was run,
+ * if there is one, and otherwise its outputs are set to zero.
+ *
+ * Modules that run the leaves themselves can do the same by running only the
+ * leaves returned by `find_distinct_leaves()` and then calling
+ * `copy_duplicate_leaf_outputs()`.
+ *
+ * ### Parallel operation
+ *
+ * By default, a single instance of the leaf module is run for each leaf in
+ * turn. When the package is built with OpenMP and the
+ * `YGGDRASILBML_LEAF_THREADS` environment variable is set to a number greater
+ * than one when this module is created, that many instances of the leaf
+ * module are created, each with its own quantity maps, and the leaves are run
+ * on the same number of threads using a `work_stealing_pool`. The time needed
+ * to solve a leaf varies widely (sunlit leaves near the top of the canopy
+ * take many more iterations than shaded leaves near the bottom), so threads
+ * that finish their own leaves take leaves from the others rather than
+ * waiting. The time each thread has spent running leaves is available from
+ * `get_leaf_thread_busy_times()`. Each leaf writes to its own output
+ * quantities, so the results do not depend on the number of threads or the
+ * order in which the leaves are run. Each instance of the leaf module is
+ * always run by the same thread, and leaf modules that call an external model
+ * through yggdrasil use a separate RPC channel for each thread (see
+ * `ygg_direct_module::set_rpc_thread()`), so the calls from different threads
+ * overlap and each reply returns to the thread that sent the request.
+ *
  * Note that this module has a non-standard constructor, so it cannot be created
  * using the module_factory. Rather, it is expected that directly-usable
  * classes will be derived from this class.
@@ -165,27 +318,104 @@ class multilayer_canopy_photosynthesis : public direct_module
     // Number of layers
     const int nlayers;
 
-    // Leaf photosynthesis module
-    state_map leaf_module_quantities;
-    state_map leaf_module_output_map;
-    std::unique_ptr<module> leaf_module;
+    // An instance of the leaf photosynthesis module, with its own quantity
+    // maps; one is created for each thread
+    struct leaf_worker {
+        state_map leaf_module_quantities;
+        state_map leaf_module_output_map;
+        std::unique_ptr<module> leaf_module;
+
+        // Pointers to the leaf module inputs that change with leaf class or
+        // layer, in the same order as the arrays in `leaf_input_values`
+        std::vector<double*> varying_input_ops;
+
+        // Pointers to the leaf module inputs that are the same for every leaf,
+        // in the same order as `constant_input_ips`
+        std::vector<double*> constant_input_ops;
+
+        // Pointers to the leaf module outputs, in the same order as the arrays
+        // in `leaf_output_ops`
+        std::vector<const double*> output_ips;
+
+        // Pointer used to pass a relative canopy weight to the leaf module, if
+        // required
+        double* relative_canopy_weight_op = nullptr;
+    };
+
+    // Number of leaves, i.e., combinations of leaf class and layer
+    const size_t nleaves;
+
+    // Pointers to the canopy quantities for the leaf-dependent inputs, and
+    // their values; both are stored as one contiguous array for each input,
+    // so the value of input `j` for leaf `i` is at `j * nleaves + i`
+    std::vector<const double*> varying_input_ips;
+    mutable std::vector<double> leaf_input_values;
+
+    // Pointers to the canopy quantities for the inputs that are the same for
+    // every leaf
+    std::vector<const double*> constant_input_ips;
+
+    // Pointers to the canopy outputs, stored in the same way as
+    // `varying_input_ips`
+    std::vector<double*> leaf_output_ops;
+
+    std::vector<std::unique_ptr<leaf_worker>> leaf_workers;
+
+    // Threads used to run the leaf module
+    mutable work_stealing_pool leaf_pool;
+
+    // Pointers used to calculate relative canopy weights, if required
+    std::vector<const double*> leaf_fraction_ips;
+    std::vector<const double*> leaf_layer_weight_ips;
+
+    // For each leaf, the index of the leaf whose outputs it uses in the
+    // current evaluation, or `nleaves` if its outputs are set to zero
+    mutable std::vector<size_t> leaf_sources;
 
-    // Pointers to input parameters
-    std::vector<std::vector<std::pair<double*, const double*>>> leaf_input_ptr_pairs;
+    std::unique_ptr<leaf_worker> make_leaf_worker(int thread) const;
 
-    // Pointers to output parameters
-    std::vector<std::vector<std::pair<double*, const double*>>> leaf_output_ptr_pairs;
+    void run_leaf_with(
+        leaf_worker const& worker,
+        size_t i,
+        double relative_canopy_weight) const;
+
+    void load_leaf_inputs(
+        leaf_worker const& worker,
+        size_t i,
+        double relative_canopy_weight) const;
+
+    void store_leaf_outputs(leaf_worker const& worker, size_t i) const;
+
+   public:
+    // Time spent running the leaf module on each thread, in seconds
+    std::vector<double> const& get_leaf_thread_busy_times() const
+    {
+        return leaf_pool.get_busy_times();
+    }
 
    protected:
     static string_vector generate_inputs(int nlayers);
     static string_vector generate_outputs(int nlayers);
     void run() const;
+    void run_leaf(size_t i, double relative_canopy_weight) const;
+
+    // Parts of `run`, for modules that need to control how the leaf module is
+    // run; `load_leaf` passes the inputs for one leaf to the leaf module and
+    // returns it, and `store_leaf` copies the outputs from the leaf module to
+    // the outputs for that leaf
+    size_t get_nleaves() const { return nleaves; }
+    void gather_leaf_inputs() const;
+    std::vector<double> get_relative_canopy_weights() const;
+    std::vector<size_t> find_distinct_leaves(std::vector<double> const& relative_canopy_weights) const;
+    void copy_duplicate_leaf_outputs() const;
+    leaf_module_type& load_leaf(size_t i, double relative_canopy_weight) const;
+    void store_leaf(size_t i) const;
 };
 
 /**
  * @brief Constructor for a multilayer canopy photosynthesis module, which
- * initializes the leaf module and prepares to pass inputs to it from the canopy
- * module.
+ * initializes the leaf module (one instance for each thread) and prepares to
+ * pass inputs to it from the canopy module.
  */
 template <typename canopy_module_type, typename leaf_module_type>
 multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::multilayer_canopy_photosynthesis(
@@ -193,7 +423,89 @@ multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::multilay
     state_map const& input_quantities,
     state_map* output_quantities)
     : direct_module(),
-      nlayers(nlayers)
+      nlayers(nlayers),
+      nleaves(canopy_module_type::define_leaf_classes().size() * nlayers),
+      leaf_pool(MLCPnew::get_leaf_thread_count()),
+      leaf_sources(nleaves, 0)
+{
+    // Find subsets of the leaf model's inputs
+    string_vector varying_leaf_inputs =
+        MLCPnew::get_multiclass_multilayer_leaf_inputs<canopy_module_type, leaf_module_type>();
+
+    string_vector multilayer_leaf_inputs =
+        MLCPnew::get_pure_multilayer_leaf_inputs<canopy_module_type, leaf_module_type>();
+
+    size_t const nmulticlass = varying_leaf_inputs.size();
+    varying_leaf_inputs.insert(
+        varying_leaf_inputs.end(),
+        multilayer_leaf_inputs.begin(),
+        multilayer_leaf_inputs.end());
+
+    // Get pointers to the canopy quantities for each leaf-dependent input and
+    // leaf; the leaves are ordered by leaf class and then by layer
+    for (size_t j = 0; j < varying_leaf_inputs.size(); ++j) {
+        for (std::string const& class_name : canopy_module_type::define_leaf_classes()) {
+            for (int i = 0; i < nlayers; ++i) {
+                std::string const layer_name =
+                    add_layer_suffix_to_quantity_name(nlayers, i, varying_leaf_inputs[j]);
+
+                varying_input_ips.push_back(get_ip(
+                    input_quantities,
+                    j < nmulticlass ? add_class_prefix_to_quantity_name(class_name, layer_name)
+                                    : layer_name));
+            }
+        }
+    }
+
+    leaf_input_values.resize(varying_input_ips.size());
+
+    for (std::string const& name : MLCPnew::get_other_leaf_inputs<canopy_module_type, leaf_module_type>()) {
+        constant_input_ips.push_back(get_ip(input_quantities, name));
+    }
+
+    // Get pointers to the canopy outputs for each leaf module output and leaf
+    for (std::string const& name : leaf_module_type::get_outputs()) {
+        for (std::string const& class_name : canopy_module_type::define_leaf_classes()) {
+            for (int i = 0; i < nlayers; ++i) {
+                leaf_output_ops.push_back(get_op(
+                    output_quantities,
+                    add_class_prefix_to_quantity_name(
+                        class_name,
+                        add_layer_suffix_to_quantity_name(nlayers, i, name))));
+            }
+        }
+    }
+
+    for (int t = 0; t < leaf_pool.get_nthreads(); ++t) {
+        leaf_workers.push_back(make_leaf_worker(t));
+    }
+
+    // Get pointers to the leaf class fraction and layer weight for each leaf,
+    // which are used to calculate the relative canopy weight and to find
+    // leaves that do not need to be run
+    for (std::string const& class_name : canopy_module_type::define_leaf_classes()) {
+        for (int i = 0; i < nlayers; ++i) {
+            leaf_fraction_ips.push_back(
+                get_ip(input_quantities,
+                       add_class_prefix_to_quantity_name(
+                           class_name,
+                           add_layer_suffix_to_quantity_name(nlayers, i, "fraction"))));
+
+            leaf_layer_weight_ips.push_back(
+                get_ip(input_quantities,
+                       add_layer_suffix_to_quantity_name(nlayers, i, "layer_weight")));
+        }
+    }
+}
+
+/**
+ * @brief Creates an instance of the leaf module to be run by thread `thread`,
+ * with its own quantity maps, along with the pointers needed to pass inputs to
+ * it and get outputs from it.
+ */
+template <typename canopy_module_type, typename leaf_module_type>
+std::unique_ptr<typename multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::leaf_worker>
+multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::make_leaf_worker(int thread) const
 {
     // Define a lambda for making quantity maps from vectors of inputs and outputs
     auto make_quantity_map = [](string_vector input_names, string_vector output_names) -> state_map {
@@ -206,90 +518,54 @@ multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::multilay
         return result;
     };
 
+    std::unique_ptr<leaf_worker> worker(new leaf_worker);
+
     // Form a quantity state_map to pass to the leaf photosynthesis module
-    leaf_module_quantities =
+    worker->leaf_module_quantities =
         make_quantity_map(
             leaf_module_type::get_inputs(),
             leaf_module_type::get_outputs());
 
-    leaf_module_output_map = leaf_module_quantities;
+    worker->leaf_module_output_map = worker->leaf_module_quantities;
 
     // Create the leaf photosynthesis module
-    leaf_module =
-        std::unique_ptr<module>(new leaf_module_type(
-            leaf_module_quantities,
-            &leaf_module_output_map));
-
-    // Find subsets of the leaf model's inputs
-    string_vector multiclass_multilayer_leaf_inputs =
-        MLCPnew::get_multiclass_multilayer_leaf_inputs<canopy_module_type, leaf_module_type>();
-
-    string_vector multilayer_leaf_inputs =
-        MLCPnew::get_pure_multilayer_leaf_inputs<canopy_module_type, leaf_module_type>();
-
-    string_vector other_leaf_inputs =
-        MLCPnew::get_other_leaf_inputs<canopy_module_type, leaf_module_type>();
-
-    // Create vectors of pointer pairs which will be used for passing inputs to
-    // and getting outputs from the leaf module
-    for (std::string const& class_name : canopy_module_type::define_leaf_classes()) {
-        for (int i = 0; i < nlayers; ++i) {
-            // Get pointer pairs for the leaf module inputs and store them
-            std::vector<std::pair<double*, const double*>> input_ptr_pairs;
-
-            for (std::string const& name : multiclass_multilayer_leaf_inputs) {
-                std::string specific_name =
-                    add_class_prefix_to_quantity_name(
-                        class_name,
-                        add_layer_suffix_to_quantity_name(nlayers, i, name));
-
-                std::pair<double*, const double*> temporary(
-                    get_op(&leaf_module_quantities, name),
-                    get_ip(input_quantities, specific_name));
-
-                input_ptr_pairs.push_back(temporary);
-            }
+    leaf_module_type* leaf_module = new leaf_module_type(
+        worker->leaf_module_quantities,
+        &worker->leaf_module_output_map);
 
-            for (std::string const& name : multilayer_leaf_inputs) {
-                std::string specific_name =
-                    add_layer_suffix_to_quantity_name(nlayers, i, name);
+    worker->leaf_module = std::unique_ptr<module>(leaf_module);
 
-                std::pair<double*, const double*> temporary(
-                    get_op(&leaf_module_quantities, name),
-                    get_ip(input_quantities, specific_name));
+    MLCPnew::set_leaf_thread(*leaf_module, thread, 0);
 
-                input_ptr_pairs.push_back(temporary);
-            }
-
-            for (std::string const& name : other_leaf_inputs) {
-                std::pair<double*, const double*> temporary(
-                    get_op(&leaf_module_quantities, name),
-                    get_ip(input_quantities, name));
-
-                input_ptr_pairs.push_back(temporary);
-            }
+    // Get pointers to the leaf module inputs and outputs, in the same order as
+    // the canopy quantities in the constructor
+    std::vector<string_vector> varying_leaf_inputs = {
+        MLCPnew::get_multiclass_multilayer_leaf_inputs<canopy_module_type, leaf_module_type>(),
+        MLCPnew::get_pure_multilayer_leaf_inputs<canopy_module_type, leaf_module_type>()};
 
-            leaf_input_ptr_pairs.push_back(input_ptr_pairs);
-
-            // Get pointer pairs to the leaf module outputs and store them
-            std::vector<std::pair<double*, const double*>> output_ptr_pairs;
-
-            for (std::string const& name : leaf_module_type::get_outputs()) {
-                std::string specific_name =
-                    add_class_prefix_to_quantity_name(
-                        class_name,
-                        add_layer_suffix_to_quantity_name(nlayers, i, name));
+    for (string_vector const& sv : varying_leaf_inputs) {
+        for (std::string const& name : sv) {
+            worker->varying_input_ops.push_back(
+                get_op(&worker->leaf_module_quantities, name));
+        }
+    }
 
-                std::pair<double*, const double*> temporary(
-                    get_op(output_quantities, specific_name),
-                    get_ip(leaf_module_output_map, name));
+    for (std::string const& name : MLCPnew::get_other_leaf_inputs<canopy_module_type, leaf_module_type>()) {
+        worker->constant_input_ops.push_back(
+            get_op(&worker->leaf_module_quantities, name));
+    }
 
-                output_ptr_pairs.push_back(temporary);
-            }
+    for (std::string const& name : leaf_module_type::get_outputs()) {
+        worker->output_ips.push_back(
+            get_ip(worker->leaf_module_output_map, name));
+    }
 
-            leaf_output_ptr_pairs.push_back(output_ptr_pairs);
-        }
+    if (MLCPnew::leaf_requires_input<leaf_module_type>("relative_canopy_weight")) {
+        worker->relative_canopy_weight_op =
+            get_op(&worker->leaf_module_quantities, "relative_canopy_weight");
     }
+
+    return worker;
 }
 
 template <typename canopy_module_type, typename leaf_module_type>
@@ -320,6 +596,24 @@ string_vector multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_t
         inputs.push_back(name);
     }
 
+    // The leaf class fractions and layer weights are needed to calculate
+    // relative canopy weights; only add them if they are not already included
+    string_vector fraction_inputs = generate_multilayer_quantity_names(
+        nlayers,
+        generate_multiclass_quantity_names(
+            canopy_module_type::define_leaf_classes(),
+            {"fraction"}));
+
+    for (std::string const& name : generate_multilayer_quantity_names(nlayers, {"layer_weight"})) {
+        fraction_inputs.push_back(name);
+    }
+
+    for (std::string const& name : fraction_inputs) {
+        if (std::find(inputs.begin(), inputs.end(), name) == inputs.end()) {
+            inputs.push_back(name);
+        }
+    }
+
     return inputs;
 }
 
@@ -334,24 +628,253 @@ string_vector multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_t
             leaf_module_type::get_outputs()));
 }
 
+/**
+ * @brief Returns the weight of each leaf in the canopy integral relative to the
+ * mean weight. The weight of each leaf is proportional to its leaf class
+ * fraction times the relative leaf area of its layer (`layer_weight`), which
+ * is 1 when every layer contains the same leaf area. If the canopy has no
+ * leaf area, it is set to 1 for every leaf.
+ */
+template <typename canopy_module_type, typename leaf_module_type>
+std::vector<double> multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::get_relative_canopy_weights() const
+{
+    double total_weight = 0.0;
+    for (size_t i = 0; i < leaf_fraction_ips.size(); ++i) {
+        total_weight += *leaf_fraction_ips[i] * *leaf_layer_weight_ips[i];
+    }
+
+    std::vector<double> relative_canopy_weights(get_nleaves(), 1.0);  // dimensionless
+    if (total_weight > 0) {
+        for (size_t i = 0; i < leaf_fraction_ips.size(); ++i) {
+            relative_canopy_weights[i] =
+                *leaf_fraction_ips[i] * *leaf_layer_weight_ips[i] *
+                leaf_fraction_ips.size() / total_weight;  // dimensionless
+        }
+    }
+    return relative_canopy_weights;
+}
+
+/**
+ * @brief Gathers the values of the leaf-dependent inputs into contiguous
+ * arrays and passes the inputs that are the same for every leaf to each
+ * instance of the leaf module. This must be done once in each evaluation
+ * before any leaves are loaded or run.
+ */
+template <typename canopy_module_type, typename leaf_module_type>
+void multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::gather_leaf_inputs() const
+{
+    for (size_t k = 0; k < varying_input_ips.size(); ++k) {
+        leaf_input_values[k] = *varying_input_ips[k];
+    }
+
+    for (std::unique_ptr<leaf_worker> const& worker : leaf_workers) {
+        for (size_t j = 0; j < constant_input_ips.size(); ++j) {
+            *worker->constant_input_ops[j] = *constant_input_ips[j];
+        }
+    }
+}
+
 template <typename canopy_module_type, typename leaf_module_type>
 void multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::run() const
 {
-    // For each combination of leaf class and layer number:
-    for (size_t i = 0; i < leaf_input_ptr_pairs.size(); ++i) {
-        // Update the inputs to the leaf module
-        for (auto const& x : leaf_input_ptr_pairs[i]) {
-            *x.first = *x.second;
+    gather_leaf_inputs();
+
+    std::vector<double> const relative_canopy_weights = get_relative_canopy_weights();
+
+    std::vector<size_t> const distinct_leaves = find_distinct_leaves(relative_canopy_weights);
+
+    // For each combination of leaf class and layer number with distinct
+    // inputs:
+    leaf_pool.run(
+        distinct_leaves.size(),
+        [&](size_t n, int thread) {
+            size_t const i = distinct_leaves[n];
+            run_leaf_with(*leaf_workers[thread], i, relative_canopy_weights[i]);
+        });
+
+    copy_duplicate_leaf_outputs();
+}
+
+/**
+ * @brief Returns the leaves that must be run in this evaluation, i.e., the
+ * first leaf with each distinct set of leaf module inputs among the leaves
+ * with weight in the canopy. Leaves with no weight use the outputs of a leaf
+ * with the same inputs, or zero if there is none. The inputs of each leaf are
+ * hashed so that leaves only need to be compared with others whose inputs
+ * have the same hash. `gather_leaf_inputs()` must be called first, and
+ * `copy_duplicate_leaf_outputs()` must be called after the leaves are run.
+ */
+template <typename canopy_module_type, typename leaf_module_type>
+std::vector<size_t> multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::find_distinct_leaves(
+    std::vector<double> const& relative_canopy_weights) const
+{
+    size_t const ninputs = leaf_workers[0]->varying_input_ops.size();
+
+    // The relative canopy weight only distinguishes leaves if it is an input
+    // to the leaf module and the leaf outputs depend on it
+    bool const use_weight =
+        leaf_workers[0]->relative_canopy_weight_op != nullptr &&
+        MLCPnew::leaf_uses_relative_canopy_weight(
+            static_cast<leaf_module_type const&>(*leaf_workers[0]->leaf_module), 0);
+
+    auto same_inputs = [&](size_t a, size_t b) -> bool {
+        for (size_t j = 0; j < ninputs; ++j) {
+            if (leaf_input_values[j * nleaves + a] != leaf_input_values[j * nleaves + b]) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    std::hash<double> const hash_value;
+    auto hash_inputs = [&](size_t i) -> size_t {
+        size_t hash = 0;
+        for (size_t j = 0; j < ninputs; ++j) {
+            hash = hash * 31 + hash_value(leaf_input_values[j * nleaves + i]);
+        }
+        return hash;
+    };
+
+    std::unordered_map<size_t, std::vector<size_t>> leaves_by_hash;
+    std::vector<size_t> distinct_leaves;
+
+    for (size_t i = 0; i < nleaves; ++i) {
+        if (relative_canopy_weights[i] == 0) {
+            continue;
+        }
+
+        std::vector<size_t>& candidates = leaves_by_hash[hash_inputs(i)];
+
+        leaf_sources[i] = i;
+        for (size_t c : candidates) {
+            if (same_inputs(c, i) &&
+                (!use_weight || relative_canopy_weights[c] == relative_canopy_weights[i])) {
+                leaf_sources[i] = c;
+                break;
+            }
+        }
+
+        if (leaf_sources[i] == i) {
+            candidates.push_back(i);
+            distinct_leaves.push_back(i);
+        }
+    }
+
+    // Leaves with no weight do not affect the canopy totals, so they are not
+    // run
+    for (size_t i = 0; i < nleaves; ++i) {
+        if (relative_canopy_weights[i] != 0) {
+            continue;
         }
 
-        // Run the leaf module
-        leaf_module->run();
+        leaf_sources[i] = nleaves;
 
-        // Update the outputs from the leaf module
-        for (auto const& x : leaf_output_ptr_pairs[i]) {
-            *x.first = *x.second;
+        auto const candidates = leaves_by_hash.find(hash_inputs(i));
+        if (candidates != leaves_by_hash.end()) {
+            for (size_t c : candidates->second) {
+                if (same_inputs(c, i)) {
+                    leaf_sources[i] = c;
+                    break;
+                }
+            }
         }
     }
+
+    return distinct_leaves;
+}
+
+/**
+ * @brief Sets the outputs for the leaves that were not run in this evaluation,
+ * copying them from the leaf with the same inputs or setting them to zero for
+ * leaves with no weight in the canopy and no such leaf.
+ */
+template <typename canopy_module_type, typename leaf_module_type>
+void multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::copy_duplicate_leaf_outputs() const
+{
+    for (size_t i = 0; i < nleaves; ++i) {
+        size_t const source = leaf_sources[i];
+        if (source == i) {
+            continue;
+        }
+
+        for (size_t k = i; k < leaf_output_ops.size(); k += nleaves) {
+            *leaf_output_ops[k] = source == nleaves ? 0.0 : *leaf_output_ops[k - i + source];
+        }
+    }
+}
+
+/**
+ * @brief Runs the leaf module for a single combination of leaf class and layer
+ * number, where `i` is the class index times the number of layers plus the
+ * layer index. This is also used by modules that combine several leaf models
+ * in one canopy.
+ */
+template <typename canopy_module_type, typename leaf_module_type>
+void multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::run_leaf(
+    size_t i,
+    double relative_canopy_weight) const
+{
+    run_leaf_with(*leaf_workers[0], i, relative_canopy_weight);
+}
+
+template <typename canopy_module_type, typename leaf_module_type>
+leaf_module_type& multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::load_leaf(
+    size_t i,
+    double relative_canopy_weight) const
+{
+    load_leaf_inputs(*leaf_workers[0], i, relative_canopy_weight);
+    return static_cast<leaf_module_type&>(*leaf_workers[0]->leaf_module);
+}
+
+template <typename canopy_module_type, typename leaf_module_type>
+void multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::store_leaf(size_t i) const
+{
+    store_leaf_outputs(*leaf_workers[0], i);
+}
+
+template <typename canopy_module_type, typename leaf_module_type>
+void multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::run_leaf_with(
+    leaf_worker const& worker,
+    size_t i,
+    double relative_canopy_weight) const
+{
+    load_leaf_inputs(worker, i, relative_canopy_weight);
+
+    // Run the leaf module
+    worker.leaf_module->run();
+
+    store_leaf_outputs(worker, i);
+}
+
+template <typename canopy_module_type, typename leaf_module_type>
+void multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::load_leaf_inputs(
+    leaf_worker const& worker,
+    size_t i,
+    double relative_canopy_weight) const
+{
+    // Update the leaf-dependent inputs to the leaf module
+    double const* values = leaf_input_values.data() + i;
+    for (double* op : worker.varying_input_ops) {
+        *op = *values;
+        values += nleaves;
+    }
+
+    if (worker.relative_canopy_weight_op) {
+        *worker.relative_canopy_weight_op = relative_canopy_weight;  // dimensionless
+    }
+}
+
+template <typename canopy_module_type, typename leaf_module_type>
+void multilayer_canopy_photosynthesis<canopy_module_type, leaf_module_type>::store_leaf_outputs(
+    leaf_worker const& worker,
+    size_t i) const
+{
+    // Update the outputs from the leaf module
+    double* const* ops = leaf_output_ops.data() + i;
+    for (const double* ip : worker.output_ips) {
+        **ops = *ip;
+        ops += nleaves;
+    }
 }
 
 }  // namespace yggdrasilBML
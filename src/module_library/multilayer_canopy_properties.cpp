@@ -3,7 +3,6 @@
 #include "AuxBioCro.h"  // for LNprof
 
 using yggdrasilBML::multilayer_canopy_properties;
-using yggdrasilBML::ten_layer_canopy_properties;
 
 /**
  * @brief Define all inputs required by the module
@@ -27,7 +26,8 @@ string_vector multilayer_canopy_properties::get_inputs(int /*nlayers*/)
         "par_energy_content",    // J / micromol
         "par_energy_fraction",   // dimensionless
         "leaf_transmittance",    // dimensionless
-        "leaf_reflectance"       // dimensionless
+        "leaf_reflectance",      // dimensionless
+        "canopy_layer_approach"  // a dimensionless switch
     };
 }
 
@@ -69,6 +69,7 @@ string_vector multilayer_canopy_properties::define_pure_multilayer_outputs()
         "rh",                          // dimensionless from Pa / Pa
         "windspeed",                   // m / s
         "LeafN",                       // mmol / m^2 (?)
+        "layer_weight",                // dimensionless
     };
 }
 
@@ -105,8 +106,26 @@ void multilayer_canopy_properties::run() const
     // density (PPFD) and absorbed shortwave energy throughout the canopy. Note
     // that the `sunML` function expects input expects PPFD values, so we must
     // convert photosynthetically active radiation (PAR) to PPFD using the
-    // energy content of light in the PAR band
-    struct Light_profile light_profile = sunML(
+    // energy content of light in the PAR band. The profile is stored in arrays
+    // with one element for each layer rather than in a `Light_profile`, which
+    // has room for `MAXLAY` layers; the arrays are parts of `profile_values`,
+    // which is allocated when the module is created.
+    auto profile = [this](int k) { return &profile_values[k * nlayers]; };
+
+    double* const sunlit_incident_ppfd = profile(0);
+    double* const incident_ppfd_scattered = profile(1);
+    double* const shaded_incident_ppfd = profile(2);
+    double* const average_incident_ppfd = profile(3);
+    double* const sunlit_absorbed_shortwave = profile(4);
+    double* const shaded_absorbed_shortwave = profile(5);
+    double* const average_absorbed_shortwave = profile(6);
+    double* const sunlit_fraction = profile(7);
+    double* const shaded_fraction = profile(8);
+    double* const height = profile(9);
+    double* const layer_depth = profile(10);
+    double* const layer_weight = profile(11);
+
+    double const canopy_direct_transmission_fraction = sunML(
         par_incident_direct / par_energy_content,   // micromol / (m^2 beam) / s
         par_incident_diffuse / par_energy_content,  // micromol / m^2 / s
         lai,
@@ -119,19 +138,37 @@ void multilayer_canopy_properties::run() const
         par_energy_content,
         par_energy_fraction,
         leaf_transmittance,
-        leaf_reflectance);
-
-    // Calculate relative humidity levels throughout the canopy
-    double relative_humidity_profile[nlayers];
-    RHprof(rh, nlayers, relative_humidity_profile);  // Modifies relative_humidity_profile
-
-    // Calculate windspeed throughout the canopy
-    double wind_speed_profile[nlayers];
-    WINDprof(windspeed, lai, nlayers, wind_speed_profile);  // Modifies wind_speed_profile
-
-    // Calculate leaf nitrogen throughout the canopy
-    double leafN_profile[nlayers];
-    LNprof(LeafN, lai, nlayers, kpLN, leafN_profile);  // Modifies leafN_profile
+        leaf_reflectance,
+        static_cast<int>(canopy_layer_approach),
+        {sunlit_incident_ppfd,
+         incident_ppfd_scattered,
+         shaded_incident_ppfd,
+         average_incident_ppfd,
+         sunlit_absorbed_shortwave,
+         shaded_absorbed_shortwave,
+         average_absorbed_shortwave,
+         sunlit_fraction,
+         shaded_fraction,
+         height,
+         layer_depth,
+         layer_weight});
+
+    // Calculate relative humidity, windspeed, and leaf nitrogen throughout the
+    // canopy. Layers placed at Gauss-Legendre points need the profiles at the
+    // depths of those points.
+    double* const relative_humidity_profile = profile(12);
+    double* const wind_speed_profile = profile(13);
+    double* const leafN_profile = profile(14);
+
+    if (canopy_layer_approach == 0) {
+        RHprof(rh, nlayers, relative_humidity_profile);         // Modifies relative_humidity_profile
+        WINDprof(windspeed, lai, nlayers, wind_speed_profile);  // Modifies wind_speed_profile
+        LNprof(LeafN, lai, nlayers, kpLN, leafN_profile);       // Modifies leafN_profile
+    } else {
+        RHprof(rh, nlayers, layer_depth, relative_humidity_profile);         // Modifies relative_humidity_profile
+        WINDprof(windspeed, lai, nlayers, layer_depth, wind_speed_profile);  // Modifies wind_speed_profile
+        LNprof(LeafN, lai, nlayers, layer_depth, kpLN, leafN_profile);       // Modifies leafN_profile
+    }
 
     // Don't calculate anything based on the nitrogen profile
     if (lnfun != 0) {
@@ -140,62 +177,25 @@ void multilayer_canopy_properties::run() const
 
     // Update layer-dependent outputs
     for (int i = 0; i < nlayers; ++i) {
-        update(sunlit_fraction_ops[i], light_profile.sunlit_fraction[i]);
-        update(sunlit_incident_ppfd_ops[i], light_profile.sunlit_incident_ppfd[i]);
-        update(sunlit_absorbed_shortwave_ops[i], light_profile.sunlit_absorbed_shortwave[i]);
+        update(sunlit_fraction_ops[i], sunlit_fraction[i]);
+        update(sunlit_incident_ppfd_ops[i], sunlit_incident_ppfd[i]);
+        update(sunlit_absorbed_shortwave_ops[i], sunlit_absorbed_shortwave[i]);
 
-        update(shaded_fraction_ops[i], light_profile.shaded_fraction[i]);
-        update(shaded_incident_ppfd_ops[i], light_profile.shaded_incident_ppfd[i]);
-        update(shaded_absorbed_shortwave_ops[i], light_profile.shaded_absorbed_shortwave[i]);
+        update(shaded_fraction_ops[i], shaded_fraction[i]);
+        update(shaded_incident_ppfd_ops[i], shaded_incident_ppfd[i]);
+        update(shaded_absorbed_shortwave_ops[i], shaded_absorbed_shortwave[i]);
 
-        update(average_incident_ppfd_ops[i], light_profile.average_incident_ppfd[i]);
-        update(average_absorbed_shortwave_ops[i], light_profile.average_absorbed_shortwave[i]);
+        update(average_incident_ppfd_ops[i], average_incident_ppfd[i]);
+        update(average_absorbed_shortwave_ops[i], average_absorbed_shortwave[i]);
 
-        update(incident_ppfd_scattered_ops[i], light_profile.incident_ppfd_scattered[i]);
-        update(height_ops[i], light_profile.height[i]);
+        update(incident_ppfd_scattered_ops[i], incident_ppfd_scattered[i]);
+        update(height_ops[i], height[i]);
         update(rh_ops[i], relative_humidity_profile[i]);
         update(windspeed_ops[i], wind_speed_profile[i]);
         update(LeafN_ops[i], leafN_profile[i]);
+        update(layer_weight_ops[i], layer_weight[i]);
     }
 
     // Update other outputs
-    update(canopy_direct_transmission_fraction_op, light_profile.canopy_direct_transmission_fraction);
-}
-
-////////////////////////////////////////
-// TEN LAYER CANOPY PROPERTIES MODULE //
-////////////////////////////////////////
-
-int const ten_layer_canopy_properties::nlayers = 10;
-
-string_vector ten_layer_canopy_properties::get_inputs()
-{
-    return multilayer_canopy_properties::get_inputs(ten_layer_canopy_properties::nlayers);
-}
-
-string_vector ten_layer_canopy_properties::define_leaf_classes()
-{
-    return multilayer_canopy_properties::define_leaf_classes();
-}
-
-string_vector ten_layer_canopy_properties::define_multiclass_multilayer_outputs()
-{
-    // Just call the parent class's multilayer output function
-    return multilayer_canopy_properties::define_multiclass_multilayer_outputs();
-}
-
-string_vector ten_layer_canopy_properties::define_pure_multilayer_outputs()
-{
-    // Just call the parent class's multilayer output function
-    return multilayer_canopy_properties::define_pure_multilayer_outputs();
-}
-
-string_vector ten_layer_canopy_properties::get_outputs()
-{
-    return multilayer_canopy_properties::get_outputs(ten_layer_canopy_properties::nlayers);
-}
-
-void ten_layer_canopy_properties::do_operation() const
-{
-    multilayer_canopy_properties::run();
+    update(canopy_direct_transmission_fraction_op, canopy_direct_transmission_fraction);
 }
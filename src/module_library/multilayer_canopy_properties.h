@@ -1,8 +1,10 @@
 #ifndef MULTILAYER_CANOPY_PROPERTIES_H
 #define MULTILAYER_CANOPY_PROPERTIES_H
 
+#include <string>  // for std::string, std::to_string
 #include "../framework/state_map.h"
 #include "../framework/module.h"
+#include "AuxBioCro.h"  // for MAXLAY
 
 namespace yggdrasilBML
 {
@@ -46,6 +48,14 @@ namespace yggdrasilBML
  * these quantities to a leaf photosynthesis module that represents one leaf
  * type (e.g. sunlit leaves in layer 1).
  *
+ * The placement of the layers is set by the `canopy_layer_approach` input (see
+ * `sunML`): `0` for layers that each contain the same leaf area, or `1` for
+ * layers placed at Gauss-Legendre points in cumulative LAI. In the second case,
+ * the layers contain different amounts of leaf area, and the leaf area of each
+ * layer relative to the mean is given by the `layer_weight` output, which is
+ * used by the `multilayer_canopy_integrator` module as a quadrature weight. For
+ * equal layers, `layer_weight` is 1.
+ *
  * Note that this module has a non-standard constructor, so it cannot be created
  * using the module_factory. Rather, it is expected that directly-usable
  * classes will be derived from this class.
@@ -80,6 +90,7 @@ class multilayer_canopy_properties : public direct_module
           par_energy_fraction(get_input(input_quantities, "par_energy_fraction")),
           leaf_transmittance(get_input(input_quantities, "leaf_transmittance")),
           leaf_reflectance(get_input(input_quantities, "leaf_reflectance")),
+          canopy_layer_approach(get_input(input_quantities, "canopy_layer_approach")),
 
           // Get pointers to output quantities
           sunlit_fraction_ops(get_multilayer_op(output_quantities, nlayers, "sunlit_fraction")),
@@ -95,7 +106,11 @@ class multilayer_canopy_properties : public direct_module
           rh_ops(get_multilayer_op(output_quantities, nlayers, "rh")),
           windspeed_ops(get_multilayer_op(output_quantities, nlayers, "windspeed")),
           LeafN_ops(get_multilayer_op(output_quantities, nlayers, "LeafN")),
-          canopy_direct_transmission_fraction_op(get_op(output_quantities, "canopy_direct_transmission_fraction"))
+          layer_weight_ops(get_multilayer_op(output_quantities, nlayers, "layer_weight")),
+          canopy_direct_transmission_fraction_op(get_op(output_quantities, "canopy_direct_transmission_fraction")),
+
+          // Allocate storage for the profiles
+          profile_values(nprofiles * nlayers)
     {
     }
 
@@ -121,6 +136,7 @@ class multilayer_canopy_properties : public direct_module
     double const& par_energy_fraction;
     double const& leaf_transmittance;
     double const& leaf_reflectance;
+    double const& canopy_layer_approach;
 
     // Pointers to output parameters
     std::vector<double*> const sunlit_fraction_ops;
@@ -136,8 +152,14 @@ class multilayer_canopy_properties : public direct_module
     std::vector<double*> const rh_ops;
     std::vector<double*> const windspeed_ops;
     std::vector<double*> const LeafN_ops;
+    std::vector<double*> const layer_weight_ops;
     double* canopy_direct_transmission_fraction_op;
 
+    // Storage for the profiles calculated in each evaluation, with `nlayers`
+    // elements for each of the `nprofiles` profiles
+    static int const nprofiles = 15;
+    mutable std::vector<double> profile_values;
+
    protected:
     void run() const;
     static string_vector get_inputs(int nlayers);
@@ -147,43 +169,83 @@ class multilayer_canopy_properties : public direct_module
     static string_vector get_outputs(int nlayers);
 };
 
-////////////////////////////////////////
-// TEN LAYER CANOPY PROPERTIES MODULE //
-////////////////////////////////////////
+/**
+ * @brief Returns the word used for a number of layers in the names of modules
+ * with a fixed number of layers (e.g. "ten" in `ten_layer_canopy_properties`).
+ * Numbers above twenty are written with digits.
+ */
+inline std::string layer_count_name(int nlayers)
+{
+    static char const* const names[] = {
+        "one", "two", "three", "four", "five", "six", "seven", "eight", "nine",
+        "ten", "eleven", "twelve", "thirteen", "fourteen", "fifteen",
+        "sixteen", "seventeen", "eighteen", "nineteen", "twenty"};
+
+    return nlayers >= 1 && nlayers <= 20 ? names[nlayers - 1]
+                                          : std::to_string(nlayers);
+}
+
+//////////////////////////////////////
+// N LAYER CANOPY PROPERTIES MODULE //
+//////////////////////////////////////
 
 /**
- * @class ten_layer_canopy_properties
+ * @class n_layer_canopy_properties
  *
  * @brief A child class of multilayer_canopy_properties where the number of
- * layers has been defined. Instances of this class can be created using the
- * module factory, unlike the parent class `multilayer_canopy_properties`.
+ * layers has been defined by the template parameter `N`, which must be between
+ * 1 and `MAXLAY`. Instances of this class can be created using the module
+ * factory, unlike the parent class `multilayer_canopy_properties`.
+ *
+ * The module name is formed from the number of layers; for example, the module
+ * with `N = 5` is called `five_layer_canopy_properties`. The layer counts that
+ * are available are set in `module_library.cpp`.
  */
-class ten_layer_canopy_properties : public multilayer_canopy_properties
+template <int N>
+class n_layer_canopy_properties : public multilayer_canopy_properties
 {
+    static_assert(N >= 1 && N <= MAXLAY, "N must be at least 1 but no more than MAXLAY");
+
    public:
-    ten_layer_canopy_properties(
+    n_layer_canopy_properties(
         state_map const& input_quantities,
         state_map* output_quantities)
         : multilayer_canopy_properties(
-              ten_layer_canopy_properties::nlayers,
+              N,
               input_quantities,
               output_quantities)
     {
     }
-    static string_vector get_inputs();
-    static string_vector define_leaf_classes();
-    static string_vector define_multiclass_multilayer_outputs();
-    static string_vector define_pure_multilayer_outputs();
-    static string_vector get_outputs();
-    static std::string get_name() { return "ten_layer_canopy_properties"; }
+    static string_vector get_inputs()
+    {
+        return multilayer_canopy_properties::get_inputs(N);
+    }
+    static string_vector define_leaf_classes()
+    {
+        return multilayer_canopy_properties::define_leaf_classes();
+    }
+    static string_vector define_multiclass_multilayer_outputs()
+    {
+        // Just call the parent class's multilayer output function
+        return multilayer_canopy_properties::define_multiclass_multilayer_outputs();
+    }
+    static string_vector define_pure_multilayer_outputs()
+    {
+        // Just call the parent class's multilayer output function
+        return multilayer_canopy_properties::define_pure_multilayer_outputs();
+    }
+    static string_vector get_outputs()
+    {
+        return multilayer_canopy_properties::get_outputs(N);
+    }
+    static std::string get_name() { return layer_count_name(N) + "_layer_canopy_properties"; }
 
    private:
-    // Number of layers
-    int static const nlayers;
-
     // Main operation
-    void do_operation() const;
+    void do_operation() const { multilayer_canopy_properties::run(); }
 };
 
+using ten_layer_canopy_properties = n_layer_canopy_properties<10>;
+
 }  // namespace yggdrasilBML
 #endif
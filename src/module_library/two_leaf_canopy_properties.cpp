@@ -0,0 +1,115 @@
+#include "two_leaf_canopy_properties.h"
+#include "multilayer_canopy_properties.h"  // for n_layer_canopy_properties
+#include "BioCro.h"                        // for sunML_two_leaf, RHprof, WINDprof
+#include "AuxBioCro.h"                     // for LNprof
+
+using yggdrasilBML::two_leaf_canopy_properties;
+
+// The outputs of this module are the same as those of a one-layer canopy
+using one_layer_canopy_properties = yggdrasilBML::n_layer_canopy_properties<1>;
+
+/**
+ * @brief Define all inputs required by the module
+ */
+string_vector two_leaf_canopy_properties::get_inputs()
+{
+    return {
+        "par_incident_direct",   // J / (m^2 beam) / s [area perpendicular to beam]
+        "par_incident_diffuse",  // J / m^2 / s        [through any plane]
+        "absorptivity_par",      // dimensionless
+        "lai",                   // dimensionless from (m^2 leaf) / (m^2 ground). LAI of entire canopy.
+        "cosine_zenith_angle",   // dimensionless
+        "kd",                    // (m^2 ground) / (m^2 leaf)
+        "chil",                  // dimensionless from m^2 / m^2
+        "heightf",               // m^-1 from (m^2 / m^2) / m.  Leaf area density; LAI per height of canopy.
+        "rh",                    // dimensionless from Pa / Pa
+        "windspeed",             // m / s
+        "LeafN",                 // mmol / m^2 (?)
+        "kpLN",                  // dimensionless
+        "lnfun",                 // a dimensionless switch
+        "par_energy_content",    // J / micromol
+        "par_energy_fraction",   // dimensionless
+        "leaf_transmittance",    // dimensionless
+        "leaf_reflectance"       // dimensionless
+    };
+}
+
+string_vector two_leaf_canopy_properties::define_leaf_classes()
+{
+    return one_layer_canopy_properties::define_leaf_classes();
+}
+
+string_vector two_leaf_canopy_properties::define_multiclass_multilayer_outputs()
+{
+    return one_layer_canopy_properties::define_multiclass_multilayer_outputs();
+}
+
+string_vector two_leaf_canopy_properties::define_pure_multilayer_outputs()
+{
+    return one_layer_canopy_properties::define_pure_multilayer_outputs();
+}
+
+string_vector two_leaf_canopy_properties::get_outputs()
+{
+    return one_layer_canopy_properties::get_outputs();
+}
+
+void two_leaf_canopy_properties::do_operation() const
+{
+    // Calculate values of incident photosynthetically active photon flux
+    // density (PPFD) and absorbed shortwave energy for the sunlit and shaded
+    // big leaves, converting photosynthetically active radiation (PAR) to PPFD
+    // as in `multilayer_canopy_properties`
+    struct Light_profile light_profile = sunML_two_leaf(
+        par_incident_direct / par_energy_content,   // micromol / (m^2 beam) / s
+        par_incident_diffuse / par_energy_content,  // micromol / m^2 / s
+        lai,
+        cosine_zenith_angle,
+        kd,
+        chil,
+        absorptivity_par,
+        heightf,
+        par_energy_content,
+        par_energy_fraction,
+        leaf_transmittance,
+        leaf_reflectance);
+
+    // Calculate relative humidity, windspeed, and leaf nitrogen at the middle
+    // of the canopy
+    double const* layer_depth = light_profile.layer_depth;
+
+    double relative_humidity;
+    RHprof(rh, 1, layer_depth, &relative_humidity);
+
+    double wind_speed;
+    WINDprof(windspeed, lai, 1, layer_depth, &wind_speed);
+
+    double leafN;
+    LNprof(LeafN, lai, 1, layer_depth, kpLN, &leafN);
+
+    // Don't calculate anything based on the nitrogen profile
+    if (lnfun != 0) {
+        throw std::logic_error("Thrown by the two_leaf_canopy_properties module: lnfun != 0 is not yet supported.");
+    }
+
+    // Update the outputs
+    update(sunlit_fraction_op, light_profile.sunlit_fraction[0]);
+    update(sunlit_incident_ppfd_op, light_profile.sunlit_incident_ppfd[0]);
+    update(sunlit_absorbed_shortwave_op, light_profile.sunlit_absorbed_shortwave[0]);
+
+    update(shaded_fraction_op, light_profile.shaded_fraction[0]);
+    update(shaded_incident_ppfd_op, light_profile.shaded_incident_ppfd[0]);
+    update(shaded_absorbed_shortwave_op, light_profile.shaded_absorbed_shortwave[0]);
+
+    update(average_incident_ppfd_op, light_profile.average_incident_ppfd[0]);
+    update(average_absorbed_shortwave_op, light_profile.average_absorbed_shortwave[0]);
+
+    update(incident_ppfd_scattered_op, light_profile.incident_ppfd_scattered[0]);
+    update(height_op, light_profile.height[0]);
+    update(rh_op, relative_humidity);
+    update(windspeed_op, wind_speed);
+    update(LeafN_op, leafN);
+    update(layer_weight_op, light_profile.layer_weight[0]);
+
+    update(canopy_direct_transmission_fraction_op, light_profile.canopy_direct_transmission_fraction);
+}
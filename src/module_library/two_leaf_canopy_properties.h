@@ -0,0 +1,132 @@
+#ifndef TWO_LEAF_CANOPY_PROPERTIES_H
+#define TWO_LEAF_CANOPY_PROPERTIES_H
+
+#include "../framework/state_map.h"
+#include "../framework/module.h"
+
+namespace yggdrasilBML
+{
+/**
+ * @class two_leaf_canopy_properties
+ *
+ * @brief Calculates environmental properties for a canopy represented by two
+ * big leaves, one for the sunlit leaves and one for the shaded leaves, using
+ * the `sunML_two_leaf` function found in `AuxBioCro.cpp`.
+ *
+ * The light equations from `sunML` are integrated analytically over the sunlit
+ * and shaded leaf area of the whole canopy, so the canopy can be represented
+ * by just two leaves rather than a sunlit and a shaded leaf in each of several
+ * layers. The relative humidity, wind speed, and leaf nitrogen are taken at
+ * the middle of the canopy.
+ *
+ * The outputs are the same as those of `one_layer_canopy_properties` (see
+ * `multilayer_canopy_properties`), where the `fraction` outputs are the
+ * fractions of the canopy leaf area in each big leaf, so this module can be
+ * used with the `multilayer_canopy_photosynthesis` and
+ * `multilayer_canopy_integrator` modules with one layer. For example, the
+ * `two_leaf_c3_canopy_fvcb` and `two_leaf_canopy_integrator` modules use this
+ * module to calculate canopy assimilation and transpiration with two leaf
+ * evaluations, which is much less expensive than a multilayer canopy when the
+ * detail of each layer is not needed.
+ */
+class two_leaf_canopy_properties : public direct_module
+{
+   public:
+    two_leaf_canopy_properties(
+        state_map const& input_quantities,
+        state_map* output_quantities)
+        : direct_module(),
+
+          // Get references to input quantities
+          par_incident_direct(get_input(input_quantities, "par_incident_direct")),
+          par_incident_diffuse(get_input(input_quantities, "par_incident_diffuse")),
+          absorptivity_par(get_input(input_quantities, "absorptivity_par")),
+          lai(get_input(input_quantities, "lai")),
+          cosine_zenith_angle(get_input(input_quantities, "cosine_zenith_angle")),
+          kd(get_input(input_quantities, "kd")),
+          chil(get_input(input_quantities, "chil")),
+          heightf(get_input(input_quantities, "heightf")),
+          rh(get_input(input_quantities, "rh")),
+          windspeed(get_input(input_quantities, "windspeed")),
+          LeafN(get_input(input_quantities, "LeafN")),
+          kpLN(get_input(input_quantities, "kpLN")),
+          lnfun(get_input(input_quantities, "lnfun")),
+          par_energy_content(get_input(input_quantities, "par_energy_content")),
+          par_energy_fraction(get_input(input_quantities, "par_energy_fraction")),
+          leaf_transmittance(get_input(input_quantities, "leaf_transmittance")),
+          leaf_reflectance(get_input(input_quantities, "leaf_reflectance")),
+
+          // Get pointers to output quantities
+          sunlit_fraction_op(get_op(output_quantities, layer_name("sunlit_fraction"))),
+          sunlit_incident_ppfd_op(get_op(output_quantities, layer_name("sunlit_incident_ppfd"))),
+          sunlit_absorbed_shortwave_op(get_op(output_quantities, layer_name("sunlit_absorbed_shortwave"))),
+          shaded_fraction_op(get_op(output_quantities, layer_name("shaded_fraction"))),
+          shaded_incident_ppfd_op(get_op(output_quantities, layer_name("shaded_incident_ppfd"))),
+          shaded_absorbed_shortwave_op(get_op(output_quantities, layer_name("shaded_absorbed_shortwave"))),
+          average_incident_ppfd_op(get_op(output_quantities, layer_name("average_incident_ppfd"))),
+          average_absorbed_shortwave_op(get_op(output_quantities, layer_name("average_absorbed_shortwave"))),
+          incident_ppfd_scattered_op(get_op(output_quantities, layer_name("incident_ppfd_scattered"))),
+          height_op(get_op(output_quantities, layer_name("height"))),
+          rh_op(get_op(output_quantities, layer_name("rh"))),
+          windspeed_op(get_op(output_quantities, layer_name("windspeed"))),
+          LeafN_op(get_op(output_quantities, layer_name("LeafN"))),
+          layer_weight_op(get_op(output_quantities, layer_name("layer_weight"))),
+          canopy_direct_transmission_fraction_op(get_op(output_quantities, "canopy_direct_transmission_fraction"))
+    {
+    }
+    static string_vector get_inputs();
+    static string_vector define_leaf_classes();                   // required for compatibility with the multilayer_canopy_photosynthesis module
+    static string_vector define_multiclass_multilayer_outputs();  // required for compatibility with the multilayer_canopy_photosynthesis module
+    static string_vector define_pure_multilayer_outputs();        // required for compatibility with the multilayer_canopy_photosynthesis module
+    static string_vector get_outputs();
+    static std::string get_name() { return "two_leaf_canopy_properties"; }
+
+   private:
+    // References to input parameters
+    double const& par_incident_direct;
+    double const& par_incident_diffuse;
+    double const& absorptivity_par;
+    double const& lai;
+    double const& cosine_zenith_angle;
+    double const& kd;
+    double const& chil;
+    double const& heightf;
+    double const& rh;
+    double const& windspeed;
+    double const& LeafN;
+    double const& kpLN;
+    double const& lnfun;
+    double const& par_energy_content;
+    double const& par_energy_fraction;
+    double const& leaf_transmittance;
+    double const& leaf_reflectance;
+
+    // Pointers to output parameters
+    double* sunlit_fraction_op;
+    double* sunlit_incident_ppfd_op;
+    double* sunlit_absorbed_shortwave_op;
+    double* shaded_fraction_op;
+    double* shaded_incident_ppfd_op;
+    double* shaded_absorbed_shortwave_op;
+    double* average_incident_ppfd_op;
+    double* average_absorbed_shortwave_op;
+    double* incident_ppfd_scattered_op;
+    double* height_op;
+    double* rh_op;
+    double* windspeed_op;
+    double* LeafN_op;
+    double* layer_weight_op;
+    double* canopy_direct_transmission_fraction_op;
+
+    // The big leaves are stored as the only layer of a one-layer canopy
+    static std::string layer_name(std::string const& name)
+    {
+        return add_layer_suffix_to_quantity_name(1, 0, name);
+    }
+
+    // Main operation
+    void do_operation() const;
+};
+
+}  // namespace yggdrasilBML
+#endif
@@ -0,0 +1,106 @@
+#include <atomic>
+#include <chrono>
+#include <exception>  // for std::exception_ptr
+#include "work_stealing_pool.h"
+
+#ifdef _OPENMP
+#include <omp.h>  // for omp_get_thread_num
+#endif
+
+work_stealing_pool::work_stealing_pool(int nthreads)
+    : nthreads(nthreads > 1 ? nthreads : 1),
+      busy_times(this->nthreads, 0.0)
+{
+    for (int t = 0; t < this->nthreads; ++t) {
+        queues.push_back(std::unique_ptr<task_queue>(new task_queue));
+    }
+}
+
+void work_stealing_pool::run(
+    size_t ntasks,
+    std::function<void(size_t, int)> const& task)
+{
+    // Give each thread a contiguous block of tasks. Any tasks left over from a
+    // previous call that was stopped by an exception are discarded.
+    for (int t = 0; t < nthreads; ++t) {
+        std::deque<size_t>& tasks = queues[t]->tasks;
+        tasks.clear();
+
+        size_t const begin = ntasks * t / nthreads;
+        size_t const end = ntasks * (t + 1) / nthreads;
+        for (size_t i = begin; i < end; ++i) {
+            tasks.push_back(i);
+        }
+    }
+
+    // Exceptions must not leave a parallel region, so the first one thrown on
+    // each thread is stored and thrown again afterwards. No new tasks are
+    // started once any task has failed.
+    std::vector<std::exception_ptr> errors(nthreads);
+    std::atomic<bool> failed(false);
+
+#pragma omp parallel num_threads(nthreads) if (nthreads > 1)
+    {
+#ifdef _OPENMP
+        int const t = omp_get_thread_num();
+#else
+        int const t = 0;
+#endif
+        size_t i;
+        while (!failed && take_task(t, i)) {
+            auto const start = std::chrono::steady_clock::now();
+
+            try {
+                task(i, t);
+            } catch (...) {
+                errors[t] = std::current_exception();
+                failed = true;
+            }
+
+            busy_times[t] += std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();  // s
+        }
+    }
+
+    for (std::exception_ptr const& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+void work_stealing_pool::reset_busy_times()
+{
+    for (double& time : busy_times) {
+        time = 0.0;  // s
+    }
+}
+
+/**
+ * @brief Takes the next task from the front of the thread's own queue or, if
+ * it is empty, from the back of another thread's queue. Returns false if no
+ * tasks remain.
+ *
+ * Tasks are never added to a queue during a call to `run()`, so once every
+ * queue has been found empty, all tasks have been taken.
+ */
+bool work_stealing_pool::take_task(int thread, size_t& task)
+{
+    for (int k = 0; k < nthreads; ++k) {
+        task_queue& queue = *queues[(thread + k) % nthreads];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (!queue.tasks.empty()) {
+            if (k == 0) {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            } else {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            return true;
+        }
+    }
+    return false;
+}
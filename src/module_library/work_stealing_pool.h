@@ -0,0 +1,62 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <cstddef>     // for size_t
+#include <deque>
+#include <functional>  // for std::function
+#include <memory>      // for std::unique_ptr
+#include <mutex>
+#include <vector>
+
+/**
+ * @class work_stealing_pool
+ *
+ * @brief Runs a set of independent tasks on a fixed number of threads, moving
+ * tasks from busy threads to idle ones.
+ *
+ * At the start of each call to `run()`, the tasks are divided into contiguous
+ * blocks, one for each thread, and each block is placed in a double-ended
+ * queue owned by that thread. A thread takes tasks from the front of its own
+ * queue; once its queue is empty, it takes tasks from the back of the other
+ * threads' queues until no tasks remain. This keeps every thread busy when
+ * the cost of the tasks varies widely and can't be predicted in advance, such
+ * as the leaves of a canopy, where sunlit leaves near the top take many more
+ * iterations to solve than shaded leaves near the bottom.
+ *
+ * The threads are provided by OpenMP. If the package is built without OpenMP,
+ * or OpenMP provides fewer threads than requested, the calling thread (and any
+ * other threads that are available) take the remaining tasks from the unused
+ * queues, so every task is always run exactly once.
+ *
+ * The time each thread spends running tasks is accumulated over all calls to
+ * `run()` and can be retrieved with `get_busy_times()`.
+ */
+class work_stealing_pool
+{
+   public:
+    explicit work_stealing_pool(int nthreads);
+
+    // `task(i, thread)` is called for each `i` from 0 to `ntasks - 1`, where
+    // `thread` is the index of the calling thread (from 0 to `nthreads - 1`)
+    void run(
+        size_t ntasks,
+        std::function<void(size_t, int)> const& task);
+
+    int get_nthreads() const { return nthreads; }
+    std::vector<double> const& get_busy_times() const { return busy_times; }
+    void reset_busy_times();
+
+   private:
+    struct task_queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    int const nthreads;
+    std::vector<std::unique_ptr<task_queue>> queues;
+    std::vector<double> busy_times;  // s
+
+    bool take_task(int thread, size_t& task);
+};
+
+#endif
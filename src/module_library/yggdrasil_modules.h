@@ -6,6 +6,7 @@
 
 #ifdef WITH_YGGDRASIL
 
+#include <string>            // for std::to_string
 #include "YggInterface.hpp" // for yggdrasil connection
 
 namespace yggdrasilBML
@@ -47,6 +48,16 @@ class ygg_direct_module : public direct_module
 #ifdef _OPENMP
         }
 #endif
+        rpc_name = server_name;
+    }
+    // Use a separate RPC channel for the calls made by this instance, which
+    // is run from thread `thread` of a canopy module. RPC clients are
+    // registered globally by name, so instances running on different threads
+    // must use different names to receive only their own replies; the first
+    // thread keeps the usual name.
+    void set_rpc_thread(int thread) {
+        rpc_name = thread > 0 ? server_name + "_" + std::to_string(thread)
+                              : server_name;
     }
     static double get_doc_member(const rapidjson::Document& state,
                                  const std::string& name) {
@@ -62,6 +73,11 @@ class ygg_direct_module : public direct_module
         }
         return state[name].GetDouble();
     }
+    static bool has_doc_member(const rapidjson::Document& state,
+                               const std::string& name) {
+        return (state.IsObject() && state.HasMember(name) &&
+                state[name].IsDouble());
+    }
     static void call_model(YggRpcClient& rpc,
                            rapidjson::Document& state) {
         int ret = 0;
@@ -98,7 +114,7 @@ class ygg_direct_module : public direct_module
             ygglog_error(msg.c_str());
             throw std::logic_error(msg);
         }
-        WITH_GLOBAL_SCOPE(YggRpcClient rpc(server_name.c_str(),
+        WITH_GLOBAL_SCOPE(YggRpcClient rpc(rpc_name.c_str(),
                                            dtype_out, dtype_in));
         if (!(rpc.pi()->flags & COMM_FLAG_VALID)) {
             std::string msg("Failed to create RPC comm.\n");
@@ -149,6 +165,7 @@ class ygg_direct_module : public direct_module
     }
 
     std::string server_name;
+    std::string rpc_name;
     std::unordered_map<std::string, const double&> inputs;
     std::unordered_map<std::string, double*> outputs;
 };